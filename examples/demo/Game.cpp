@@ -9,6 +9,7 @@ Game::Game(Window::Ptr & window)
       grid(10, {1, 1, 1, 1}, true),
       showGrid(true),
       wireframe(Fill) {
+    res.setPackMeshes(true);
 
     camera.setPosition({3, 2, 1});
     camera.setRotation({0, -1, 0});
@@ -78,15 +79,15 @@ void Game::onUpdate(const sf::Time & delta) {
 }
 
 inline void setupGl() {
+    auto & gl = GLStateCache::current();
     glClearColor(0.25, 0.25, 0.25, 1.0);
-    glDisable(GL_CULL_FACE);
-    glEnable(GL_CULL_FACE);
-    glCullFace(GL_BACK);
-    glFrontFace(GL_CCW);
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_LEQUAL);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    gl.setCullFace(true);
+    gl.setCullMode(GL_BACK);
+    gl.setFrontFace(GL_CCW);
+    gl.setDepthTest(true);
+    gl.setDepthFunc(GL_LEQUAL);
+    gl.setBlend(true);
+    gl.setBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 }
 
 void Game::onDraw() const {
@@ -96,13 +97,17 @@ void Game::onDraw() const {
     glPointSize(2.0);
 
     RenderState state(camera);
-    scene.draw(state);
+    queue.submit(scene, state);
+    queue.flush();
 
     if (showGrid) {
         grid.draw(state.getVP());
     }
 
     glpp::BufferArray::unbind();
+    // glpp binds it's own program and vertex array outside of the cache
+    GLStateCache::current().invalidateProgram();
+    GLStateCache::current().invalidateVertexArray();
 
     glPolygonMode(GL_FRONT_AND_BACK, Fill);
 }
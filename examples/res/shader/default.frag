@@ -2,12 +2,37 @@
 
 out vec4 FragColor;
 
+#ifdef SINGE_TEXTURE_ARRAY
+uniform sampler2DArray gTextureArray;
+
+#ifdef SINGE_DRAW_LIST
+// The layer of each draw comes from the SingeDrawList entry
+flat in int FragLayer;
+#else
+layout (std140) uniform SingeMaterial {
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+    float specExp;
+    float alpha;
+    int layer;
+};
+#endif
+#else
 uniform sampler2D gTexture;
+#endif
 
 in vec3 FragPos;
 in vec3 FragNorm;
 in vec2 FragTex;
 
 void main() {
+#ifdef SINGE_TEXTURE_ARRAY
+#ifdef SINGE_DRAW_LIST
+    int layer = FragLayer;
+#endif
+    FragColor = texture(gTextureArray, vec3(FragTex, layer));
+#else
     FragColor = texture(gTexture, FragTex);
+#endif
 }
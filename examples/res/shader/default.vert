@@ -8,9 +8,34 @@ out vec3 FragPos;
 out vec3 FragNorm;
 out vec2 FragTex;
 
+#ifdef SINGE_DRAW_LIST
+struct SingeDrawData {
+    mat4 mvp;
+    mat4 model;
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+    float specExp;
+    float alpha;
+    int layer;
+};
+
+layout (std140) uniform SingeDrawList {
+    SingeDrawData draws[64];
+};
+
+layout (location = 7) in uint singeDrawIndex;
+
+flat out int FragLayer;
+#else
 uniform mat4 mvp;
+#endif
 
 void main() {
+#ifdef SINGE_DRAW_LIST
+    mat4 mvp = draws[singeDrawIndex].mvp;
+    FragLayer = draws[singeDrawIndex].layer;
+#endif
     gl_Position = mvp * vec4(aPos, 1.0);
     FragPos = vec3(mvp * vec4(aPos, 1.0));
     FragNorm = aNorm;
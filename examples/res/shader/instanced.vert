@@ -0,0 +1,45 @@
+#version 330 core
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNorm;
+layout (location = 2) in vec2 aTex;
+layout (location = 3) in mat4 aInstance;
+
+out vec3 FragPos;
+out vec3 FragNorm;
+out vec2 FragTex;
+
+#ifdef SINGE_DRAW_LIST
+struct SingeDrawData {
+    mat4 mvp;
+    mat4 model;
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+    float specExp;
+    float alpha;
+    int layer;
+};
+
+layout (std140) uniform SingeDrawList {
+    SingeDrawData draws[64];
+};
+
+layout (location = 7) in uint singeDrawIndex;
+
+flat out int FragLayer;
+#else
+uniform mat4 mvp;
+#endif
+
+void main() {
+#ifdef SINGE_DRAW_LIST
+    mat4 mvp = draws[singeDrawIndex].mvp;
+    FragLayer = draws[singeDrawIndex].layer;
+#endif
+    gl_Position = mvp * aInstance * vec4(aPos, 1.0);
+    FragPos = vec3(gl_Position);
+    // The instance matrix includes the uniform scale of a Quantized mesh
+    FragNorm = normalize(mat3(aInstance) * aNorm);
+    FragTex = aTex;
+}
@@ -13,6 +13,7 @@ static glm::vec2 reverseProject(glm::vec3 & point, glm::mat4 & mvp) {
 
 Game::Game(Window::Ptr & window)
     : GameBase(window), res("../../../examples/res") {
+    res.setPackMeshes(true);
 
     shader = res.getMVPShader("shader/default.vert", "shader/default.frag");
 
@@ -49,15 +50,16 @@ void Game::onUpdate(const sf::Time & delta) {
 }
 
 inline void setupGl() {
+    auto & gl = GLStateCache::current();
     glClearColor(0.25, 0.25, 0.25, 1.0);
-    glDisable(GL_CULL_FACE);
-    // glEnable(GL_CULL_FACE);
-    // glCullFace(GL_BACK);
-    glFrontFace(GL_CCW);
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_LEQUAL);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    gl.setCullFace(false);
+    // gl.setCullFace(true);
+    // gl.setCullMode(GL_BACK);
+    gl.setFrontFace(GL_CCW);
+    gl.setDepthTest(true);
+    gl.setDepthFunc(GL_LEQUAL);
+    gl.setBlend(true);
+    gl.setBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 }
 
 void Game::onDraw() const {
@@ -65,17 +67,22 @@ void Game::onDraw() const {
 
     RenderState state(camera);
     state.setGridEnable(true);
-    scene.draw(state);
+    queue.submit(scene, state);
+    queue.flush();
 
     mat4 mvp = state.getMVP();
 
     line->draw(mvp);
 
-    glDisable(GL_CULL_FACE);
-    glDisable(GL_DEPTH_TEST);
-    glDisable(GL_BLEND);
+    auto & gl = GLStateCache::current();
+    gl.setCullFace(false);
+    gl.setDepthTest(false);
+    gl.setBlend(false);
 
     circle->draw();
 
     glpp::BufferArray::unbind();
+    // glpp binds it's own program and vertex array outside of the cache
+    gl.invalidateProgram();
+    gl.invalidateVertexArray();
 }
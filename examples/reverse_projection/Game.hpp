@@ -4,7 +4,9 @@
 #include <singe/Core/GameBase.hpp>
 #include <singe/Core/ResourceManager.hpp>
 #include <singe/Core/Window.hpp>
+#include <singe/Graphics/GLStateCache.hpp>
 #include <singe/Graphics/Model.hpp>
+#include <singe/Graphics/RenderQueue.hpp>
 #include <singe/Graphics/Scene.hpp>
 #include <singe/Graphics/Shader.hpp>
 #include <singe/Support/log.hpp>
@@ -21,6 +23,7 @@ class Game : public GameBase {
     std::shared_ptr<singe::MVPShader> shader;
     std::shared_ptr<singe::Shader> circle_shader;
     Scene scene;
+    mutable RenderQueue queue;
     shared_ptr<Diamond> circle;
     glpp::extra::Line::Ptr line;
 
@@ -4,6 +4,8 @@
 #include <singe/Core/GameBase.hpp>
 #include <singe/Core/ResourceManager.hpp>
 #include <singe/Core/Window.hpp>
+#include <singe/Graphics/GLStateCache.hpp>
+#include <singe/Graphics/RenderQueue.hpp>
 #include <singe/Graphics/Scene.hpp>
 #include <singe/Support/log.hpp>
 using namespace singe;
@@ -21,6 +23,7 @@ class Game : public GameBase {
     std::shared_ptr<singe::MVPShader> shader;
     Grid grid;
     Scene scene;
+    mutable RenderQueue queue;
     shared_ptr<Scene> otherScene;
     bool showGrid;
 
@@ -7,6 +7,7 @@ Game::Game(Window::Ptr & window)
       res("../../../examples/res"),
       shader(res.getMVPShader("shader/default.vert", "shader/default.frag")),
       grid(10, {1, 1, 1, 1}, true) {
+    res.setPackMeshes(true);
 
     camera.setPosition({5, 2, 5});
     camera.setRotation({0.2, -0.75, 0});
@@ -40,24 +41,29 @@ void Game::onUpdate(const sf::Time & delta) {
 }
 
 inline void setupGl() {
+    auto & gl = GLStateCache::current();
     glClearColor(0.25, 0.25, 0.25, 1.0);
-    glDisable(GL_CULL_FACE);
-    // glEnable(GL_CULL_FACE);
-    // glCullFace(GL_BACK);
-    glFrontFace(GL_CCW);
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_LEQUAL);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    gl.setCullFace(false);
+    // gl.setCullFace(true);
+    // gl.setCullMode(GL_BACK);
+    gl.setFrontFace(GL_CCW);
+    gl.setDepthTest(true);
+    gl.setDepthFunc(GL_LEQUAL);
+    gl.setBlend(true);
+    gl.setBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 }
 
 void Game::onDraw() const {
     setupGl();
 
     RenderState state(camera);
-    scene.draw(state);
+    queue.submit(scene, state);
+    queue.flush();
 
     grid.draw(state.getMVP());
 
     glpp::BufferArray::unbind();
+    // glpp binds it's own program and vertex array outside of the cache
+    GLStateCache::current().invalidateProgram();
+    GLStateCache::current().invalidateVertexArray();
 }
@@ -0,0 +1,13 @@
+include(FetchContent)
+
+FetchContent_Declare(
+   googletest
+   GIT_REPOSITORY https://github.com/google/googletest.git
+   GIT_TAG v1.14.0)
+
+set(INSTALL_GTEST OFF)
+set(BUILD_GMOCK OFF)
+# Use the same runtime as the rest of the project on Windows
+set(gtest_force_shared_crt ON CACHE BOOL "" FORCE)
+
+FetchContent_MakeAvailable(googletest)
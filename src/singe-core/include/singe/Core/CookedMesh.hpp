@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <glm/glm.hpp>
+#include <glpp/extra/Vertex.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "singe/Support/MappedFile.hpp"
+
+namespace singe {
+    using std::shared_ptr;
+    using std::string;
+    using std::vector;
+    using glm::vec3;
+    using glpp::extra::Vertex;
+
+    namespace fs = std::filesystem;
+
+    /**
+     * Wavefront model parsed and welded into vertex and index blobs that can
+     * be written to and loaded from a binary cooked file.
+     *
+     * The cooked file holds a header with the size, modification time and
+     * hash of the source files, the material libraries of the source, the
+     * material table, the object table and the vertex / index blobs. Loading
+     * a cooked file maps it into memory so the blobs are used in place
+     * without parsing.
+     *
+     * A cooked file is current if the size and modification time of the .obj
+     * and it's .mtl files match. If only the modification time changed, the
+     * files are hashed and compared instead.
+     */
+    class CookedMesh {
+    public:
+        using Ptr = shared_ptr<CookedMesh>;
+        using ConstPtr = const shared_ptr<CookedMesh>;
+
+        /// Version of the cooked file format
+        static constexpr uint32_t Version = 2;
+
+        /**
+         * Material properties and texture paths, relative to resource root.
+         */
+        struct Material {
+            string name;
+            vec3 ambient, diffuse, specular;
+            float specExp;
+            float alpha;
+            string texture;
+            string normalTexture;
+            string specularTexture;
+        };
+
+        /**
+         * Welded mesh of one object. The vertices and indices point into the
+         * CookedMesh and are valid for it's lifetime.
+         */
+        struct Object {
+            string name;
+            /// Index into materials or -1 for no material
+            int32_t materialId;
+            const Vertex * vertices;
+            size_t vertexCount;
+            const uint32_t * indices;
+            size_t indexCount;
+        };
+
+        vector<Material> materials;
+        vector<Object> objects;
+
+    private:
+        MappedFile file;
+        /// Material libraries named by the source, relative to it's directory
+        vector<string> libraries;
+        vector<vector<Vertex>> vertexStorage;
+        vector<vector<uint32_t>> indexStorage;
+
+    public:
+        CookedMesh();
+
+        /// @brief  Move constructor
+        CookedMesh(CookedMesh && other);
+
+        /// @brief  Move assignment
+        CookedMesh & operator=(CookedMesh && other);
+
+        CookedMesh(const CookedMesh &) = delete;
+        CookedMesh & operator=(const CookedMesh &) = delete;
+
+        ~CookedMesh();
+
+        /**
+         * Parse a Wavefront model and weld each object. This does not need an
+         * OpenGL context.
+         *
+         * @param source the path to the .obj file
+         *
+         * @return false if the model has no objects
+         */
+        bool cook(const fs::path & source);
+
+        /**
+         * Load a cooked file if it is current for source.
+         *
+         * @param cooked the path to the cooked file
+         * @param source the path to the .obj file the cooked file was made from
+         *
+         * @return false if the cooked file is missing, invalid or out of date
+         */
+        bool load(const fs::path & cooked, const fs::path & source);
+
+        /**
+         * Write this mesh to a cooked file. Parent directories are created if
+         * they do not exist.
+         *
+         * @param cooked the path to write the cooked file to
+         * @param source the path to the .obj file this mesh was cooked from
+         *
+         * @return false if the file could not be written
+         */
+        bool save(const fs::path & cooked, const fs::path & source) const;
+    };
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+#include "singe/Graphics/Texture.hpp"
+#include "singe/Support/MappedFile.hpp"
+
+namespace singe {
+    using std::shared_ptr;
+    using std::vector;
+
+    namespace fs = std::filesystem;
+
+    /**
+     * Image decoded into a full mip chain that can be written to and loaded
+     * from a binary cooked file.
+     *
+     * Cooking builds the mip chain on the CPU and can compress every level to
+     * BC1 if the image is opaque or BC3 if it has alpha. This takes 1/8 or 1/4
+     * of the memory of RGBA8 and the levels are uploaded as they are, so the
+     * driver does not generate mipmaps.
+     *
+     * The cooked file holds a header with the size, modification time and
+     * hash of the source image, the level table and the level data. Loading
+     * a cooked file maps it into memory so the levels are uploaded straight
+     * from the mapping.
+     *
+     * A cooked file is current if the size and modification time of the
+     * source image match. If only the modification time changed, the image
+     * is hashed and compared instead.
+     */
+    class CookedTexture {
+    public:
+        using Ptr = shared_ptr<CookedTexture>;
+        using ConstPtr = const shared_ptr<CookedTexture>;
+
+        /// Version of the cooked file format
+        static constexpr uint32_t Version = 2;
+
+        /// Internal format of the levels, GL_RGBA8,
+        /// GL_COMPRESSED_RGB_S3TC_DXT1_EXT or GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+        GLenum format;
+        /// Mip levels starting with the full size image, first row is the
+        /// bottom of the image. Valid for the lifetime of the CookedTexture.
+        vector<Texture::Level> levels;
+
+    private:
+        MappedFile file;
+        vector<vector<uint8_t>> levelStorage;
+
+    public:
+        CookedTexture();
+
+        /// @brief  Move constructor
+        CookedTexture(CookedTexture && other);
+
+        /// @brief  Move assignment
+        CookedTexture & operator=(CookedTexture && other);
+
+        CookedTexture(const CookedTexture &) = delete;
+        CookedTexture & operator=(const CookedTexture &) = delete;
+
+        ~CookedTexture();
+
+        /**
+         * Decode an image and build it's mip chain. This does not need an
+         * OpenGL context.
+         *
+         * @param source the path to the image file
+         * @param compress compress the levels to BC1 / BC3
+         *
+         * @return false if the image could not be decoded
+         */
+        bool cook(const fs::path & source, bool compress);
+
+        /**
+         * Load a cooked file if it is current for source.
+         *
+         * @param cooked the path to the cooked file
+         * @param source the path to the image the cooked file was made from
+         *
+         * @return false if the cooked file is missing, invalid or out of date
+         */
+        bool load(const fs::path & cooked, const fs::path & source);
+
+        /**
+         * Write this texture to a cooked file. Parent directories are created
+         * if they do not exist.
+         *
+         * @param cooked the path to write the cooked file to
+         * @param source the path to the image this texture was cooked from
+         *
+         * @return false if the file could not be written
+         */
+        bool save(const fs::path & cooked, const fs::path & source) const;
+
+        /**
+         * Are the levels compressed.
+         *
+         * @return true if format is BC1 or BC3
+         */
+        bool isCompressed() const;
+
+        /**
+         * Compress an RGBA8 image to BC1 or BC3. Blocks on the right and top
+         * edge repeat the last column and row of the image.
+         *
+         * @param pixels the image, width * height RGBA8 pixels
+         * @param width the width of the image
+         * @param height the height of the image
+         * @param format GL_COMPRESSED_RGB_S3TC_DXT1_EXT or
+         *        GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+         *
+         * @return the compressed blocks in row order
+         */
+        static vector<uint8_t> compressLevel(const vector<uint8_t> & pixels,
+                                             unsigned width,
+                                             unsigned height,
+                                             GLenum format);
+    };
+}
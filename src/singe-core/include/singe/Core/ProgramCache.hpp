@@ -0,0 +1,128 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace singe {
+    using std::shared_ptr;
+    using std::string;
+    using std::vector;
+
+    namespace fs = std::filesystem;
+
+    /**
+     * Links shader programs and keeps their program binaries on disk so later
+     * runs can skip GLSL compilation.
+     *
+     * A program binary is only valid for the driver that produced it, so the
+     * cache file name is a hash of both sources and the GL_VENDOR,
+     * GL_RENDERER and GL_VERSION strings. The file header repeats the hash and
+     * driver string and the binary is only used if they match. If the driver
+     * rejects the binary the program is compiled from source and the binary
+     * is written again.
+     *
+     * If the context does not support program binaries or there is no cache
+     * directory, programs are always compiled from source.
+     *
+     * ProgramCache::linkAll() submits every compile and link before it asks
+     * for any status, so drivers that compile on their own threads (see
+     * KHR_parallel_shader_compile) work on the programs at the same time.
+     */
+    class ProgramCache {
+    public:
+        using Ptr = shared_ptr<ProgramCache>;
+        using ConstPtr = const shared_ptr<ProgramCache>;
+
+        /// Version of the program binary file format
+        static constexpr uint32_t Version = 1;
+
+        /// Sources of one program for ProgramCache::linkAll()
+        struct Sources {
+            string vertex;
+            string fragment;
+            /// Name used in log and error messages
+            string name;
+        };
+
+    private:
+        fs::path directory;
+        string driver;
+        bool supported;
+
+    public:
+        /**
+         * Create a ProgramCache that stores binaries in directory. The
+         * OpenGL context must be current.
+         *
+         * @param directory the directory for program binaries, may be empty
+         */
+        ProgramCache(const fs::path & directory);
+
+        /// @brief  Move constructor
+        ProgramCache(ProgramCache && other);
+
+        /// @brief  Move assignment
+        ProgramCache & operator=(ProgramCache && other);
+
+        ProgramCache(const ProgramCache &) = delete;
+        ProgramCache & operator=(const ProgramCache &) = delete;
+
+        ~ProgramCache();
+
+        /**
+         * Can program binaries be retrieved and loaded in this context.
+         *
+         * @return true if program binaries are supported and the driver has
+         *         at least one binary format
+         */
+        bool isSupported() const;
+
+        /**
+         * Get the path of the program binary for a pair of sources.
+         *
+         * @param vertexSource the vertex shader source
+         * @param fragmentSource the fragment shader source
+         *
+         * @return the path of the binary file or empty if binaries are not
+         *         used
+         */
+        fs::path binaryPath(const string & vertexSource,
+                            const string & fragmentSource) const;
+
+        /**
+         * Load a program from it's cached binary or compile and link it from
+         * source and write the binary.
+         *
+         * @param vertexSource the vertex shader source
+         * @param fragmentSource the fragment shader source
+         * @param name the name used in log and error messages
+         *
+         * @return the linked program name, owned by the caller
+         *
+         * @throws ResourceLoadException if a shader does not compile or the
+         *         program does not link
+         */
+        GLuint link(const string & vertexSource,
+                    const string & fragmentSource,
+                    const string & name) const;
+
+        /**
+         * Load or link several programs at once, see ProgramCache::link().
+         * A program that fails does not stop the others from linking.
+         *
+         * @param programs the sources of each program
+         * @param errors set to the error message of each program in the same
+         *               order as programs, empty for programs that linked
+         *
+         * @return the linked program names in the same order as programs,
+         *         owned by the caller, 0 for programs that failed
+         */
+        vector<GLuint> linkAll(const vector<Sources> & programs,
+                               vector<string> & errors) const;
+    };
+}
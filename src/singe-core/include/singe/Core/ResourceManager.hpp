@@ -1,29 +1,49 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
 #include <filesystem>
-#include <glpp/Texture.hpp>
+#include <functional>
+#include <future>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <set>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <vector>
 
+#include "singe/Core/CookedMesh.hpp"
+#include "singe/Core/CookedTexture.hpp"
+#include "singe/Core/ProgramCache.hpp"
+#include "singe/Core/ShaderVariants.hpp"
 #include "singe/Graphics/Material.hpp"
+#include "singe/Graphics/Mesh.hpp"
 #include "singe/Graphics/Model.hpp"
 #include "singe/Graphics/Scene.hpp"
 #include "singe/Graphics/Shader.hpp"
+#include "singe/Graphics/Texture.hpp"
+#include "singe/Support/ThreadPool.hpp"
 #include "singe/Support/log.hpp"
 
 namespace singe::Logging {
     extern Logger::Ptr Resource;
 }
 
+namespace singe::scene {
+    struct Scene;
+    class SceneHandler;
+}
+
 namespace singe {
     using std::string;
     using std::map;
     using std::vector;
     using std::shared_ptr;
-    using glpp::Texture;
+    using std::shared_future;
 
     namespace fs = std::filesystem;
 
@@ -34,12 +54,126 @@ namespace singe {
 
     /**
      * Manage path resolution, resource loading and resource caching for re-use.
+     *
+     * Resources can also be loaded asynchronously. File I/O, model parsing and
+     * image decoding run on a ThreadPool and the OpenGL upload is queued for
+     * the thread that owns the context. The game must call
+     * ResourceManager::processUploads() once per frame to finish loading.
+     * All methods must be called from the thread that owns the context.
      */
     class ResourceManager {
+        /**
+         * Meshes and materials of a model file, shared by every Model
+         * created from it.
+         */
+        struct CachedModel {
+            vector<Mesh::Ptr> meshes;
+            /// Points and indices of each mesh, copied into each Model
+            vector<vector<Vertex>> points;
+            vector<vector<unsigned int>> indices;
+            /// Material of each mesh, nullptr if it has none
+            vector<Material::Ptr> materials;
+        };
+
+        /// A loadModelAsync() call for a model that is already loading
+        struct ModelWaiter {
+            std::promise<vector<Model::Ptr>> promise;
+            bool uniqueMaterials;
+        };
+
+        using UploadJob = std::function<void(ResourceManager &)>;
+
+        /**
+         * Upload jobs pushed by workers. Workers only hold the queue so they
+         * never touch the ResourceManager.
+         */
+        struct UploadQueue {
+            std::mutex mutex;
+            std::deque<UploadJob> jobs;
+            /// Number of async loads that have not finished uploading
+            std::atomic<size_t> loading {0};
+            /// The thread that owns the context and runs the jobs
+            std::thread::id owner;
+
+            void push(UploadJob && job);
+        };
+
         fs::path root;
+        fs::path cacheRoot;
+        bool textureCompression;
+        bool packMeshes;
+        VertexFormat::Type vertexFormat;
+        VertexArena::Ptr vertexArena;
         map<string, Texture::Ptr> textures;
-        map<string, Shader::Ptr> shaders;
+        map<string, shared_future<Texture::Ptr>> pendingTextures;
+        /// Keyed by the vertex and fragment paths
+        map<string, ShaderVariants::Ptr> shaderVariants;
         map<string, MVPShader::Ptr> mvpShaders;
+        /// Keyed by the resolved path of the model file
+        map<string, CachedModel> models;
+        /// Keyed like models, for models loading asynchronously
+        map<string, vector<ModelWaiter>> pendingModels;
+        shared_ptr<UploadQueue> uploads;
+        ThreadPool::Ptr pool;
+        ProgramCache::Ptr programCache;
+
+        ThreadPool & workers();
+        ProgramCache & programs();
+
+        bool compressTextures() const;
+
+        static bool prepareTexture(const fs::path & source,
+                                   const fs::path & cooked,
+                                   bool compress,
+                                   CookedTexture & texture);
+
+        /// Prepare a texture on a worker, the result is nullptr on failure
+        std::future<CookedTexture::Ptr> cookTexture(const string & path,
+                                                    bool compress);
+
+        /**
+         * Create a Texture that is deleted on the thread that owns the
+         * context. Async loads hand textures to workers, if a worker drops
+         * the last reference the deletion is queued for processUploads().
+         */
+        Texture::Ptr makeTexture() const;
+
+        static void uploadTexture(Texture & texture,
+                                  const CookedTexture & cooked);
+
+        void loadTextures(const std::set<string> & paths);
+
+        static shared_ptr<scene::Scene> readScene(
+            const fs::path & source,
+            const fs::path & cooked,
+            scene::SceneHandler & handler);
+
+        /**
+         * Link every shader variant used by a scene in one batch, including
+         * the variants for the materials of meshes. This blocks until every
+         * variant is linked, so only loadScene() uses it. loadSceneAsync()
+         * links each variant in it's own upload instead, so
+         * processUploads() can spread them over frames.
+         */
+        void precompileShaders(
+            const shared_ptr<scene::Scene> & scene,
+            const map<string, shared_ptr<CookedMesh>> & meshes);
+
+        static bool prepareMesh(const fs::path & source,
+                                const fs::path & cooked,
+                                CookedMesh & mesh);
+
+        string modelKey(const string & path) const;
+
+        const CachedModel & addModel(const string & key,
+                                     const CookedMesh & mesh,
+                                     bool async);
+
+        static vector<Model::Ptr> instantiate(const CachedModel & cached,
+                                              bool uniqueMaterials);
+
+        template<typename T, typename Prepare, typename Upload>
+        shared_future<T> loadAsync(Prepare && prepare, Upload && upload);
 
     public:
         /**
@@ -82,66 +216,368 @@ namespace singe {
         fs::path resourceAt(const fs::path & subPath) const;
 
         /**
-         * Load a glpp::Texture or return the cached texture if it exists.
+         * Update the directory cooked resources are written to. An empty path
+         * disables cooking, which is the default, as the resource directory
+         * may be read-only.
+         *
+         * @param cacheRoot the new cache directory
+         */
+        void setCacheRoot(const fs::path & cacheRoot);
+
+        /**
+         * Get the directory cooked resources are written to.
+         *
+         * @return the cache directory, empty if cooking is disabled
+         */
+        const fs::path & getCacheRoot() const;
+
+        /**
+         * Resolve the path of the cooked file for a resource.
+         *
+         * @param subPath relative path to the resource
+         * @param extension the extension appended to the cooked file
+         *
+         * @return the absolute path to the cooked file, empty if cooking is
+         *         disabled
+         */
+        fs::path cacheAt(const fs::path & subPath,
+                         const string & extension) const;
+
+        /**
+         * Set the ThreadPool used for async loading. If no pool is set, one
+         * is created on the first async load.
+         *
+         * @param pool the ThreadPool
+         */
+        void setThreadPool(ThreadPool::Ptr pool);
+
+        /**
+         * Get the ThreadPool used for async loading.
+         *
+         * @return the ThreadPool or nullptr if there is none yet
+         */
+        ThreadPool::Ptr getThreadPool() const;
+
+        /**
+         * Enable or disable compressing cooked textures. When enabled and the
+         * context supports S3TC, textures are compressed to BC1 or BC3,
+         * otherwise they are kept as RGBA8. The encoder is fast but lossy, so
+         * the default is disabled.
+         *
+         * @param compress should textures be compressed
+         */
+        void setTextureCompression(bool compress);
+
+        /**
+         * Is compressing cooked textures enabled.
+         *
+         * @return true if textures are compressed when supported
+         */
+        bool getTextureCompression() const;
+
+        /**
+         * Enable or disable placing the meshes of loaded models in one shared
+         * VertexArena, so RenderQueue can draw them with multi draw calls.
+         * Only models loaded after this call are affected. The default is
+         * disabled.
+         *
+         * Multi draw calls need a shader that reads the SingeDrawList block,
+         * see UniformBlock. While this is enabled, scenes use the shader
+         * variant with UniformBlock::DrawListDefine if the sources check for
+         * it, as the shipped default.vert and instanced.vert do. Other
+         * shaders are drawn one model at a time.
+         *
+         * @param pack should meshes be placed in the VertexArena
+         */
+        void setPackMeshes(bool pack);
+
+        /**
+         * Is placing meshes in the shared VertexArena enabled.
+         *
+         * @return true if meshes are packed
+         */
+        bool getPackMeshes() const;
+
+        /**
+         * Set the layout the meshes of loaded models are buffered in, see
+         * VertexFormat. Only models loaded after this call are affected. The
+         * default is VertexFormat::Float.
+         *
+         * @param type the vertex layout
+         */
+        void setVertexFormat(VertexFormat::Type type);
+
+        /**
+         * Get the layout the meshes of loaded models are buffered in.
+         *
+         * @return the vertex layout
+         */
+        VertexFormat::Type getVertexFormat() const;
+
+        /**
+         * Get the VertexArena new meshes of the current format are placed in.
+         *
+         * @return the VertexArena or nullptr if no mesh has been packed yet
+         */
+        const VertexArena::Ptr & getVertexArena() const;
+
+        /**
+         * Load a Texture or return the cached texture if it exists.
+         *
+         * The mip chain is built when the image is cooked and uploaded as is.
+         * The cooked texture is written to the cache and re-used while the
+         * image file has the same size and modification time.
          *
          * If useCached is false, the loaded texture will not be added to the
-         * cache.
+         * cache. If the cached texture is still being loaded asynchronously
+         * it is finished now.
          *
          * @param path the texture path relative to resource root
          * @param useCached should a cached version be returned if present
          *
-         * @return shared_ptr to the glpp::Texture
+         * @return shared_ptr to the Texture
+         *
+         * @throws ResourceLoadException if the image can not be decoded
          */
         Texture::Ptr getTexture(const string & path, bool useCached = true);
 
+        /**
+         * Load a Texture asynchronously. The image is cooked or loaded from
+         * the cache on a worker and uploaded by processUploads().
+         *
+         * The Texture is added to the cache right away, without an image, so
+         * it can be used by materials before it has finished loading.
+         *
+         * @param path the texture path relative to resource root
+         *
+         * @return future for the Texture, holds a ResourceLoadException if the
+         *         image can not be decoded
+         */
+        shared_future<Texture::Ptr> getTextureAsync(const string & path);
+
+        /**
+         * Pack the albedo textures of materials into TextureArrays.
+         *
+         * Textures with the same size and format are uploaded as layers of
+         * one array. Each material that uses a packed texture gets the array
+         * and layer in Material::textureArray and Material::textureLayer, and
+         * it's shader is replaced by the variant with
+         * Material::TextureArrayDefine, see getShaderVariant(const
+         * Shader::Ptr &, const vector<string> &). Material::texture is then
+         * cleared. A material without such a variant, including one whose
+         * shader was not loaded by this ResourceManager, is left unchanged
+         * and it's texture is not packed for it.
+         *
+         * Only textures loaded by this ResourceManager and used by a material
+         * that can switch are packed, groups with a single texture are left
+         * as they are. A packed texture is
+         * removed from the texture cache once every material in materials
+         * that used it samples the array, so it is freed when no other
+         * material holds it.
+         *
+         * @param materials the materials to pack
+         *
+         * @return the number of TextureArrays created
+         */
+        size_t packTextures(const vector<Material::Ptr> & materials);
+
+        /**
+         * Pack the albedo textures of all materials in scene and it's
+         * children, see packTextures(const vector<Material::Ptr> &).
+         *
+         * @param scene the Scene to pack
+         *
+         * @return the number of TextureArrays created
+         */
+        size_t packTextures(const Scene & scene);
+
         /**
          * Load a Shader or return the cached shader if it exists.
          *
          * If useCached is false, the loaded shader will not be added to the
          * cache.
          *
+         * The linked program binary is kept in the programs directory of the
+         * cache directory and used instead of compiling the sources while
+         * they and the driver do not change, see ProgramCache.
+         *
          * @param vertPath the vertex shader path relative to resource root
          * @param fragPath the fragment shader path relative to resource root
          * @param useCached should a cached version be returned if present
          *
          * @return shared_ptr to the Shader
+         *
+         * @throws ResourceLoadException if a source can not be read or the
+         *         program fails to compile or link
          */
         Shader::Ptr getShader(const string & vertPath,
                               const string & fragPath,
                               bool useCached = true);
 
+        /**
+         * Get the ShaderVariants of a pair of sources. The sources are read
+         * once and the ShaderVariants is cached.
+         *
+         * @param vertPath the vertex shader path relative to resource root
+         * @param fragPath the fragment shader path relative to resource root
+         *
+         * @return shared_ptr to the ShaderVariants
+         *
+         * @throws ResourceLoadException if a source can not be read
+         */
+        ShaderVariants::Ptr getShaderVariants(const string & vertPath,
+                                              const string & fragPath);
+
+        /**
+         * Load the variant of a Shader with a set of defines, see
+         * ShaderVariants. With no defines this is the same Shader as
+         * getShader() returns.
+         *
+         * @param vertPath the vertex shader path relative to resource root
+         * @param fragPath the fragment shader path relative to resource root
+         * @param defines the define keys of the variant
+         *
+         * @return shared_ptr to the Shader
+         *
+         * @throws ResourceLoadException if a source can not be read or the
+         *         variant fails to compile or link
+         */
+        Shader::Ptr getShaderVariant(const string & vertPath,
+                                     const string & fragPath,
+                                     const vector<string> & defines);
+
+        /**
+         * Load the variant of a Shader with more defines. The Shader must be
+         * a variant loaded by this ResourceManager.
+         *
+         * @param shader the Shader to extend
+         * @param defines the define keys to add to the keys of shader
+         *
+         * @return shared_ptr to the Shader, nullptr if shader was not loaded
+         *         by this ResourceManager or it's sources do not check for
+         *         every define, see ShaderVariants::uses()
+         *
+         * @throws ResourceLoadException if the variant fails to compile or
+         *         link
+         */
+        Shader::Ptr getShaderVariant(const Shader::Ptr & shader,
+                                     const vector<string> & defines);
+
         /**
          * Load an MVPShader or return the cached shader if it exists.
          *
          * If useCached is false, the loaded shader will not be added to the
          * cache.
          *
+         * The linked program binary is kept in the programs directory of the
+         * cache directory and used instead of compiling the sources while
+         * they and the driver do not change, see ProgramCache.
+         *
          * @param vertPath the vertex shader path relative to resource root
          * @param fragPath the fragment shader path relative to resource root
          * @param useCached should a cached version be returned if present
          *
          * @return shared_ptr to the MVPShader
+         *
+         * @throws ResourceLoadException if a source can not be read or the
+         *         program fails to compile or link
          */
         MVPShader::Ptr getMVPShader(const string & vertPath,
                                     const string & fragPath,
                                     bool useCached = true);
 
         /**
-         * Load a model.
+         * Load a model or create new models from the cached meshes if the
+         * file was loaded before.
+         *
+         * The parsed and welded mesh is written to a CookedMesh file in the
+         * cache directory and later loads read the cooked file instead of
+         * parsing the model again, as long as the source has not changed.
+         *
+         * Every call returns new Model instances with their own transform.
+         * The Mesh of each model is shared with all other models loaded from
+         * the same file. The materials are also shared unless uniqueMaterials
+         * is true, in which case the models get copies that can be changed
+         * without affecting other models.
          *
          * @param path the model path relative to resource root
+         * @param uniqueMaterials should the models get their own materials
          *
          * @return vector of models
          */
-        vector<Model::Ptr> loadModel(const string & path);
+        vector<Model::Ptr> loadModel(const string & path,
+                                     bool uniqueMaterials = false);
+
+        /**
+         * Load a model asynchronously. The model is parsed or read from the
+         * cooked file on a worker and uploaded by processUploads().
+         *
+         * The future is ready once the meshes are uploaded, the material
+         * textures are loaded with getTextureAsync() and may still be
+         * loading. A model that is already loading is not read again, every
+         * caller gets it's own models once the load finishes.
+         *
+         * @param path the model path relative to resource root
+         * @param uniqueMaterials should the models get their own materials,
+         *                        see loadModel()
+         *
+         * @return future for the vector of models
+         */
+        shared_future<vector<Model::Ptr>> loadModelAsync(
+            const string & path, bool uniqueMaterials = false);
 
         /**
          * Load a scene.
          *
+         * The unique meshes and textures referenced by the scene are loaded
+         * once each in parallel on the ThreadPool before the Scene is built.
+         * Each model in the scene gets it's own materials since the scene
+         * sets their shader. The variant of each model's shader adds the
+         * Material::getDefines() of it's material that the sources check
+         * for. Every shader variant the scene uses is linked in one batch
+         * before the Scene is built, see getShaderVariant().
+         *
+         * The path may be an XML scene or a scene::BinaryScene. An XML scene
+         * is written to a binary scene in the cache directory and later loads
+         * map the binary scene instead of parsing the XML again, as long as
+         * the XML file has not changed.
+         *
          * @param path the scene path relative to resource root
          *
          * @return shared_ptr to the Scene
          */
         Scene::Ptr loadScene(const string & path);
+
+        /**
+         * Load a scene asynchronously. The scene file, all of it's models and
+         * shader sources are read on a worker. processUploads() then links
+         * each shader variant and uploads each model as a separate job so the
+         * uploads are spread over frames.
+         *
+         * @param path the scene path relative to resource root
+         *
+         * @return future for the Scene, holds the exception if the scene can
+         *         not be loaded
+         */
+        shared_future<Scene::Ptr> loadSceneAsync(const string & path);
+
+        /**
+         * Run queued uploads until budget is used. At least one upload is run
+         * so loading always makes progress. This must be called from the
+         * thread that owns the OpenGL context, ie. once per frame in
+         * GameBase::onUpdate().
+         *
+         * @param budget the time to spend on uploads
+         *
+         * @return the number of uploads that were run
+         */
+        size_t processUploads(std::chrono::microseconds budget);
+
+        /**
+         * Get the number of async loads that have not finished.
+         *
+         * @return the number of loads still on a worker or waiting to upload
+         */
+        size_t pendingLoads() const;
     };
 }
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "singe/Core/ProgramCache.hpp"
+#include "singe/Graphics/Shader.hpp"
+
+namespace singe {
+    using std::map;
+    using std::shared_ptr;
+    using std::string;
+    using std::vector;
+
+    /**
+     * Permutations of a pair of shader sources selected by preprocessor
+     * defines.
+     *
+     * Every define key gets a bit in a Mask the first time it is used. The
+     * variant for a Mask is the sources with `#define KEY` inserted after the
+     * `#version` line for each bit that is set, so features can be compiled
+     * out instead of branching on a uniform. Mask 0 is the sources as they
+     * are. The defines are inserted in name order, so the sources of a
+     * variant and it's program binary do not depend on the order the keys
+     * were first used in.
+     *
+     * Variants are linked with a ProgramCache the first time they are used
+     * and kept for the lifetime of the ShaderVariants. Use
+     * ShaderVariants::precompile() to link the variants of many sources at
+     * once.
+     *
+     * Material features such as a normal map or a TextureArray are selected
+     * with the defines in Material, only sources that check for a define
+     * get a variant for it, see ShaderVariants::uses().
+     */
+    class ShaderVariants {
+    public:
+        using Ptr = shared_ptr<ShaderVariants>;
+        using ConstPtr = const shared_ptr<ShaderVariants>;
+
+        using Mask = uint32_t;
+
+        /// Maximum number of define keys
+        static constexpr size_t MaxKeys = 32;
+
+    private:
+        string vertexSource;
+        string fragmentSource;
+        string name;
+        vector<string> keys;
+        map<Mask, Shader::Ptr> variants;
+
+    public:
+        /**
+         * Create the variants of a pair of sources. Nothing is compiled until
+         * a variant is requested.
+         *
+         * @param vertexSource the vertex shader source
+         * @param fragmentSource the fragment shader source
+         * @param name the name used in log and error messages
+         */
+        ShaderVariants(const string & vertexSource,
+                       const string & fragmentSource,
+                       const string & name);
+
+        /// @brief  Move constructor
+        ShaderVariants(ShaderVariants && other);
+
+        /// @brief  Move assignment
+        ShaderVariants & operator=(ShaderVariants && other);
+
+        ShaderVariants(const ShaderVariants &) = delete;
+        ShaderVariants & operator=(const ShaderVariants &) = delete;
+
+        ~ShaderVariants();
+
+        /**
+         * Get the Mask for a set of defines. Keys that have not been used
+         * before are given the next free bit.
+         *
+         * @param defines the define keys
+         *
+         * @return the Mask with a bit set for each key in defines
+         *
+         * @throws ResourceLoadException if there are more than MaxKeys keys
+         */
+        Mask getMask(const vector<string> & defines);
+
+        /**
+         * Do the sources check for a define.
+         *
+         * @param define the define key
+         *
+         * @return true if define appears in either source as a whole
+         *         identifier, ie. SINGE_A does not match SINGE_AB
+         */
+        bool uses(const string & define) const;
+
+        /**
+         * Get the keys in bit order.
+         *
+         * @return the define keys
+         */
+        const vector<string> & getKeys() const;
+
+        /**
+         * Generate the sources of a variant.
+         *
+         * @param mask the variant Mask
+         *
+         * @return the sources with the defines of mask inserted
+         */
+        ProgramCache::Sources getSources(Mask mask) const;
+
+        /**
+         * Get a variant if it has already been linked.
+         *
+         * @param mask the variant Mask
+         *
+         * @return the Shader or nullptr if it has not been linked
+         */
+        Shader::Ptr find(Mask mask) const;
+
+        /**
+         * Find the Mask of a variant that has been linked.
+         *
+         * @param shader the Shader to look for
+         * @param mask set to the Mask of shader
+         *
+         * @return false if shader is not a variant of these sources
+         */
+        bool findMask(const Shader & shader, Mask & mask) const;
+
+        /**
+         * Get a variant, linking it if it is not already linked.
+         *
+         * @param mask the variant Mask
+         * @param programs the ProgramCache used to link the variant
+         *
+         * @return the Shader for mask
+         *
+         * @throws ResourceLoadException if the variant fails to compile or
+         *         link
+         */
+        Shader::Ptr get(Mask mask, const ProgramCache & programs);
+
+        /**
+         * Link every variant in requests that is not already linked with a
+         * single call to ProgramCache::linkAll(). A variant that fails to
+         * compile or link is logged and left unlinked, so
+         * ShaderVariants::get() reports the error if it is used.
+         *
+         * All variants are linked in one call, which can take several
+         * frames. Code that loads while rendering should link each variant
+         * with ShaderVariants::get() from it's own upload instead.
+         *
+         * @param requests pairs of ShaderVariants and the Mask of a variant
+         * @param programs the ProgramCache used to link the variants
+         *
+         * @return the number of variants that were linked
+         */
+        static size_t precompile(const vector<std::pair<Ptr, Mask>> & requests,
+                                 const ProgramCache & programs);
+    };
+}
@@ -0,0 +1,338 @@
+#include "singe/Core/CookedMesh.hpp"
+
+#include <Wavefront.hpp>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <singe/Support/CacheFile.hpp>
+#include <singe/Support/Util.hpp>
+#include <sstream>
+
+#include "singe/Core/ResourceManager.hpp"
+#include "singe/Graphics/Model.hpp"
+
+namespace singe {
+    using std::move;
+
+    namespace {
+        constexpr char Magic[4] = {'S', 'G', 'M', 'C'};
+        constexpr size_t BlobAlignment = 16;
+
+        struct FileHeader {
+            char magic[4];
+            uint32_t version;
+            SourceStamp source;
+            uint32_t libraryCount;
+            uint32_t materialCount;
+            uint32_t objectCount;
+            uint64_t blobOffset;
+        };
+
+        /// The .obj followed by it's material libraries
+        vector<fs::path> sourceFiles(const fs::path & source,
+                                     const vector<string> & libraries) {
+            vector<fs::path> files {source};
+            for (auto & library : libraries)
+                files.push_back(source.parent_path() / library);
+            return files;
+        }
+
+        /// Names listed by the mtllib statements of a .obj file
+        vector<string> findLibraries(const fs::path & source) {
+            vector<string> libraries;
+            std::ifstream is(source);
+            string line;
+            while (std::getline(is, line)) {
+                std::istringstream tokens(line);
+                string keyword, name;
+                tokens >> keyword;
+                if (keyword != "mtllib")
+                    continue;
+                while (tokens >> name) libraries.push_back(name);
+            }
+            return libraries;
+        }
+
+        class Writer {
+            vector<uint8_t> & out;
+
+        public:
+            Writer(vector<uint8_t> & out) : out(out) {}
+
+            void write(const void * data, size_t size) {
+                auto * bytes = static_cast<const uint8_t *>(data);
+                out.insert(out.end(), bytes, bytes + size);
+            }
+
+            template<typename T>
+            void write(const T & value) {
+                write(&value, sizeof(T));
+            }
+
+            void write(const string & value) {
+                write<uint32_t>(value.size());
+                write(value.data(), value.size());
+            }
+        };
+
+        class Reader {
+            const uint8_t * cursor;
+            const uint8_t * end;
+
+        public:
+            Reader(const uint8_t * data, size_t size)
+                : cursor(data), end(data + size) {}
+
+            bool read(void * data, size_t size) {
+                if (size > size_t(end - cursor))
+                    return false;
+                std::memcpy(data, cursor, size);
+                cursor += size;
+                return true;
+            }
+
+            template<typename T>
+            bool read(T & value) {
+                return read(&value, sizeof(T));
+            }
+
+            bool read(string & value) {
+                uint32_t size;
+                if (!read(size) || size > size_t(end - cursor))
+                    return false;
+                value.assign(reinterpret_cast<const char *>(cursor), size);
+                cursor += size;
+                return true;
+            }
+        };
+    }
+
+    CookedMesh::CookedMesh() {}
+
+    CookedMesh::CookedMesh(CookedMesh && other)
+        : materials(move(other.materials)),
+          objects(move(other.objects)),
+          file(move(other.file)),
+          libraries(move(other.libraries)),
+          vertexStorage(move(other.vertexStorage)),
+          indexStorage(move(other.indexStorage)) {}
+
+    CookedMesh & CookedMesh::operator=(CookedMesh && other) {
+        materials = move(other.materials);
+        objects = move(other.objects);
+        file = move(other.file);
+        libraries = move(other.libraries);
+        vertexStorage = move(other.vertexStorage);
+        indexStorage = move(other.indexStorage);
+        return *this;
+    }
+
+    CookedMesh::~CookedMesh() {}
+
+    bool CookedMesh::cook(const fs::path & source) {
+        Logging::Resource->debug("Cooking mesh {}", source.c_str());
+
+        wavefront::Model wfModel;
+        wfModel.loadModelFrom(source);
+
+        materials.clear();
+        objects.clear();
+        file = MappedFile();
+        libraries = findLibraries(source);
+        vertexStorage.clear();
+        indexStorage.clear();
+
+        if (wfModel.objects.empty())
+            return false;
+
+        for (auto & mat : wfModel.materials) {
+            auto & material = materials.emplace_back();
+            material.name = mat->name;
+            material.ambient = mat->colAmbient;
+            material.diffuse = mat->colDiffuse;
+            material.specular = mat->colSpecular;
+            material.specExp = mat->specExp;
+            material.alpha = mat->alpha;
+            material.texture = mat->texAlbedo;
+            material.normalTexture = mat->texNormal;
+            material.specularTexture = mat->texSpecular;
+        }
+
+        vertexStorage.reserve(wfModel.objects.size());
+        indexStorage.reserve(wfModel.objects.size());
+
+        for (auto & obj : wfModel.objects) {
+            auto & points = vertexStorage.emplace_back();
+            points.reserve(obj->size());
+            for (size_t i = 0; i < obj->size(); i++) {
+                points.emplace_back(obj->vertices[i], obj->normals[i],
+                                    obj->texcoords[i]);
+            }
+
+            vector<unsigned int> welded;
+            Model::weld(points, welded);
+            auto & indices =
+                indexStorage.emplace_back(welded.begin(), welded.end());
+
+            auto & object = objects.emplace_back();
+            object.name = obj->name;
+            object.materialId = obj->matId;
+            object.vertices = points.data();
+            object.vertexCount = points.size();
+            object.indices = indices.data();
+            object.indexCount = indices.size();
+        }
+
+        return true;
+    }
+
+    bool CookedMesh::load(const fs::path & cooked, const fs::path & source) {
+        MappedFile mapped(cooked);
+        if (!mapped.isOpen())
+            return false;
+
+        Reader reader(mapped.data(), mapped.size());
+
+        FileHeader header;
+        if (!reader.read(header)
+            || std::memcmp(header.magic, Magic, sizeof(Magic)) != 0
+            || header.version != Version) {
+            Logging::Resource->debug("Cooked mesh {} is invalid",
+                                     cooked.c_str());
+            return false;
+        }
+
+        // Every record is at least 4 bytes so larger counts are corrupt
+        if (header.blobOffset > mapped.size()
+            || header.libraryCount > mapped.size() / 4
+            || header.materialCount > mapped.size() / 4
+            || header.objectCount > mapped.size() / 4)
+            return false;
+
+        vector<string> libraries(header.libraryCount);
+        for (auto & library : libraries) {
+            if (!reader.read(library))
+                return false;
+        }
+
+        if (!checkSources(cooked, offsetof(FileHeader, source), header.source,
+                          sourceFiles(source, libraries)))
+            return false;
+
+        vector<Material> materials(header.materialCount);
+        for (auto & material : materials) {
+            if (!reader.read(material.name) || !reader.read(material.ambient)
+                || !reader.read(material.diffuse)
+                || !reader.read(material.specular)
+                || !reader.read(material.specExp) || !reader.read(material.alpha)
+                || !reader.read(material.texture)
+                || !reader.read(material.normalTexture)
+                || !reader.read(material.specularTexture))
+                return false;
+        }
+
+        const uint8_t * blobs = mapped.data() + header.blobOffset;
+        size_t blobSize = mapped.size() - header.blobOffset;
+
+        vector<Object> objects(header.objectCount);
+        for (auto & object : objects) {
+            uint64_t vertexCount, indexCount, vertexOffset, indexOffset;
+            if (!reader.read(object.name) || !reader.read(object.materialId)
+                || !reader.read(vertexCount) || !reader.read(indexCount)
+                || !reader.read(vertexOffset) || !reader.read(indexOffset))
+                return false;
+
+            if (vertexOffset > blobSize
+                || vertexCount > (blobSize - vertexOffset) / sizeof(Vertex)
+                || indexOffset > blobSize
+                || indexCount > (blobSize - indexOffset) / sizeof(uint32_t))
+                return false;
+
+            object.vertices =
+                reinterpret_cast<const Vertex *>(blobs + vertexOffset);
+            object.vertexCount = vertexCount;
+            object.indices =
+                reinterpret_cast<const uint32_t *>(blobs + indexOffset);
+            object.indexCount = indexCount;
+        }
+
+        this->materials = move(materials);
+        this->objects = move(objects);
+        this->libraries = move(libraries);
+        file = move(mapped);
+        vertexStorage.clear();
+        indexStorage.clear();
+        return true;
+    }
+
+    bool CookedMesh::save(const fs::path & cooked, const fs::path & source) const {
+        SourceStamp stamp;
+        if (!stampSources(sourceFiles(source, libraries), stamp))
+            return false;
+
+        vector<uint8_t> table;
+        Writer writer(table);
+
+        for (auto & library : libraries) writer.write(library);
+
+        for (auto & material : materials) {
+            writer.write(material.name);
+            writer.write(material.ambient);
+            writer.write(material.diffuse);
+            writer.write(material.specular);
+            writer.write(material.specExp);
+            writer.write(material.alpha);
+            writer.write(material.texture);
+            writer.write(material.normalTexture);
+            writer.write(material.specularTexture);
+        }
+
+        uint64_t blobSize = 0;
+        for (auto & object : objects) {
+            uint64_t vertexOffset = blobSize;
+            blobSize = alignUp(blobSize + object.vertexCount * sizeof(Vertex),
+                               BlobAlignment);
+            uint64_t indexOffset = blobSize;
+            blobSize = alignUp(blobSize + object.indexCount * sizeof(uint32_t),
+                               BlobAlignment);
+
+            writer.write(object.name);
+            writer.write(object.materialId);
+            writer.write<uint64_t>(object.vertexCount);
+            writer.write<uint64_t>(object.indexCount);
+            writer.write(vertexOffset);
+            writer.write(indexOffset);
+        }
+
+        FileHeader header;
+        std::memcpy(header.magic, Magic, sizeof(Magic));
+        header.version = Version;
+        header.source = stamp;
+        header.libraryCount = libraries.size();
+        header.materialCount = materials.size();
+        header.objectCount = objects.size();
+        header.blobOffset =
+            alignUp(sizeof(FileHeader) + table.size(), BlobAlignment);
+
+        vector<uint8_t> out;
+        out.reserve(header.blobOffset + blobSize);
+        Writer(out).write(header);
+        out.insert(out.end(), table.begin(), table.end());
+        out.resize(header.blobOffset, 0);
+
+        for (auto & object : objects) {
+            Writer(out).write(object.vertices,
+                              object.vertexCount * sizeof(Vertex));
+            out.resize(alignUp(out.size(), BlobAlignment), 0);
+            Writer(out).write(object.indices,
+                              object.indexCount * sizeof(uint32_t));
+            out.resize(alignUp(out.size(), BlobAlignment), 0);
+        }
+
+        if (!writeCacheFile(cooked, out.data(), out.size()))
+            return false;
+
+        Logging::Resource->debug("Wrote cooked mesh {}", cooked.c_str());
+        return true;
+    }
+}
@@ -0,0 +1,382 @@
+#include "singe/Core/CookedTexture.hpp"
+
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <singe/Support/CacheFile.hpp>
+#include <singe/Support/Util.hpp>
+
+#include "singe/Core/ResourceManager.hpp"
+
+namespace singe {
+    using std::move;
+
+    namespace {
+        constexpr char Magic[4] = {'S', 'G', 'T', 'C'};
+        constexpr size_t LevelAlignment = 16;
+
+        struct FileHeader {
+            char magic[4];
+            uint32_t version;
+            SourceStamp source;
+            uint32_t format;
+            uint32_t levelCount;
+        };
+
+        struct LevelRecord {
+            uint32_t width;
+            uint32_t height;
+            uint64_t offset;
+            uint64_t size;
+        };
+
+        bool validFormat(GLenum format) {
+            return format == GL_RGBA8
+                   || format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+                   || format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        }
+
+        size_t levelSize(GLenum format, unsigned width, unsigned height) {
+            size_t block = Texture::blockSize(format);
+            if (block == 0)
+                return size_t(width) * height * 4;
+            return size_t((width + 3) / 4) * ((height + 3) / 4) * block;
+        }
+
+        /// Half size RGBA8 image with a 2x2 box filter
+        vector<uint8_t> downsample(const vector<uint8_t> & pixels,
+                                   unsigned width,
+                                   unsigned height) {
+            unsigned halfWidth = std::max(1u, width / 2);
+            unsigned halfHeight = std::max(1u, height / 2);
+            vector<uint8_t> half(size_t(halfWidth) * halfHeight * 4);
+
+            auto at = [&](unsigned x, unsigned y) {
+                return &pixels[(size_t(y) * width + x) * 4];
+            };
+
+            uint8_t * out = half.data();
+            for (unsigned y = 0; y < halfHeight; y++) {
+                unsigned y0 = std::min(y * 2, height - 1);
+                unsigned y1 = std::min(y * 2 + 1, height - 1);
+                for (unsigned x = 0; x < halfWidth; x++) {
+                    unsigned x0 = std::min(x * 2, width - 1);
+                    unsigned x1 = std::min(x * 2 + 1, width - 1);
+                    for (unsigned c = 0; c < 4; c++) {
+                        unsigned sum = at(x0, y0)[c] + at(x1, y0)[c]
+                                       + at(x0, y1)[c] + at(x1, y1)[c];
+                        *out++ = (sum + 2) / 4;
+                    }
+                }
+            }
+            return half;
+        }
+
+        uint16_t pack565(const int (&color)[3]) {
+            return ((color[0] >> 3) << 11) | ((color[1] >> 2) << 5)
+                   | (color[2] >> 3);
+        }
+
+        void unpack565(uint16_t packed, int (&color)[3]) {
+            int r = (packed >> 11) & 0x1f;
+            int g = (packed >> 5) & 0x3f;
+            int b = packed & 0x1f;
+            color[0] = (r << 3) | (r >> 2);
+            color[1] = (g << 2) | (g >> 4);
+            color[2] = (b << 3) | (b >> 2);
+        }
+
+        /**
+         * Encode the colors of a 4x4 block as BC1 with the block bounding box
+         * as the end points. Always uses the 4 color mode.
+         */
+        void encodeColor(const uint8_t (&block)[16][4], uint8_t * out) {
+            int low[3] = {255, 255, 255};
+            int high[3] = {0, 0, 0};
+            for (auto & pixel : block) {
+                for (int c = 0; c < 3; c++) {
+                    low[c] = std::min(low[c], int(pixel[c]));
+                    high[c] = std::max(high[c], int(pixel[c]));
+                }
+            }
+            // Inset the box so the end points are not biased by outliers
+            for (int c = 0; c < 3; c++) {
+                int inset = (high[c] - low[c]) / 16;
+                low[c] += inset;
+                high[c] -= inset;
+            }
+
+            uint16_t color0 = pack565(high);
+            uint16_t color1 = pack565(low);
+            if (color0 < color1)
+                std::swap(color0, color1);
+
+            uint32_t indices = 0;
+            if (color0 != color1) {
+                int palette[4][3];
+                unpack565(color0, palette[0]);
+                unpack565(color1, palette[1]);
+                for (int c = 0; c < 3; c++) {
+                    palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+                    palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+                }
+
+                for (int i = 0; i < 16; i++) {
+                    int best = 0;
+                    int bestDistance = 1 << 30;
+                    for (int j = 0; j < 4; j++) {
+                        int distance = 0;
+                        for (int c = 0; c < 3; c++) {
+                            int d = int(block[i][c]) - palette[j][c];
+                            distance += d * d;
+                        }
+                        if (distance < bestDistance) {
+                            best = j;
+                            bestDistance = distance;
+                        }
+                    }
+                    indices |= uint32_t(best) << (i * 2);
+                }
+            }
+
+            out[0] = color0 & 0xff;
+            out[1] = color0 >> 8;
+            out[2] = color1 & 0xff;
+            out[3] = color1 >> 8;
+            for (int i = 0; i < 4; i++) {
+                out[4 + i] = (indices >> (i * 8)) & 0xff;
+            }
+        }
+
+        /**
+         * Encode the alpha of a 4x4 block as a BC3 alpha block using the 8
+         * value mode.
+         */
+        void encodeAlpha(const uint8_t (&block)[16][4], uint8_t * out) {
+            int alpha0 = 0;
+            int alpha1 = 255;
+            for (auto & pixel : block) {
+                alpha0 = std::max(alpha0, int(pixel[3]));
+                alpha1 = std::min(alpha1, int(pixel[3]));
+            }
+
+            uint64_t indices = 0;
+            if (alpha0 != alpha1) {
+                int palette[8] = {alpha0, alpha1};
+                for (int j = 1; j < 7; j++)
+                    palette[j + 1] = ((7 - j) * alpha0 + j * alpha1) / 7;
+
+                for (int i = 0; i < 16; i++) {
+                    int best = 0;
+                    for (int j = 1; j < 8; j++) {
+                        if (std::abs(block[i][3] - palette[j])
+                            < std::abs(block[i][3] - palette[best]))
+                            best = j;
+                    }
+                    indices |= uint64_t(best) << (i * 3);
+                }
+            }
+
+            out[0] = alpha0;
+            out[1] = alpha1;
+            for (int i = 0; i < 6; i++) {
+                out[2 + i] = (indices >> (i * 8)) & 0xff;
+            }
+        }
+    }
+
+    CookedTexture::CookedTexture() : format(GL_RGBA8) {}
+
+    CookedTexture::CookedTexture(CookedTexture && other)
+        : format(other.format),
+          levels(move(other.levels)),
+          file(move(other.file)),
+          levelStorage(move(other.levelStorage)) {}
+
+    CookedTexture & CookedTexture::operator=(CookedTexture && other) {
+        format = other.format;
+        levels = move(other.levels);
+        file = move(other.file);
+        levelStorage = move(other.levelStorage);
+        return *this;
+    }
+
+    CookedTexture::~CookedTexture() {}
+
+    bool CookedTexture::cook(const fs::path & source, bool compress) {
+        Logging::Resource->debug("Cooking texture {}", source.c_str());
+
+        levels.clear();
+        file = MappedFile();
+        levelStorage.clear();
+
+        sf::Image image;
+        if (!image.loadFromFile(source.string())) {
+            Logging::Resource->error("Failed to decode image {}",
+                                     source.c_str());
+            return false;
+        }
+        // OpenGL expects the first row at the bottom of the texture
+        image.flipVertically();
+
+        unsigned width = image.getSize().x;
+        unsigned height = image.getSize().y;
+        const uint8_t * decoded = image.getPixelsPtr();
+        vector<uint8_t> pixels(decoded, decoded + size_t(width) * height * 4);
+
+        format = GL_RGBA8;
+        if (compress) {
+            bool opaque = true;
+            for (size_t i = 3; i < pixels.size() && opaque; i += 4)
+                opaque = pixels[i] == 255;
+            format = opaque ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+                            : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        }
+
+        for (;;) {
+            if (format == GL_RGBA8)
+                levelStorage.emplace_back(pixels);
+            else
+                levelStorage.emplace_back(
+                    compressLevel(pixels, width, height, format));
+            auto & data = levelStorage.back();
+            levels.push_back({width, height, data.data(), data.size()});
+
+            if (width == 1 && height == 1)
+                break;
+            pixels = downsample(pixels, width, height);
+            width = std::max(1u, width / 2);
+            height = std::max(1u, height / 2);
+        }
+
+        return true;
+    }
+
+    bool CookedTexture::load(const fs::path & cooked,
+                             const fs::path & source) {
+        MappedFile mapped(cooked);
+        if (!mapped.isOpen() || mapped.size() < sizeof(FileHeader))
+            return false;
+
+        FileHeader header;
+        std::memcpy(&header, mapped.data(), sizeof(header));
+        if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0
+            || header.version != Version || !validFormat(header.format)) {
+            Logging::Resource->debug("Cooked texture {} is invalid",
+                                     cooked.c_str());
+            return false;
+        }
+
+        if (!checkSources(cooked, offsetof(FileHeader, source), header.source,
+                          {source}))
+            return false;
+
+        size_t tableEnd = sizeof(FileHeader)
+                          + size_t(header.levelCount) * sizeof(LevelRecord);
+        if (header.levelCount == 0 || header.levelCount > 32
+            || tableEnd > mapped.size())
+            return false;
+
+        vector<Texture::Level> levels;
+        for (uint32_t i = 0; i < header.levelCount; i++) {
+            LevelRecord record;
+            std::memcpy(&record,
+                        mapped.data() + sizeof(FileHeader)
+                            + i * sizeof(LevelRecord),
+                        sizeof(record));
+            if (record.offset > mapped.size()
+                || record.size > mapped.size() - record.offset
+                || record.size
+                       != levelSize(header.format, record.width,
+                                    record.height))
+                return false;
+            levels.push_back({record.width, record.height,
+                              mapped.data() + record.offset, record.size});
+        }
+
+        format = header.format;
+        this->levels = move(levels);
+        file = move(mapped);
+        levelStorage.clear();
+        return true;
+    }
+
+    bool CookedTexture::save(const fs::path & cooked,
+                             const fs::path & source) const {
+        FileHeader header;
+        if (!stampSources({source}, header.source))
+            return false;
+
+        std::memcpy(header.magic, Magic, sizeof(Magic));
+        header.version = Version;
+        header.format = format;
+        header.levelCount = levels.size();
+
+        vector<LevelRecord> records;
+        uint64_t offset = alignUp(sizeof(FileHeader)
+                                      + levels.size() * sizeof(LevelRecord),
+                                  LevelAlignment);
+        for (auto & level : levels) {
+            records.push_back({level.width, level.height, offset, level.size});
+            offset = alignUp(offset + level.size, LevelAlignment);
+        }
+
+        vector<uint8_t> out;
+        out.reserve(offset);
+        auto write = [&](const void * data, size_t size) {
+            auto * bytes = static_cast<const uint8_t *>(data);
+            out.insert(out.end(), bytes, bytes + size);
+        };
+        write(&header, sizeof(header));
+        write(records.data(), records.size() * sizeof(LevelRecord));
+        for (size_t i = 0; i < levels.size(); i++) {
+            out.resize(records[i].offset, 0);
+            write(levels[i].data, levels[i].size);
+        }
+
+        if (!writeCacheFile(cooked, out.data(), out.size()))
+            return false;
+
+        Logging::Resource->debug("Wrote cooked texture {}", cooked.c_str());
+        return true;
+    }
+
+    bool CookedTexture::isCompressed() const {
+        return format != GL_RGBA8;
+    }
+
+    vector<uint8_t> CookedTexture::compressLevel(
+        const vector<uint8_t> & pixels,
+        unsigned width,
+        unsigned height,
+        GLenum format) {
+        size_t size = Texture::blockSize(format);
+        vector<uint8_t> out(levelSize(format, width, height));
+        uint8_t * cursor = out.data();
+
+        uint8_t block[16][4];
+        for (unsigned by = 0; by < height; by += 4) {
+            for (unsigned bx = 0; bx < width; bx += 4) {
+                // Edge blocks repeat the last row and column
+                for (unsigned i = 0; i < 16; i++) {
+                    unsigned x = std::min(bx + i % 4, width - 1);
+                    unsigned y = std::min(by + i / 4, height - 1);
+                    std::memcpy(block[i],
+                                &pixels[(size_t(y) * width + x) * 4], 4);
+                }
+
+                if (size == 16) {
+                    encodeAlpha(block, cursor);
+                    encodeColor(block, cursor + 8);
+                }
+                else {
+                    encodeColor(block, cursor);
+                }
+                cursor += size;
+            }
+        }
+        return out;
+    }
+}
@@ -9,6 +9,7 @@
 
 #include "default_font.h"
 #include "singe/Core/GameBase.hpp"
+#include "singe/Graphics/GLStateCache.hpp"
 
 namespace singe::Logging {
     Logger::Ptr Game = std::make_shared<Logger>("Game");
@@ -98,6 +99,8 @@ namespace singe {
 
             if (menu || fpsShow) {
                 window->window.popGLStates();
+                // SFML binds it's own program, textures and vertex arrays
+                GLStateCache::current().invalidate();
             }
             window->display();
         }
@@ -0,0 +1,316 @@
+#include "singe/Core/ProgramCache.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <singe/Support/CacheFile.hpp>
+#include <system_error>
+#include <vector>
+
+#include "singe/Core/ResourceManager.hpp"
+
+namespace singe {
+    using std::move;
+    using std::vector;
+
+    namespace {
+        constexpr char Magic[4] = {'S', 'G', 'P', 'B'};
+
+        struct FileHeader {
+            char magic[4];
+            uint32_t version;
+            uint64_t sourceHash;
+            uint32_t binaryFormat;
+            uint32_t driverSize;
+            uint64_t binarySize;
+        };
+
+        uint64_t hashSources(const string & vertexSource,
+                             const string & fragmentSource) {
+            uint64_t hash = hashBytes(vertexSource.data(), vertexSource.size());
+            // Separate the sources so moving text between them changes the
+            // hash
+            hash = hashBytes("", 1, hash);
+            return hashBytes(fragmentSource.data(), fragmentSource.size(),
+                             hash);
+        }
+
+        string glString(GLenum name) {
+            auto * value = reinterpret_cast<const char *>(glGetString(name));
+            return value ? value : "";
+        }
+
+        GLuint compileShader(GLenum type, const string & source) {
+            GLuint shader = glCreateShader(type);
+            const char * text = source.c_str();
+            GLint length = source.size();
+            glShaderSource(shader, 1, &text, &length);
+            glCompileShader(shader);
+            return shader;
+        }
+
+        void checkShader(GLuint shader, const string & name) {
+            GLint status = GL_FALSE;
+            glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+            if (status == GL_TRUE)
+                return;
+
+            GLint type = 0;
+            glGetShaderiv(shader, GL_SHADER_TYPE, &type);
+            GLint logSize = 0;
+            glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &logSize);
+            string log(std::max(logSize, 1), '\0');
+            glGetShaderInfoLog(shader, logSize, nullptr, log.data());
+            throw ResourceLoadException(
+                "Failed to compile "
+                + string(type == GL_VERTEX_SHADER ? "vertex" : "fragment")
+                + " shader for " + name + ": " + log.c_str());
+        }
+
+        bool linked(GLuint program) {
+            GLint status = GL_FALSE;
+            glGetProgramiv(program, GL_LINK_STATUS, &status);
+            return status == GL_TRUE;
+        }
+
+        void checkProgram(GLuint program, const string & name) {
+            if (linked(program))
+                return;
+
+            GLint logSize = 0;
+            glGetProgramiv(program, GL_INFO_LOG_LENGTH, &logSize);
+            string log(std::max(logSize, 1), '\0');
+            glGetProgramInfoLog(program, logSize, nullptr, log.data());
+            throw ResourceLoadException("Failed to link program for " + name
+                                        + ": " + log.c_str());
+        }
+
+        GLuint loadBinary(const fs::path & path,
+                          uint64_t sourceHash,
+                          const string & driver) {
+            std::error_code error;
+            uint64_t fileSize = fs::file_size(path, error);
+            std::ifstream is(path, std::ios::binary);
+            FileHeader header;
+            if (error || !is.is_open()
+                || !is.read(reinterpret_cast<char *>(&header), sizeof(header))
+                || std::memcmp(header.magic, Magic, sizeof(Magic)) != 0
+                || header.version != ProgramCache::Version
+                || header.sourceHash != sourceHash
+                || header.driverSize != driver.size()
+                || header.binarySize > fileSize)
+                return 0;
+
+            string fileDriver(header.driverSize, '\0');
+            vector<char> binary(header.binarySize);
+            if (!is.read(fileDriver.data(), fileDriver.size())
+                || fileDriver != driver
+                || !is.read(binary.data(), binary.size()))
+                return 0;
+
+            GLuint program = glCreateProgram();
+            glProgramBinary(program, header.binaryFormat, binary.data(),
+                            binary.size());
+            if (linked(program))
+                return program;
+            glDeleteProgram(program);
+            return 0;
+        }
+
+        void saveBinary(GLuint program,
+                        const fs::path & path,
+                        uint64_t sourceHash,
+                        const string & driver) {
+            GLint binarySize = 0;
+            glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binarySize);
+            if (binarySize <= 0)
+                return;
+
+            FileHeader header;
+            std::memcpy(header.magic, Magic, sizeof(Magic));
+            header.version = ProgramCache::Version;
+            header.sourceHash = sourceHash;
+            header.driverSize = driver.size();
+
+            vector<char> binary(binarySize);
+            GLenum binaryFormat = 0;
+            GLsizei written = 0;
+            glGetProgramBinary(program, binarySize, &written, &binaryFormat,
+                               binary.data());
+            header.binaryFormat = binaryFormat;
+            header.binarySize = written;
+
+            vector<char> out(sizeof(header) + driver.size() + written);
+            std::memcpy(out.data(), &header, sizeof(header));
+            std::memcpy(out.data() + sizeof(header), driver.data(),
+                        driver.size());
+            std::memcpy(out.data() + sizeof(header) + driver.size(),
+                        binary.data(), written);
+            if (writeCacheFile(path, out.data(), out.size()))
+                Logging::Resource->debug("Wrote program binary {}",
+                                         path.c_str());
+        }
+    }
+
+    ProgramCache::ProgramCache(const fs::path & directory)
+        : directory(directory), supported(false) {
+        driver = glString(GL_VENDOR) + "\n" + glString(GL_RENDERER) + "\n"
+                 + glString(GL_VERSION);
+
+        if (GLEW_ARB_get_program_binary) {
+            GLint formats = 0;
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+            supported = formats > 0;
+        }
+        Logging::Resource->debug("Program binaries are {}",
+                                 supported ? "supported" : "not supported");
+
+        // Let the driver compile on it's own threads, linkAll() only asks for
+        // the status once every program has been submitted. Older GLEW
+        // versions do not know the extensions.
+#if defined(GL_KHR_parallel_shader_compile)
+        if (GLEW_KHR_parallel_shader_compile) {
+            glMaxShaderCompilerThreadsKHR(0xffffffff);
+            return;
+        }
+#endif
+#if defined(GL_ARB_parallel_shader_compile)
+        if (GLEW_ARB_parallel_shader_compile)
+            glMaxShaderCompilerThreadsARB(0xffffffff);
+#endif
+    }
+
+    ProgramCache::ProgramCache(ProgramCache && other)
+        : directory(move(other.directory)),
+          driver(move(other.driver)),
+          supported(other.supported) {}
+
+    ProgramCache & ProgramCache::operator=(ProgramCache && other) {
+        directory = move(other.directory);
+        driver = move(other.driver);
+        supported = other.supported;
+        return *this;
+    }
+
+    ProgramCache::~ProgramCache() {}
+
+    bool ProgramCache::isSupported() const {
+        return supported;
+    }
+
+    fs::path ProgramCache::binaryPath(const string & vertexSource,
+                                      const string & fragmentSource) const {
+        if (!supported || directory.empty())
+            return {};
+
+        uint64_t hash = hashSources(vertexSource, fragmentSource);
+        hash = hashBytes(driver.data(), driver.size(), hash);
+
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx.program",
+                      static_cast<unsigned long long>(hash));
+        return directory / name;
+    }
+
+    GLuint ProgramCache::link(const string & vertexSource,
+                              const string & fragmentSource,
+                              const string & name) const {
+        vector<string> errors;
+        GLuint program =
+            linkAll({{vertexSource, fragmentSource, name}}, errors).front();
+        if (!program)
+            throw ResourceLoadException(errors.front());
+        return program;
+    }
+
+    vector<GLuint> ProgramCache::linkAll(const vector<Sources> & programs,
+                                         vector<string> & errors) const {
+        struct Pending {
+            fs::path path;
+            uint64_t sourceHash;
+            GLuint vertex = 0;
+            GLuint fragment = 0;
+        };
+
+        vector<GLuint> linkedPrograms(programs.size(), 0);
+        vector<Pending> pending(programs.size());
+        errors.assign(programs.size(), string());
+
+        for (size_t i = 0; i < programs.size(); i++) {
+            auto & sources = programs[i];
+            pending[i].path = binaryPath(sources.vertex, sources.fragment);
+            pending[i].sourceHash = hashSources(sources.vertex,
+                                                sources.fragment);
+            if (pending[i].path.empty())
+                continue;
+
+            linkedPrograms[i] =
+                loadBinary(pending[i].path, pending[i].sourceHash, driver);
+            if (linkedPrograms[i])
+                Logging::Resource->debug("Loaded program binary for {}",
+                                         sources.name);
+            else
+                Logging::Resource->debug("No usable program binary for {}",
+                                         sources.name);
+        }
+
+        // Submit every compile and link before asking for any status so the
+        // driver can work on them at the same time
+        for (size_t i = 0; i < programs.size(); i++) {
+            if (linkedPrograms[i])
+                continue;
+            pending[i].vertex =
+                compileShader(GL_VERTEX_SHADER, programs[i].vertex);
+            pending[i].fragment =
+                compileShader(GL_FRAGMENT_SHADER, programs[i].fragment);
+        }
+
+        vector<bool> compiled(programs.size(), false);
+        for (size_t i = 0; i < programs.size(); i++) {
+            if (linkedPrograms[i])
+                continue;
+            compiled[i] = true;
+
+            GLuint program = glCreateProgram();
+            glAttachShader(program, pending[i].vertex);
+            glAttachShader(program, pending[i].fragment);
+            if (!pending[i].path.empty())
+                glProgramParameteri(program,
+                                    GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+                                    GL_TRUE);
+            glLinkProgram(program);
+            linkedPrograms[i] = program;
+        }
+
+        for (size_t i = 0; i < programs.size(); i++) {
+            if (!compiled[i])
+                continue;
+
+            bool ok = true;
+            try {
+                checkShader(pending[i].vertex, programs[i].name);
+                checkShader(pending[i].fragment, programs[i].name);
+                checkProgram(linkedPrograms[i], programs[i].name);
+            }
+            catch (const ResourceLoadException & error) {
+                errors[i] = error.what();
+                ok = false;
+            }
+
+            glDetachShader(linkedPrograms[i], pending[i].vertex);
+            glDetachShader(linkedPrograms[i], pending[i].fragment);
+            glDeleteShader(pending[i].vertex);
+            glDeleteShader(pending[i].fragment);
+            if (!ok) {
+                glDeleteProgram(linkedPrograms[i]);
+                linkedPrograms[i] = 0;
+            }
+            else if (!pending[i].path.empty())
+                saveBinary(linkedPrograms[i], pending[i].path,
+                           pending[i].sourceHash, driver);
+        }
+
+        return linkedPrograms;
+    }
+}
@@ -1,11 +1,17 @@
 #include "singe/Core/ResourceManager.hpp"
 
+#include <SFML/Graphics.hpp>
 #include <Wavefront.hpp>
+#include <exception>
 #include <filesystem>
 #include <fstream>
+#include <set>
+#include <singe/Support/BinaryScene.hpp>
 #include <singe/Support/SceneParser.hpp>
 #include <singe/Support/log.hpp>
 #include <string_view>
+#include <tuple>
+#include <type_traits>
 
 namespace singe {
     using std::ifstream;
@@ -14,25 +20,109 @@ namespace singe {
     using std::move;
     using std::string_view;
 
+    using ModelLoader = std::function<vector<Model::Ptr>(const string &)>;
+
     namespace Logging {
         Logger::Ptr Resource = make_shared<Logger>("Resource");
     }
 
-    ResourceManager::ResourceManager(const fs::path & root) : root(root) {
+    // Shared with workers which must not read the ResourceManager
+    static fs::path resolveResource(const fs::path & root,
+                                    const fs::path & subPath) {
+        if (subPath.is_absolute())
+            return subPath;
+        else
+            return root / subPath;
+    }
+
+    static fs::path resolveCache(const fs::path & cacheRoot,
+                                 const fs::path & subPath,
+                                 const string & extension) {
+        if (cacheRoot.empty())
+            return {};
+
+        fs::path cached = cacheRoot / subPath.relative_path();
+        cached += extension;
+        return cached;
+    }
+
+    static string readShaderSource(const fs::path & path) {
+        ifstream is(path);
+        if (!is.is_open())
+            throw ResourceLoadException("Unable to read shader "
+                                        + path.string());
+        return string(istreambuf_iterator<char>(is),
+                      istreambuf_iterator<char>());
+    }
+
+    void ResourceManager::UploadQueue::push(UploadJob && job) {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.emplace_back(move(job));
+    }
+
+    ResourceManager::ResourceManager(const fs::path & root)
+        : root(root),
+          cacheRoot(),
+          textureCompression(false),
+          packMeshes(false),
+          vertexFormat(VertexFormat::Float),
+          uploads(make_shared<UploadQueue>()) {
+        uploads->owner = std::this_thread::get_id();
         Logging::Resource->trace("Resource manager created with root {}",
                                  root.c_str());
     }
 
     ResourceManager::ResourceManager(ResourceManager && other)
-        : root(other.root) {}
+        : root(other.root),
+          cacheRoot(other.cacheRoot),
+          textureCompression(other.textureCompression),
+          packMeshes(other.packMeshes),
+          vertexFormat(other.vertexFormat),
+          vertexArena(move(other.vertexArena)),
+          textures(move(other.textures)),
+          pendingTextures(move(other.pendingTextures)),
+          shaderVariants(move(other.shaderVariants)),
+          models(move(other.models)),
+          pendingModels(move(other.pendingModels)),
+          uploads(move(other.uploads)),
+          pool(move(other.pool)),
+          programCache(move(other.programCache)) {}
 
     ResourceManager & ResourceManager::operator=(ResourceManager && other) {
         root = other.root;
+        cacheRoot = other.cacheRoot;
+        textureCompression = other.textureCompression;
+        packMeshes = other.packMeshes;
+        vertexFormat = other.vertexFormat;
+        vertexArena = move(other.vertexArena);
+        textures = move(other.textures);
+        pendingTextures = move(other.pendingTextures);
+        shaderVariants = move(other.shaderVariants);
+        models = move(other.models);
+        pendingModels = move(other.pendingModels);
+        uploads = move(other.uploads);
+        pool = move(other.pool);
+        programCache = move(other.programCache);
         return *this;
     }
 
     ResourceManager::~ResourceManager() {}
 
+    Texture::Ptr ResourceManager::makeTexture() const {
+        std::weak_ptr<UploadQueue> queue = uploads;
+        return Texture::Ptr(new Texture(), [queue](Texture * texture) {
+            auto uploads = queue.lock();
+            if (!uploads || std::this_thread::get_id() == uploads->owner) {
+                delete texture;
+                return;
+            }
+            // Released by a worker, the job is destroyed by processUploads()
+            // on the thread that owns the context and deletes the texture
+            shared_ptr<Texture> owned(texture);
+            uploads->push([owned](ResourceManager &) {});
+        });
+    }
+
     void ResourceManager::setRoot(const fs::path & root) {
         Logging::Resource->trace("ResourceManager::setRoot {}", root.c_str());
         this->root = root;
@@ -43,10 +133,181 @@ namespace singe {
     }
 
     fs::path ResourceManager::resourceAt(const fs::path & subPath) const {
-        if (subPath.is_absolute())
-            return subPath;
-        else
-            return root / subPath;
+        return resolveResource(root, subPath);
+    }
+
+    void ResourceManager::setCacheRoot(const fs::path & cacheRoot) {
+        Logging::Resource->trace("ResourceManager::setCacheRoot {}",
+                                 cacheRoot.c_str());
+        this->cacheRoot = cacheRoot;
+        // Created again with the new directory on the next shader load
+        programCache.reset();
+    }
+
+    const fs::path & ResourceManager::getCacheRoot() const {
+        return cacheRoot;
+    }
+
+    fs::path ResourceManager::cacheAt(const fs::path & subPath,
+                                      const string & extension) const {
+        return resolveCache(cacheRoot, subPath, extension);
+    }
+
+    void ResourceManager::setThreadPool(ThreadPool::Ptr pool) {
+        this->pool = move(pool);
+    }
+
+    ThreadPool::Ptr ResourceManager::getThreadPool() const {
+        return pool;
+    }
+
+    ThreadPool & ResourceManager::workers() {
+        if (!pool)
+            pool = make_shared<ThreadPool>();
+        return *pool;
+    }
+
+    ProgramCache & ResourceManager::programs() {
+        if (!programCache)
+            programCache = make_shared<ProgramCache>(cacheAt("programs", ""));
+        return *programCache;
+    }
+
+    void ResourceManager::setTextureCompression(bool compress) {
+        textureCompression = compress;
+    }
+
+    bool ResourceManager::getTextureCompression() const {
+        return textureCompression;
+    }
+
+    void ResourceManager::setPackMeshes(bool pack) {
+        packMeshes = pack;
+    }
+
+    bool ResourceManager::getPackMeshes() const {
+        return packMeshes;
+    }
+
+    void ResourceManager::setVertexFormat(VertexFormat::Type type) {
+        vertexFormat = type;
+    }
+
+    VertexFormat::Type ResourceManager::getVertexFormat() const {
+        return vertexFormat;
+    }
+
+    const VertexArena::Ptr & ResourceManager::getVertexArena() const {
+        return vertexArena;
+    }
+
+    bool ResourceManager::compressTextures() const {
+        return textureCompression && Texture::supportsCompression();
+    }
+
+    bool ResourceManager::prepareTexture(const fs::path & source,
+                                         const fs::path & cooked,
+                                         bool compress,
+                                         CookedTexture & texture) {
+        // A texture cooked for a context without S3TC is cooked again
+        if (!cooked.empty() && texture.load(cooked, source)
+            && texture.isCompressed() == compress) {
+            Logging::Resource->debug("Using cooked texture {}",
+                                     cooked.c_str());
+            return true;
+        }
+
+        if (!texture.cook(source, compress))
+            return false;
+        if (!cooked.empty() && !texture.save(cooked, source))
+            Logging::Resource->warning("Failed to write cooked texture {}",
+                                       cooked.c_str());
+        return true;
+    }
+
+    std::future<CookedTexture::Ptr> ResourceManager::cookTexture(
+        const string & path, bool compress) {
+        fs::path fullPath = resourceAt(path);
+        fs::path cookedPath = cacheAt(path, ".texture");
+        return workers().submit([fullPath, cookedPath, compress]() {
+            auto cooked = make_shared<CookedTexture>();
+            if (!prepareTexture(fullPath, cookedPath, compress, *cooked))
+                cooked.reset();
+            return cooked;
+        });
+    }
+
+    void ResourceManager::uploadTexture(Texture & texture,
+                                        const CookedTexture & cooked) {
+        texture.upload(cooked.format, cooked.levels.data(),
+                       cooked.levels.size());
+    }
+
+    template<typename T, typename Prepare, typename Upload>
+    shared_future<T> ResourceManager::loadAsync(Prepare && prepare,
+                                                Upload && upload) {
+        using Prepared = std::invoke_result_t<Prepare>;
+
+        auto promise = make_shared<std::promise<T>>();
+        shared_future<T> future = promise->get_future().share();
+
+        auto queue = uploads;
+        queue->loading++;
+
+        workers().submit([queue, promise,
+                          prepare = std::forward<Prepare>(prepare),
+                      upload = std::forward<Upload>(upload)]() mutable {
+            shared_ptr<Prepared> prepared;
+            std::exception_ptr error;
+            try {
+                prepared = make_shared<Prepared>(prepare());
+            }
+            catch (...) {
+                error = std::current_exception();
+            }
+
+            queue->push([queue, promise, prepared, error,
+                         upload = move(upload)](ResourceManager & res) {
+                queue->loading--;
+                if (error) {
+                    promise->set_exception(error);
+                    return;
+                }
+                try {
+                    promise->set_value(upload(res, *prepared));
+                }
+                catch (...) {
+                    promise->set_exception(std::current_exception());
+                }
+            });
+        });
+
+        return future;
+    }
+
+    size_t ResourceManager::processUploads(std::chrono::microseconds budget) {
+        using Clock = std::chrono::steady_clock;
+
+        auto start = Clock::now();
+        size_t processed = 0;
+        do {
+            UploadJob job;
+            {
+                std::lock_guard<std::mutex> lock(uploads->mutex);
+                if (uploads->jobs.empty())
+                    break;
+                job = move(uploads->jobs.front());
+                uploads->jobs.pop_front();
+            }
+            job(*this);
+            processed++;
+        } while (Clock::now() - start < budget);
+
+        return processed;
+    }
+
+    size_t ResourceManager::pendingLoads() const {
+        return uploads->loading;
     }
 
     Texture::Ptr ResourceManager::getTexture(const string & path, bool useCached) {
@@ -58,11 +319,24 @@ namespace singe {
 
         map<string, Texture::Ptr>::iterator cached;
         if (useCached && (cached = textures.find(path)) != textures.end()) {
-            Logging::Resource->debug("Using cached texture");
-            return cached->second;
+            if (cached->second->isLoaded()) {
+                Logging::Resource->debug("Using cached texture");
+                return cached->second;
+            }
+            Logging::Resource->debug("Finishing cached texture now");
         }
 
-        auto texture = make_shared<Texture>(Texture::fromPath(fullPath));
+        CookedTexture cooked;
+        if (!prepareTexture(fullPath, cacheAt(path, ".texture"),
+                            compressTextures(), cooked))
+            throw ResourceLoadException("Failed to load texture " + path);
+
+        Texture::Ptr texture;
+        if (useCached && cached != textures.end())
+            texture = cached->second;
+        else
+            texture = makeTexture();
+        uploadTexture(*texture, cooked);
         Logging::Resource->debug("Loading texture from file");
         if (useCached) {
             Logging::Resource->debug("Adding texture to cache");
@@ -71,32 +345,222 @@ namespace singe {
         return texture;
     }
 
+    shared_future<Texture::Ptr> ResourceManager::getTextureAsync(
+        const string & path) {
+        Logging::Resource->info("ResourceManager::getTextureAsync {}", path);
+
+        auto pending = pendingTextures.find(path);
+        if (pending != pendingTextures.end())
+            return pending->second;
+
+        auto cached = textures.find(path);
+        if (cached != textures.end()) {
+            Logging::Resource->debug("Using cached texture");
+            std::promise<Texture::Ptr> ready;
+            ready.set_value(cached->second);
+            return ready.get_future().share();
+        }
+
+        fs::path fullPath = resourceAt(path);
+        Logging::Resource->trace("Full path is {}", fullPath.c_str());
+
+        auto texture = makeTexture();
+        textures[path] = texture;
+
+        fs::path cookedPath = cacheAt(path, ".texture");
+        bool compress = compressTextures();
+
+        auto future = loadAsync<Texture::Ptr>(
+            [fullPath, cookedPath, compress]() {
+                auto cooked = make_shared<CookedTexture>();
+                if (!prepareTexture(fullPath, cookedPath, compress, *cooked))
+                    cooked.reset();
+                return cooked;
+            },
+            [path, texture](ResourceManager & res,
+                            shared_ptr<CookedTexture> & cooked) {
+                res.pendingTextures.erase(path);
+                if (!cooked) {
+                    // Let a later load try again instead of using the empty
+                    // texture
+                    auto cached = res.textures.find(path);
+                    if (cached != res.textures.end()
+                        && cached->second == texture)
+                        res.textures.erase(cached);
+                    throw ResourceLoadException("Failed to load texture "
+                                                + path);
+                }
+                // getTexture() may have finished it already
+                if (!texture->isLoaded())
+                    uploadTexture(*texture, *cooked);
+                return texture;
+            });
+        pendingTextures[path] = future;
+        return future;
+    }
+
+    size_t ResourceManager::packTextures(
+        const vector<Material::Ptr> & materials) {
+        Logging::Resource->info("ResourceManager::packTextures {}",
+                                materials.size());
+
+        // The layers are filled from the cooked textures, not the GPU copy
+        map<const Texture *, string> paths;
+        for (auto & [path, texture] : textures) paths[texture.get()] = path;
+
+        // Only materials whose shader has an array variant can switch
+        map<string, vector<std::pair<Material *, Shader::Ptr>>> users;
+        std::set<string> kept;
+        for (auto & material : materials) {
+            if (!material || !material->texture)
+                continue;
+            auto path = paths.find(material->texture.get());
+            if (path == paths.end())
+                continue;
+            auto shader = getShaderVariant(material->shader,
+                                           {Material::TextureArrayDefine});
+            if (shader)
+                users[path->second].emplace_back(material.get(), shader);
+            else
+                kept.insert(path->second);
+        }
+
+        bool compress = compressTextures();
+        map<string, std::future<CookedTexture::Ptr>> pending;
+        for (auto & entry : users)
+            pending[entry.first] = cookTexture(entry.first, compress);
+
+        // Only textures with the same format and size can share an array
+        using Key = std::tuple<GLenum, unsigned, unsigned, size_t>;
+        map<Key, vector<std::pair<string, shared_ptr<CookedTexture>>>> groups;
+        for (auto & [path, future] : pending) {
+            auto cooked = future.get();
+            if (!cooked)
+                continue;
+            auto & level = cooked->levels.front();
+            Key key {cooked->format, level.width, level.height,
+                     cooked->levels.size()};
+            groups[key].emplace_back(path, cooked);
+        }
+
+        GLint maxLayers = 0;
+        glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+        maxLayers = std::max(maxLayers, 1);
+
+        size_t created = 0;
+        for (auto & [key, group] : groups) {
+            auto [format, width, height, levelCount] = key;
+            for (size_t first = 0; first < group.size(); first += maxLayers) {
+                size_t layers = std::min(group.size() - first,
+                                         size_t(maxLayers));
+                // Nothing to batch with
+                if (layers < 2)
+                    break;
+
+                auto array = make_shared<TextureArray>(format, width, height,
+                                                       layers, levelCount);
+                for (size_t layer = 0; layer < layers; layer++) {
+                    auto & [path, cooked] = group[first + layer];
+                    array->upload(layer, cooked->levels.data(),
+                                  cooked->levels.size());
+                    for (auto & [material, shader] : users[path]) {
+                        material->textureArray = array;
+                        material->textureLayer = layer;
+                        material->shader = shader;
+                        material->texture = nullptr;
+                    }
+                    // Only materials outside of this pack still hold it
+                    if (!kept.count(path))
+                        textures.erase(path);
+                }
+                Logging::Resource->debug("Packed {} textures of {}x{}", layers,
+                                         width, height);
+                created++;
+            }
+        }
+        return created;
+    }
+
+    static void collectMaterials(const Scene & scene,
+                                 vector<Material::Ptr> & materials) {
+        for (auto & model : scene.models) {
+            if (model->material)
+                materials.push_back(model->material);
+        }
+        for (auto & child : scene.children) collectMaterials(*child, materials);
+    }
+
+    size_t ResourceManager::packTextures(const Scene & scene) {
+        vector<Material::Ptr> materials;
+        collectMaterials(scene, materials);
+        return packTextures(materials);
+    }
+
     Shader::Ptr ResourceManager::getShader(const string & vertPath,
                                            const string & fragPath,
                                            bool useCached) {
         Logging::Resource->info("ResourceManager::getShader {} {} {}", vertPath,
                                 fragPath, useCached);
 
+        if (useCached)
+            return getShaderVariants(vertPath, fragPath)->get(0, programs());
+
         fs::path fullVertexPath = resourceAt(vertPath);
         fs::path fullFragmentPath = resourceAt(fragPath);
         Logging::Resource->trace("Vertex path is {}", fullVertexPath.c_str());
         Logging::Resource->trace("Fragment path is {}", fullFragmentPath.c_str());
 
-        map<string, Shader::Ptr>::iterator cached;
-        if (useCached
-            && (cached = shaders.find(vertPath + fragPath)) != shaders.end()) {
-            Logging::Resource->debug("Using cached shader");
+        Logging::Resource->debug("Loading shader from file");
+        GLuint program = programs().link(readShaderSource(fullVertexPath),
+                                         readShaderSource(fullFragmentPath),
+                                         vertPath + " " + fragPath);
+        return make_shared<Shader>(program);
+    }
+
+    ShaderVariants::Ptr ResourceManager::getShaderVariants(
+        const string & vertPath, const string & fragPath) {
+        auto cached = shaderVariants.find(vertPath + fragPath);
+        if (cached != shaderVariants.end())
             return cached->second;
-        }
 
-        auto shader = make_shared<Shader>(
-            glpp::Shader::fromPaths(fullVertexPath, fullFragmentPath));
-        Logging::Resource->debug("Loading shader from file");
-        if (useCached) {
-            Logging::Resource->debug("Adding shader to cache");
-            shaders[vertPath + fragPath] = shader;
+        fs::path fullVertexPath = resourceAt(vertPath);
+        fs::path fullFragmentPath = resourceAt(fragPath);
+        Logging::Resource->trace("Vertex path is {}", fullVertexPath.c_str());
+        Logging::Resource->trace("Fragment path is {}", fullFragmentPath.c_str());
+
+        auto variants = make_shared<ShaderVariants>(
+            readShaderSource(fullVertexPath),
+            readShaderSource(fullFragmentPath),
+            vertPath + " " + fragPath);
+        shaderVariants[vertPath + fragPath] = variants;
+        return variants;
+    }
+
+    Shader::Ptr ResourceManager::getShaderVariant(
+        const string & vertPath,
+        const string & fragPath,
+        const vector<string> & defines) {
+        auto variants = getShaderVariants(vertPath, fragPath);
+        return variants->get(variants->getMask(defines), programs());
+    }
+
+    Shader::Ptr ResourceManager::getShaderVariant(
+        const Shader::Ptr & shader, const vector<string> & defines) {
+        if (!shader)
+            return nullptr;
+
+        ShaderVariants::Mask mask;
+        for (auto & [key, variants] : shaderVariants) {
+            if (!variants->findMask(*shader, mask))
+                continue;
+            for (auto & define : defines) {
+                if (!variants->uses(define))
+                    return nullptr;
+            }
+            mask |= variants->getMask(defines);
+            return variants->get(mask, programs());
         }
-        return shader;
+        return nullptr;
     }
 
     MVPShader::Ptr ResourceManager::getMVPShader(const string & vertPath,
@@ -117,9 +581,11 @@ namespace singe {
             return cached->second;
         }
 
-        auto shader = make_shared<MVPShader>(
-            glpp::Shader::fromPaths(fullVertexPath, fullFragmentPath));
         Logging::Resource->debug("Loading shader from file");
+        GLuint program = programs().link(readShaderSource(fullVertexPath),
+                                         readShaderSource(fullFragmentPath),
+                                         vertPath + " " + fragPath);
+        auto shader = make_shared<MVPShader>(program);
         if (useCached) {
             Logging::Resource->debug("Adding shader to cache");
             mvpShaders[vertPath + fragPath] = shader;
@@ -127,71 +593,281 @@ namespace singe {
         return shader;
     }
 
-    vector<Model::Ptr> ResourceManager::loadModel(const string & path) {
-        Logging::Resource->info("ResourceManager::loadModel {}", path);
+    bool ResourceManager::prepareMesh(const fs::path & source,
+                                      const fs::path & cooked,
+                                      CookedMesh & mesh) {
+        if (!cooked.empty() && mesh.load(cooked, source)) {
+            Logging::Resource->debug("Using cooked mesh {}", cooked.c_str());
+            return true;
+        }
+
+        if (!mesh.cook(source)) {
+            Logging::Resource->error("Model has no objects");
+            return false;
+        }
+        if (!cooked.empty() && !mesh.save(cooked, source))
+            Logging::Resource->warning("Failed to write cooked mesh {}",
+                                       cooked.c_str());
+        return true;
+    }
 
-        fs::path fullPath = resourceAt(path);
-        Logging::Resource->trace("Full path is {}", fullPath.c_str());
+    string ResourceManager::modelKey(const string & path) const {
+        return resourceAt(path).lexically_normal().string();
+    }
 
-        wavefront::Model wfModel;
-        wfModel.loadModelFrom(fullPath);
+    const ResourceManager::CachedModel & ResourceManager::addModel(
+        const string & key, const CookedMesh & mesh, bool async) {
+        auto cached = models.find(key);
+        if (cached != models.end())
+            return cached->second;
 
-        if (wfModel.materials.empty())
+        if (mesh.materials.empty())
             Logging::Resource->warning("Model has no material");
 
-        if (wfModel.objects.empty()) {
-            Logging::Resource->error("Model has no objects");
-            return {};
-        }
+        auto texture = [&](const string & path) -> Texture::Ptr {
+            if (!async)
+                return getTexture(path);
+            getTextureAsync(path);
+            return textures[path];
+        };
 
         vector<Material::Ptr> materials;
 
-        for (auto & mat : wfModel.materials) {
+        for (auto & mat : mesh.materials) {
             auto material = materials.emplace_back(make_shared<Material>());
 
-            material->name = mat->name;
-            material->ambient = mat->colAmbient;
-            material->diffuse = mat->colDiffuse;
-            material->specular = mat->colSpecular;
-            material->specExp = mat->specExp;
-            material->alpha = mat->alpha;
-            if (!mat->texAlbedo.empty())
-                material->texture = getTexture(mat->texAlbedo);
-            if (!mat->texNormal.empty())
-                material->normalTexture = getTexture(mat->texNormal);
-            if (!mat->texSpecular.empty())
-                material->specularTexture = getTexture(mat->texSpecular);
+            material->name = mat.name;
+            material->ambient = mat.ambient;
+            material->diffuse = mat.diffuse;
+            material->specular = mat.specular;
+            material->specExp = mat.specExp;
+            material->alpha = mat.alpha;
+            if (!mat.texture.empty())
+                material->texture = texture(mat.texture);
+            if (!mat.normalTexture.empty())
+                material->normalTexture = texture(mat.normalTexture);
+            if (!mat.specularTexture.empty())
+                material->specularTexture = texture(mat.specularTexture);
         }
 
-        vector<Model::Ptr> models;
-
-        for (auto & obj : wfModel.objects) {
-            auto & model = models.emplace_back(make_shared<Model>());
+        CachedModel model;
 
-            if (obj->size() == 0)
-                Logging::Resource->warning("Object " + obj->name + " has no points");
+        for (auto & obj : mesh.objects) {
+            if (obj.vertexCount == 0)
+                Logging::Resource->warning("Object " + obj.name
+                                           + " has no points");
 
-            for (int i = 0; i < obj->size(); i++) {
-                model->points.emplace_back(obj->vertices[i], obj->normals[i],
-                                           obj->texcoords[i]);
+            // Buffered straight from the cooked mesh
+            if (packMeshes) {
+                // Meshes already in an arena of another format keep it
+                if (!vertexArena || vertexArena->getType() != vertexFormat)
+                    vertexArena = make_shared<VertexArena>(vertexFormat);
+                model.meshes.emplace_back(
+                    make_shared<Mesh>(vertexArena, obj.vertices,
+                                      obj.vertexCount, obj.indices,
+                                      obj.indexCount));
+            }
+            else {
+                model.meshes.emplace_back(
+                    make_shared<Mesh>(obj.vertices, obj.vertexCount,
+                                      obj.indices, obj.indexCount,
+                                      GL_STATIC_DRAW, vertexFormat));
             }
 
-            model->update();
+            // Each Model gets a copy so it can change it's points
+            model.points.emplace_back(obj.vertices,
+                                      obj.vertices + obj.vertexCount);
+            model.indices.emplace_back(obj.indices,
+                                       obj.indices + obj.indexCount);
 
-            if (0 > obj->matId >= materials.size())
+            if (obj.materialId < 0
+                || size_t(obj.materialId) >= materials.size()) {
                 Logging::Resource->error("Invalid material id");
-            else
-                model->material = materials[obj->matId];
+                model.materials.emplace_back(nullptr);
+            }
+            else {
+                model.materials.emplace_back(materials[obj.materialId]);
+            }
+        }
+
+        Logging::Resource->debug("Adding model to cache");
+        return models[key] = move(model);
+    }
+
+    vector<Model::Ptr> ResourceManager::instantiate(const CachedModel & cached,
+                                                    bool uniqueMaterials) {
+        map<const Material *, Material::Ptr> clones;
+        vector<Model::Ptr> result;
+
+        for (size_t i = 0; i < cached.meshes.size(); i++) {
+            auto & model =
+                result.emplace_back(make_shared<Model>(cached.meshes[i]));
+            model->points = cached.points[i];
+            model->indices = cached.indices[i];
+            model->vertexFormat = cached.meshes[i]->getFormat().getType();
+
+            auto & material = cached.materials[i];
+            if (material && uniqueMaterials) {
+                // Objects that shared a material still share the copy
+                auto & clone = clones[material.get()];
+                if (!clone)
+                    clone = material->clone();
+                model->material = clone;
+            }
+            else {
+                model->material = material;
+            }
+        }
+
+        return result;
+    }
+
+    vector<Model::Ptr> ResourceManager::loadModel(const string & path,
+                                                  bool uniqueMaterials) {
+        Logging::Resource->info("ResourceManager::loadModel {} {}", path,
+                                uniqueMaterials);
+
+        fs::path fullPath = resourceAt(path);
+        Logging::Resource->trace("Full path is {}", fullPath.c_str());
+
+        string key = modelKey(path);
+        auto cached = models.find(key);
+        if (cached != models.end()) {
+            Logging::Resource->debug("Using cached model");
+            return instantiate(cached->second, uniqueMaterials);
+        }
+
+        CookedMesh mesh;
+        if (!prepareMesh(fullPath, cacheAt(path, ".mesh"), mesh))
+            return {};
+
+        return instantiate(addModel(key, mesh, false), uniqueMaterials);
+    }
+
+    shared_future<vector<Model::Ptr>> ResourceManager::loadModelAsync(
+        const string & path, bool uniqueMaterials) {
+        Logging::Resource->info("ResourceManager::loadModelAsync {} {}", path,
+                                uniqueMaterials);
+
+        fs::path fullPath = resourceAt(path);
+        fs::path cookedPath = cacheAt(path, ".mesh");
+        Logging::Resource->trace("Full path is {}", fullPath.c_str());
+
+        string key = modelKey(path);
+        auto cached = models.find(key);
+        if (cached != models.end()) {
+            Logging::Resource->debug("Using cached model");
+            std::promise<vector<Model::Ptr>> ready;
+            ready.set_value(instantiate(cached->second, uniqueMaterials));
+            return ready.get_future().share();
+        }
+
+        auto pending = pendingModels.find(key);
+        if (pending != pendingModels.end()) {
+            Logging::Resource->debug("Waiting for model already loading");
+            auto & waiter = pending->second.emplace_back();
+            waiter.uniqueMaterials = uniqueMaterials;
+            return waiter.promise.get_future().share();
+        }
+        pendingModels[key];
+
+        struct PreparedModel {
+            CookedMesh mesh;
+            std::exception_ptr error;
+        };
+
+        return loadAsync<vector<Model::Ptr>>(
+            [fullPath, cookedPath]() {
+                // A mesh that fails to load is empty and builds no models
+                PreparedModel prepared;
+                try {
+                    prepareMesh(fullPath, cookedPath, prepared.mesh);
+                }
+                catch (...) {
+                    prepared.error = std::current_exception();
+                }
+                return prepared;
+            },
+            [key, uniqueMaterials](ResourceManager & res,
+                                   PreparedModel & prepared) {
+                auto waiters = move(res.pendingModels[key]);
+                res.pendingModels.erase(key);
+
+                const CachedModel * cached = nullptr;
+                try {
+                    if (prepared.error)
+                        std::rethrow_exception(prepared.error);
+                    if (!prepared.mesh.objects.empty())
+                        cached = &res.addModel(key, prepared.mesh, true);
+                }
+                catch (...) {
+                    for (auto & waiter : waiters)
+                        waiter.promise.set_exception(std::current_exception());
+                    throw;
+                }
+
+                for (auto & waiter : waiters) {
+                    waiter.promise.set_value(
+                        cached ? instantiate(*cached, waiter.uniqueMaterials)
+                               : vector<Model::Ptr>());
+                }
+                return cached ? instantiate(*cached, uniqueMaterials)
+                              : vector<Model::Ptr>();
+            });
+    }
+
+    /// Defines of the variant for a material, see ShaderVariants::uses()
+    static vector<string> variantDefines(const ShaderVariants & variants,
+                                         vector<string> defines,
+                                         const vector<string> & material) {
+        for (auto & define : material) {
+            if (variants.uses(define))
+                defines.push_back(define);
         }
+        return defines;
+    }
 
-        return models;
+    /// Material::getDefines() of a material before it's textures load
+    static vector<string> materialDefines(const CookedMesh::Material & mat) {
+        if (mat.normalTexture.empty())
+            return {};
+        return {Material::NormalMapDefine};
+    }
+
+    /// Defines for how models are drawn, the same for every model
+    static vector<string> drawDefines(bool packMeshes) {
+        if (!packMeshes)
+            return {};
+        return {UniformBlock::DrawListDefine};
     }
 
     inline Transform convertTransform(const scene::Transform & transform) {
         return Transform(transform.pos, glm::quat(transform.rot), transform.scale);
     }
 
+    static void shaderSources(const scene::Shader & shader,
+                              string & vertSource,
+                              string & fragSource) {
+        for (auto & source : shader.source) {
+            if (source.type == "vertex") {
+                vertSource = source.path;
+            }
+            else if (source.type == "fragment") {
+                fragSource = source.path;
+            }
+            else {
+                Logging::Resource->warning("Unknown source type {}",
+                                           source.type);
+            }
+        }
+        if (vertSource.empty())
+            throw ResourceLoadException("No vertex shader source");
+        if (fragSource.empty())
+            throw ResourceLoadException("No fragment shader source");
+    }
+
     static Scene::Ptr convertScene(ResourceManager * res,
+                                   const ModelLoader & loadModel,
                                    shared_ptr<scene::Scene> & resScene) {
         auto scene = make_shared<Scene>();
 
@@ -206,48 +882,140 @@ namespace singe {
         // TODO: Cameras
 
         for (auto & resModel : resScene->models) {
-            auto models = res->loadModel(resModel.mesh.path);
+            auto models = loadModel(resModel.mesh.path);
 
             for (auto & model : models) {
                 model->transform = convertTransform(resModel.transform);
 
                 string vertSource;
                 string fragSource;
-                for (auto & source : resModel.shader.source) {
-                    if (source.type == "vertex") {
-                        vertSource = source.path;
-                    }
-                    else if (source.type == "fragment") {
-                        fragSource = source.path;
-                    }
-                    else {
-                        Logging::Resource->warning("Unknown source type {}",
-                                                   source.type);
-                    }
-                }
-                if (vertSource.empty())
-                    throw ResourceLoadException("No vertex shader source");
-                if (fragSource.empty())
-                    throw ResourceLoadException("No fragment shader source");
-                model->material->shader = res->getShader(vertSource, fragSource);
+                shaderSources(*resModel.shader, vertSource, fragSource);
+                auto variants = res->getShaderVariants(vertSource, fragSource);
+                auto defines = model->material->getDefines();
+                for (auto & define : drawDefines(res->getPackMeshes()))
+                    defines.push_back(define);
+                model->material->shader = res->getShaderVariant(
+                    vertSource, fragSource,
+                    variantDefines(*variants, resModel.shader->defines,
+                                   defines));
                 scene->models.emplace_back(model);
             }
+        }
+
+        for (auto & child : resScene->children) {
+            scene->children.emplace_back(convertScene(res, loadModel, child));
+        }
+
+        return scene;
+    }
+
+    /// The material and draw defines of each shader used by the models of
+    /// a scene
+    using SceneVariants =
+        map<const scene::Shader *, std::set<vector<string>>>;
+
+    static void collectVariants(
+        const shared_ptr<scene::Scene> & resScene,
+        const map<string, shared_ptr<CookedMesh>> & meshes,
+        const vector<string> & draw,
+        SceneVariants & variants) {
+        for (auto & resModel : resScene->models) {
+            auto & defines = variants[resModel.shader.get()];
+            auto mesh = meshes.find(resModel.mesh.path);
+            if (mesh == meshes.end() || mesh->second->materials.empty()) {
+                defines.insert(draw);
+                continue;
+            }
+            for (auto & mat : mesh->second->materials) {
+                auto material = materialDefines(mat);
+                material.insert(material.end(), draw.begin(), draw.end());
+                defines.insert(material);
+            }
+        }
+        for (auto & child : resScene->children)
+            collectVariants(child, meshes, draw, variants);
+    }
+
+    void ResourceManager::precompileShaders(
+        const shared_ptr<scene::Scene> & scene,
+        const map<string, shared_ptr<CookedMesh>> & meshes) {
+        SceneVariants shaders;
+        collectVariants(scene, meshes, drawDefines(packMeshes), shaders);
+
+        vector<std::pair<ShaderVariants::Ptr, ShaderVariants::Mask>> requests;
+        for (auto & [shader, materials] : shaders) {
+            string vertSource;
+            string fragSource;
+            shaderSources(*shader, vertSource, fragSource);
+            auto variants = getShaderVariants(vertSource, fragSource);
+            for (auto & material : materials) {
+                auto defines =
+                    variantDefines(*variants, shader->defines, material);
+                requests.emplace_back(variants, variants->getMask(defines));
+            }
+        }
+
+        size_t linked = ShaderVariants::precompile(requests, programs());
+        Logging::Resource->debug("Linked {} shader variants for scene", linked);
+    }
 
-            // TODO: mesh
-            // model->res->loadModel()
-            res->loadModel(resModel.mesh.path);
+    static void collectMeshes(const shared_ptr<scene::Scene> & resScene,
+                              std::set<string> & meshes) {
+        for (auto & resModel : resScene->models)
+            meshes.insert(resModel.mesh.path);
+        for (auto & child : resScene->children)
+            collectMeshes(child, meshes);
+    }
 
-            // TODO: shader
-            // model->material->shader = res->loadShader()
+    shared_ptr<scene::Scene> ResourceManager::readScene(
+        const fs::path & source,
+        const fs::path & cooked,
+        scene::SceneHandler & handler) {
+        scene::BinaryScene binary;
+        if (binary.load(source)) {
+            Logging::Resource->debug("Loading binary scene");
+            return binary.toScene();
+        }
 
-            // scene->models.emplace_back(model);
+        if (!cooked.empty() && binary.load(cooked)
+            && binary.isCurrent(source)) {
+            Logging::Resource->debug("Using binary scene {}", cooked.c_str());
+            return binary.toScene();
         }
 
-        for (auto & child : resScene->children) {
-            scene->children.emplace_back(convertScene(res, child));
+        ifstream is(source);
+        if (!is.is_open())
+            return nullptr;
+
+        auto resScene = scene::SceneParser().parse(is, handler);
+        if (!cooked.empty()
+            && !scene::BinaryScene::write(*resScene, cooked, source))
+            Logging::Resource->warning("Failed to write binary scene {}",
+                                       cooked.c_str());
+        return resScene;
+    }
+
+    void ResourceManager::loadTextures(const std::set<string> & paths) {
+        bool compress = compressTextures();
+        map<string, std::future<CookedTexture::Ptr>> decoded;
+        for (auto & path : paths) {
+            auto cached = textures.find(path);
+            if (cached != textures.end() && cached->second->isLoaded())
+                continue;
+            decoded[path] = cookTexture(path, compress);
         }
 
-        return scene;
+        for (auto & [path, future] : decoded) {
+            auto cooked = future.get();
+            // Left for getTexture() to report
+            if (!cooked)
+                continue;
+
+            auto & texture = textures[path];
+            if (!texture)
+                texture = makeTexture();
+            uploadTexture(*texture, *cooked);
+        }
     }
 
     Scene::Ptr ResourceManager::loadScene(const string & path) {
@@ -256,15 +1024,213 @@ namespace singe {
         fs::path fullPath = resourceAt(path);
         Logging::Resource->trace("Full path is {}", fullPath.c_str());
 
-        ifstream is(fullPath);
-        if (!is.is_open()) {
+        // Each mesh is loaded once, no matter how many models reference it
+        struct MeshLoader : public scene::SceneHandler {
+            ResourceManager & res;
+            std::set<string> paths;
+            map<string, std::future<shared_ptr<CookedMesh>>> pending;
+
+            MeshLoader(ResourceManager & res) : res(res) {}
+
+            void load(const string & path) {
+                if (!paths.insert(path).second
+                    || res.models.count(res.modelKey(path)))
+                    return;
+                fs::path source = res.resourceAt(path);
+                fs::path cooked = res.cacheAt(path, ".mesh");
+                pending[path] = res.workers().submit([source, cooked]() {
+                    auto mesh = make_shared<CookedMesh>();
+                    prepareMesh(source, cooked, *mesh);
+                    return mesh;
+                });
+            }
+
+            bool onModel(scene::Scene &, const scene::Model & model) override {
+                // Start loading while the rest of the scene is parsed
+                load(model.mesh.path);
+                return true;
+            }
+        };
+
+        MeshLoader loader(*this);
+        auto resScene = readScene(fullPath, cacheAt(path, ".scene"), loader);
+        if (!resScene) {
             Logging::Resource->error("Failed to open scene file {}",
                                      fullPath.c_str());
             return nullptr;
         }
 
-        auto resScene = scene::SceneParser().parse(is);
-        auto scene = convertScene(this, resScene);
+        // Models are not passed to loader when the scene is binary
+        std::set<string> paths;
+        collectMeshes(resScene, paths);
+        for (auto & path : paths) loader.load(path);
+        Logging::Resource->debug("Scene references {} meshes", paths.size());
+        auto & pending = loader.pending;
+
+        map<string, shared_ptr<CookedMesh>> meshes;
+        for (auto & [path, future] : pending)
+            meshes[path] = future.get();
+
+        std::set<string> texturePaths;
+        for (auto & [path, mesh] : meshes) {
+            for (auto & mat : mesh->materials) {
+                for (auto * texture :
+                     {&mat.texture, &mat.normalTexture, &mat.specularTexture}) {
+                    if (!texture->empty())
+                        texturePaths.insert(*texture);
+                }
+            }
+        }
+        loadTextures(texturePaths);
+        precompileShaders(resScene, meshes);
+
+        auto scene = convertScene(
+            this,
+            [&](const string & path) {
+                string key = modelKey(path);
+                auto cached = models.find(key);
+                if (cached != models.end())
+                    return instantiate(cached->second, true);
+
+                auto mesh = meshes.find(path);
+                if (mesh == meshes.end() || mesh->second->objects.empty())
+                    return vector<Model::Ptr>();
+                return instantiate(addModel(key, *mesh->second, false), true);
+            },
+            resScene);
         return scene;
     }
+
+    shared_future<Scene::Ptr> ResourceManager::loadSceneAsync(
+        const string & path) {
+        Logging::Resource->info("ResourceManager::loadSceneAsync {}", path);
+
+        fs::path fullPath = resourceAt(path);
+        Logging::Resource->trace("Full path is {}", fullPath.c_str());
+
+        struct SceneShader {
+            /// Created on the worker, only uses() is called there
+            ShaderVariants::Ptr variants;
+            std::set<vector<string>> defines;
+        };
+
+        struct PreparedScene {
+            shared_ptr<scene::Scene> scene;
+            map<string, shared_ptr<CookedMesh>> meshes;
+            /// Keyed like shaderVariants
+            map<string, SceneShader> shaders;
+            std::exception_ptr error;
+        };
+
+        fs::path cookedPath = cacheAt(path, ".scene");
+
+        auto promise = make_shared<std::promise<Scene::Ptr>>();
+        shared_future<Scene::Ptr> future = promise->get_future().share();
+
+        auto queue = uploads;
+        queue->loading++;
+
+        workers().submit([queue, promise, fullPath, cookedPath, root = root,
+                          cacheRoot = cacheRoot,
+                          draw = drawDefines(packMeshes)]() {
+            auto prepared = make_shared<PreparedScene>();
+            try {
+                scene::SceneHandler handler;
+                prepared->scene = readScene(fullPath, cookedPath, handler);
+                if (!prepared->scene)
+                    throw ResourceLoadException("Failed to open scene file "
+                                                + fullPath.string());
+
+                std::set<string> paths;
+                collectMeshes(prepared->scene, paths);
+                for (auto & path : paths) {
+                    fs::path source = resolveResource(root, path);
+                    fs::path cooked = resolveCache(cacheRoot, path, ".mesh");
+                    auto mesh = make_shared<CookedMesh>();
+                    if (prepareMesh(source, cooked, *mesh))
+                        prepared->meshes[path] = mesh;
+                }
+
+                SceneVariants shaders;
+                collectVariants(prepared->scene, prepared->meshes, draw,
+                                shaders);
+                for (auto & [shader, materials] : shaders) {
+                    string vertPath;
+                    string fragPath;
+                    shaderSources(*shader, vertPath, fragPath);
+                    auto & sources = prepared->shaders[vertPath + fragPath];
+                    if (!sources.variants)
+                        sources.variants = make_shared<ShaderVariants>(
+                            readShaderSource(resolveResource(root, vertPath)),
+                            readShaderSource(resolveResource(root, fragPath)),
+                            vertPath + " " + fragPath);
+                    for (auto & material : materials)
+                        sources.defines.insert(variantDefines(
+                            *sources.variants, shader->defines, material));
+                }
+            }
+            catch (...) {
+                prepared->error = std::current_exception();
+            }
+
+            // Each link and each model is it's own upload so that
+            // processUploads() can spread them over frames
+            auto run = [prepared](auto && job) {
+                return [prepared, job](ResourceManager & res) {
+                    if (prepared->error)
+                        return;
+                    try {
+                        job(res);
+                    }
+                    catch (...) {
+                        prepared->error = std::current_exception();
+                    }
+                };
+            };
+
+            for (auto & [key, sources] : prepared->shaders) {
+                for (auto & defines : sources.defines) {
+                    queue->push(run([&sources, key = key,
+                                     defines](ResourceManager & res) {
+                        auto & variants = res.shaderVariants[key];
+                        if (!variants)
+                            variants = sources.variants;
+                        variants->get(variants->getMask(defines),
+                                      res.programs());
+                    }));
+                }
+            }
+
+            for (auto & [path, mesh] : prepared->meshes) {
+                queue->push(
+                    run([path = path, mesh = mesh](ResourceManager & res) {
+                        res.addModel(res.modelKey(path), *mesh, true);
+                    }));
+            }
+
+            queue->push([queue, promise, prepared](ResourceManager & res) {
+                queue->loading--;
+                try {
+                    if (prepared->error)
+                        std::rethrow_exception(prepared->error);
+
+                    // Models were added by the uploads above or were already
+                    // cached
+                    ModelLoader loadModel = [&](const string & path) {
+                        auto cached = res.models.find(res.modelKey(path));
+                        if (cached == res.models.end())
+                            return vector<Model::Ptr>();
+                        return instantiate(cached->second, true);
+                    };
+                    promise->set_value(
+                        convertScene(&res, loadModel, prepared->scene));
+                }
+                catch (...) {
+                    promise->set_exception(std::current_exception());
+                }
+            });
+        });
+
+        return future;
+    }
 }
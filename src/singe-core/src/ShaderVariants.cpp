@@ -0,0 +1,181 @@
+#include "singe/Core/ShaderVariants.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <set>
+
+#include "singe/Core/ResourceManager.hpp"
+
+namespace singe {
+    using std::make_shared;
+    using std::move;
+
+    namespace {
+        string insertDefines(const string & source, const string & defines) {
+            // #version must stay the first directive of the source
+            size_t version = source.find("#version");
+            size_t at = 0;
+            if (version != string::npos) {
+                at = source.find('\n', version);
+                at = at == string::npos ? source.size() : at + 1;
+            }
+
+            string out;
+            out.reserve(source.size() + defines.size() + 1);
+            out.append(source, 0, at);
+            if (at > 0 && source[at - 1] != '\n')
+                out += '\n';
+            out += defines;
+            out.append(source, at, string::npos);
+            return out;
+        }
+
+        bool isIdentifier(char c) {
+            return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+        }
+
+        /// Does word appear in source as a whole identifier
+        bool containsWord(const string & source, const string & word) {
+            if (word.empty())
+                return false;
+            for (size_t at = source.find(word); at != string::npos;
+                 at = source.find(word, at + 1)) {
+                size_t end = at + word.size();
+                if ((at == 0 || !isIdentifier(source[at - 1]))
+                    && (end == source.size() || !isIdentifier(source[end])))
+                    return true;
+            }
+            return false;
+        }
+    }
+
+    ShaderVariants::ShaderVariants(const string & vertexSource,
+                                   const string & fragmentSource,
+                                   const string & name)
+        : vertexSource(vertexSource),
+          fragmentSource(fragmentSource),
+          name(name) {}
+
+    ShaderVariants::ShaderVariants(ShaderVariants && other)
+        : vertexSource(move(other.vertexSource)),
+          fragmentSource(move(other.fragmentSource)),
+          name(move(other.name)),
+          keys(move(other.keys)),
+          variants(move(other.variants)) {}
+
+    ShaderVariants & ShaderVariants::operator=(ShaderVariants && other) {
+        vertexSource = move(other.vertexSource);
+        fragmentSource = move(other.fragmentSource);
+        name = move(other.name);
+        keys = move(other.keys);
+        variants = move(other.variants);
+        return *this;
+    }
+
+    ShaderVariants::~ShaderVariants() {}
+
+    ShaderVariants::Mask ShaderVariants::getMask(
+        const vector<string> & defines) {
+        Mask mask = 0;
+        for (auto & define : defines) {
+            auto it = std::find(keys.begin(), keys.end(), define);
+            if (it == keys.end()) {
+                if (keys.size() == MaxKeys)
+                    throw ResourceLoadException("Too many defines for " + name);
+                it = keys.insert(keys.end(), define);
+            }
+            mask |= Mask(1) << (it - keys.begin());
+        }
+        return mask;
+    }
+
+    bool ShaderVariants::uses(const string & define) const {
+        return containsWord(vertexSource, define)
+               || containsWord(fragmentSource, define);
+    }
+
+    const vector<string> & ShaderVariants::getKeys() const {
+        return keys;
+    }
+
+    ProgramCache::Sources ShaderVariants::getSources(Mask mask) const {
+        vector<string> names;
+        for (size_t i = 0; i < keys.size(); i++) {
+            if (mask & (Mask(1) << i))
+                names.push_back(keys[i]);
+        }
+        // Bits follow first use, names do not
+        std::sort(names.begin(), names.end());
+
+        string defines;
+        string suffix;
+        for (auto & key : names) {
+            defines += "#define " + key + "\n";
+            suffix += " " + key;
+        }
+        if (defines.empty())
+            return {vertexSource, fragmentSource, name};
+        return {insertDefines(vertexSource, defines),
+                insertDefines(fragmentSource, defines), name + suffix};
+    }
+
+    Shader::Ptr ShaderVariants::find(Mask mask) const {
+        auto it = variants.find(mask);
+        return it != variants.end() ? it->second : nullptr;
+    }
+
+    bool ShaderVariants::findMask(const Shader & shader, Mask & mask) const {
+        for (auto & [variant, linked] : variants) {
+            if (linked.get() == &shader) {
+                mask = variant;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    Shader::Ptr ShaderVariants::get(Mask mask, const ProgramCache & programs) {
+        auto it = variants.find(mask);
+        if (it != variants.end())
+            return it->second;
+
+        auto sources = getSources(mask);
+        Logging::Resource->debug("Linking shader variant {}", sources.name);
+        auto shader = make_shared<Shader>(
+            programs.link(sources.vertex, sources.fragment, sources.name));
+        variants[mask] = shader;
+        return shader;
+    }
+
+    size_t ShaderVariants::precompile(
+        const vector<std::pair<Ptr, Mask>> & requests,
+        const ProgramCache & programs) {
+        vector<std::pair<Ptr, Mask>> missing;
+        vector<ProgramCache::Sources> sources;
+        std::set<std::pair<ShaderVariants *, Mask>> seen;
+        for (auto & [variants, mask] : requests) {
+            if (variants->find(mask)
+                || !seen.emplace(variants.get(), mask).second)
+                continue;
+            missing.emplace_back(variants, mask);
+            sources.push_back(variants->getSources(mask));
+        }
+        if (missing.empty())
+            return 0;
+
+        Logging::Resource->debug("Linking {} shader variants", missing.size());
+        vector<string> errors;
+        auto linked = programs.linkAll(sources, errors);
+        size_t count = 0;
+        for (size_t i = 0; i < missing.size(); i++) {
+            if (!linked[i]) {
+                Logging::Resource->error("{}", errors[i]);
+                continue;
+            }
+            auto & [variants, mask] = missing[i];
+            variants->variants[mask] = make_shared<Shader>(linked[i]);
+            count++;
+        }
+        return count;
+    }
+}
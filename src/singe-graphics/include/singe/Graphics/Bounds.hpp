@@ -0,0 +1,109 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+namespace singe {
+    using glm::mat4;
+    using glm::vec3;
+    using glm::vec4;
+
+    /**
+     * Axis aligned bounding box.
+     *
+     * A default constructed AABB is empty and will not intersect anything.
+     * An infinite AABB contains everything and is never culled.
+     */
+    struct AABB {
+        vec3 min;
+        vec3 max;
+
+        /**
+         * Create an empty AABB.
+         */
+        AABB();
+
+        /**
+         * Create an AABB from it's corners.
+         *
+         * @param min the minimum corner
+         * @param max the maximum corner
+         */
+        AABB(const vec3 & min, const vec3 & max);
+
+        /**
+         * Create an AABB that contains everything.
+         *
+         * @return the infinite AABB
+         */
+        static AABB infinite();
+
+        /**
+         * Does this AABB contain no points.
+         *
+         * @return is the AABB empty
+         */
+        bool isEmpty() const;
+
+        /**
+         * Does this AABB contain everything.
+         *
+         * @return is the AABB infinite
+         */
+        bool isInfinite() const;
+
+        /**
+         * Grow this AABB to contain point.
+         *
+         * @param point the point to contain
+         */
+        void extend(const vec3 & point);
+
+        /**
+         * Grow this AABB to contain other.
+         *
+         * @param other the AABB to contain
+         */
+        void extend(const AABB & other);
+
+        /**
+         * Get the AABB containing this AABB after being transformed by
+         * matrix.
+         *
+         * @param matrix the transform matrix
+         *
+         * @return the transformed AABB
+         */
+        AABB transformed(const mat4 & matrix) const;
+    };
+
+    /**
+     * View frustum planes extracted from a view projection matrix.
+     */
+    class Frustum {
+        vec4 planes[6];
+
+    public:
+        /**
+         * Create a Frustum from the identity matrix, the clip space cube.
+         */
+        Frustum();
+
+        /**
+         * Create a Frustum from a view projection matrix. Planes will be in
+         * world space.
+         *
+         * @param vp the view projection matrix
+         */
+        Frustum(const mat4 & vp);
+
+        /**
+         * Test if any part of box is inside the frustum. This is conservative
+         * and may return true for boxes near a corner of the frustum.
+         *
+         * @param box the AABB in world space
+         *
+         * @return false if box is fully outside the frustum
+         */
+        bool intersects(const AABB & box) const;
+    };
+}
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace singe {
+    /**
+     * Shadow copy of OpenGL binding and fixed function state.
+     *
+     * Each setter compares with the shadowed value and only calls OpenGL when
+     * the state would change. Calls are counted as issued or skipped in the
+     * Stats.
+     *
+     * State starts out unknown so the first call to each setter is always
+     * issued. Any code that changes this state without going through the
+     * cache (ie. SFML drawing, glpp bind() calls) must call one of the
+     * invalidate methods afterwards.
+     *
+     * There is one cache for the OpenGL context, use GLStateCache::current()
+     * from the thread that owns the context.
+     */
+    class GLStateCache {
+    public:
+        /**
+         * Counters of state changes since the last call to
+         * GLStateCache::resetStats().
+         */
+        struct Stats {
+            /// Number of OpenGL calls made
+            size_t issued = 0;
+            /// Number of OpenGL calls skipped because state was unchanged
+            size_t skipped = 0;
+        };
+
+        /// Number of texture units that are shadowed
+        static constexpr GLuint TextureUnits = 16;
+
+    private:
+        struct TextureBinding {
+            GLenum target;
+            GLuint name;
+        };
+
+        enum Toggle : int8_t {
+            Unknown = -1,
+            Disabled = 0,
+            Enabled = 1,
+        };
+
+        GLuint program;
+        GLuint vertexArray;
+        GLuint activeUnit;
+        TextureBinding textures[TextureUnits];
+        Toggle blend;
+        Toggle depthTest;
+        Toggle cullFace;
+        GLenum blendSrc;
+        GLenum blendDst;
+        GLenum depthFunc;
+        GLenum cullMode;
+        GLenum frontFace;
+        Stats stats;
+
+        bool change(bool changed);
+
+        void setToggle(Toggle & toggle, GLenum cap, bool enabled);
+
+        void setActiveUnit(GLuint unit);
+
+        GLStateCache();
+
+    public:
+        GLStateCache(const GLStateCache &) = delete;
+        GLStateCache & operator=(const GLStateCache &) = delete;
+
+        /**
+         * Get the cache for the current OpenGL context.
+         *
+         * @return the GLStateCache
+         */
+        static GLStateCache & current();
+
+        /**
+         * Forget all shadowed state.
+         */
+        void invalidate();
+
+        /**
+         * Forget the shadowed program.
+         */
+        void invalidateProgram();
+
+        /**
+         * Forget the shadowed vertex array.
+         */
+        void invalidateVertexArray();
+
+        /**
+         * Forget the shadowed active unit and texture bindings.
+         */
+        void invalidateTextures();
+
+        /**
+         * Call glUseProgram if program is not in use.
+         *
+         * @param program the program name
+         */
+        void useProgram(GLuint program);
+
+        /**
+         * Call glBindVertexArray if vertexArray is not bound.
+         *
+         * @param vertexArray the vertex array name
+         */
+        void bindVertexArray(GLuint vertexArray);
+
+        /**
+         * Bind texture to unit if it is not already bound there.
+         *
+         * @param unit the texture unit starting at 0
+         * @param target the texture target, ie. GL_TEXTURE_2D
+         * @param texture the texture name
+         */
+        void bindTexture(GLuint unit, GLenum target, GLuint texture);
+
+        /**
+         * Enable or disable GL_BLEND.
+         *
+         * @param enabled should blending be enabled
+         */
+        void setBlend(bool enabled);
+
+        /**
+         * Set the blend function.
+         *
+         * @param src the source factor
+         * @param dst the destination factor
+         */
+        void setBlendFunc(GLenum src, GLenum dst);
+
+        /**
+         * Enable or disable GL_DEPTH_TEST.
+         *
+         * @param enabled should depth testing be enabled
+         */
+        void setDepthTest(bool enabled);
+
+        /**
+         * Set the depth compare function.
+         *
+         * @param func the depth function, ie. GL_LEQUAL
+         */
+        void setDepthFunc(GLenum func);
+
+        /**
+         * Enable or disable GL_CULL_FACE.
+         *
+         * @param enabled should face culling be enabled
+         */
+        void setCullFace(bool enabled);
+
+        /**
+         * Set which faces are culled.
+         *
+         * @param mode the cull mode, ie. GL_BACK
+         */
+        void setCullMode(GLenum mode);
+
+        /**
+         * Set the winding of front faces.
+         *
+         * @param mode the front face winding, ie. GL_CCW
+         */
+        void setFrontFace(GLenum mode);
+
+        /**
+         * Get the counters since the last reset.
+         *
+         * @return the Stats
+         */
+        const Stats & getStats() const;
+
+        /**
+         * Reset the counters to 0.
+         */
+        void resetStats();
+    };
+}
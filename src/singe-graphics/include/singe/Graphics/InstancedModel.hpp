@@ -0,0 +1,137 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <glpp/extra/Transform.hpp>
+#include <memory>
+#include <vector>
+
+#include "Model.hpp"
+
+namespace singe {
+    using std::shared_ptr;
+    using std::vector;
+    using glpp::extra::Transform;
+
+    /**
+     * Model drawn many times with a single draw call.
+     *
+     * The mesh points are buffered once and each instance transform is
+     * streamed into an instance buffer as a mat4 at attribute locations 3
+     * through 6. The instanced model has it's own vertex array that reads the
+     * Mesh buffers, so the Mesh can still be shared. The shader must read
+     * this attribute and apply it before the mvp uniform, see
+     * examples/res/shader/instanced.vert.
+     *
+     * The decode matrix of a Quantized Mesh is applied to the instance
+     * matrices, and they are rebuilt when it changes. It scales uniformly, so
+     * a shader that transforms normals by the instance matrix must normalize
+     * them, as instanced.vert does.
+     *
+     * Remember to call InstancedModel::updateInstances() after making changes
+     * to instances, and after Model::update() to update the bounds.
+     */
+    class InstancedModel : public Model {
+    public:
+        using Ptr = shared_ptr<InstancedModel>;
+        using ConstPtr = const shared_ptr<InstancedModel>;
+
+        /// First attribute location of the instance mat4
+        static constexpr GLuint InstanceAttribute = 3;
+
+    private:
+        GLuint instanceBuffer;
+        size_t instanceCount;
+        AABB instanceBounds;
+        mutable GLuint instanceArray;
+        /// Model revision the instance vertex array was built for
+        mutable uint64_t instanceRevision;
+        /// VertexArena generation the instance vertex array was built for
+        mutable uint64_t instanceGeneration;
+        /// Instance matrices before the decode matrix is applied
+        vector<mat4> instanceMatrices;
+        /// Decode matrix applied to the instance buffer
+        mutable mat4 instanceDecode;
+
+        mat4 meshDecode() const;
+
+        vector<mat4> decodeInstances() const;
+
+        uint64_t arenaGeneration() const;
+
+        void attachMesh() const;
+
+    public:
+        /// Transform of each instance, relative to Model::transform
+        vector<Transform> instances;
+
+        /**
+         * Create an empty InstancedModel. This will do nothing until points
+         * and instances are added and both Model::update() and
+         * InstancedModel::updateInstances() are called.
+         */
+        InstancedModel();
+
+        /**
+         * Create an InstancedModel from an existing Model, taking it's mesh
+         * and material. There are no instances until some are added and
+         * InstancedModel::updateInstances() is called.
+         *
+         * @param model the Model to take the mesh from
+         */
+        InstancedModel(Model && model);
+
+        /// @brief  Move constructor
+        /// @param other Other InstancedModel to move fields from
+        InstancedModel(InstancedModel && other);
+
+        /// @brief Move operator
+        /// @param other Other InstancedModel to move fields from
+        /// @return This InstancedModel
+        InstancedModel & operator=(InstancedModel && other);
+
+        InstancedModel(const InstancedModel &) = delete;
+        InstancedModel & operator=(const InstancedModel &) = delete;
+
+        ~InstancedModel();
+
+        /**
+         * Buffer the instance transforms into the instance buffer.
+         *
+         * This method must be called after any changes to instances and after
+         * Model::update() to update the bounds of all instances.
+         *
+         * @param usage glpp::Buffer usage hint
+         */
+        void updateInstances(Buffer::Usage usage = Buffer::Dynamic);
+
+        /**
+         * Get the bounding box containing every instance in model space.
+         * This is calculated by InstancedModel::updateInstances().
+         *
+         * @return the model space AABB of all instances
+         */
+        const AABB & getBounds() const override;
+
+        /**
+         * Draw all instances of the vertex buffer with one draw call.
+         */
+        void drawMesh() const override;
+
+        /**
+         * Instances are drawn by InstancedModel::drawMesh().
+         *
+         * @return false
+         */
+        bool canMultiDraw() const override;
+
+        /**
+         * The decode matrix of a Quantized mesh must be applied before the
+         * instance matrix, so it is applied to the instance matrices instead
+         * and this does nothing.
+         *
+         * @param state unchanged
+         */
+        void applyDecode(RenderState & state) const override;
+    };
+}
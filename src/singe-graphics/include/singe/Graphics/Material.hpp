@@ -1,17 +1,20 @@
 #pragma once
 
 #include <glm/glm.hpp>
-#include <glpp/Texture.hpp>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "Shader.hpp"
+#include "Texture.hpp"
+#include "TextureArray.hpp"
+#include "UniformBlock.hpp"
 
 namespace singe {
     using std::shared_ptr;
     using std::string;
+    using std::vector;
     using glm::vec3;
-    using glpp::Texture;
 
     /**
      * Material properties, textures and shader.
@@ -20,6 +23,16 @@ namespace singe {
         using Ptr = shared_ptr<Material>;
         using ConstPtr = const shared_ptr<Material>;
 
+        /// Texture unit textureArray is bound to
+        static constexpr GLuint TextureArrayUnit = 3;
+        /// Name of the sampler2DArray uniform that samples textureArray
+        static constexpr const char * TextureArrayName = "gTextureArray";
+        /// Define of the shader variant that samples textureArray
+        static constexpr const char * TextureArrayDefine =
+            "SINGE_TEXTURE_ARRAY";
+        /// Define of the shader variant that samples normalTexture
+        static constexpr const char * NormalMapDefine = "SINGE_NORMAL_MAP";
+
         Shader::Ptr shader;
 
         string name;
@@ -29,7 +42,21 @@ namespace singe {
         Texture::Ptr texture;
         Texture::Ptr normalTexture;
         Texture::Ptr specularTexture;
+        /**
+         * Array holding the albedo texture in place of texture, shared with
+         * other materials. Sampled as a sampler2DArray called
+         * TextureArrayName on TextureArrayUnit with layer from the
+         * SingeMaterial block, the shipped shaders do this when
+         * TextureArrayDefine is defined.
+         */
+        TextureArray::Ptr textureArray;
+        /// Layer of textureArray
+        int textureLayer;
 
+    private:
+        mutable UniformBlock::Ptr block;
+
+    public:
         Material();
 
         Material(Material && other);
@@ -42,8 +69,46 @@ namespace singe {
         ~Material();
 
         /**
-         * Bind the shader and textures.
+         * Create a new Material with the same properties, textures and shader.
+         * The textures and shader are shared, not copied.
+         *
+         * @return shared_ptr to the new Material
+         */
+        Ptr clone() const;
+
+        /**
+         * Get the shader defines for the textures this material has, ie.
+         * TextureArrayDefine if textureArray is set and NormalMapDefine if
+         * normalTexture is set.
+         *
+         * @return the define keys
+         */
+        vector<string> getDefines() const;
+
+        /**
+         * Bind the shader, textures and uniforms.
          */
         void bind() const;
+
+        /**
+         * Bind only the textures, each to it's texture unit.
+         */
+        void bindTextures() const;
+
+        /**
+         * Bind the SingeMaterial block if the shader declares it. The block is
+         * created on first use and only uploaded when the material properties
+         * change.
+         */
+        void bindUniforms() const;
+
+        /**
+         * Write the SingeMaterial block data in the std140 layout, ie. into
+         * an entry of the SingeDrawList block.
+         *
+         * @param out the destination, must hold UniformBlock::MaterialSize
+         *            bytes
+         */
+        void writeUniforms(uint8_t * out) const;
     };
 }
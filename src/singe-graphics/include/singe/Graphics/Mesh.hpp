@@ -0,0 +1,238 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <glpp/extra/Vertex.hpp>
+#include <memory>
+
+#include "Bounds.hpp"
+#include "VertexArena.hpp"
+#include "VertexFormat.hpp"
+
+namespace singe {
+    using std::shared_ptr;
+    using glpp::extra::Vertex;
+
+    /**
+     * Vertex and index buffers of a triangle mesh with a vertex array that
+     * reads them.
+     *
+     * A Mesh holds no CPU copy of it's points and can be shared between any
+     * number of Model instances, each with it's own transform and material.
+     *
+     * The vertex attributes are position at location 0, normal at location 1
+     * and texture coordinate at location 2.
+     *
+     * A Mesh created with a VertexArena has no buffers of it's own, it's
+     * points are placed in the arena and it is drawn with the arena's vertex
+     * array.
+     *
+     * The points are encoded in the VertexFormat given when the Mesh is
+     * created, or the format of it's arena. A Quantized mesh gets a new
+     * quantization box from it's bounds each time Mesh::update() is called.
+     */
+    class Mesh {
+    public:
+        using Ptr = shared_ptr<Mesh>;
+        using ConstPtr = const shared_ptr<Mesh>;
+
+        /// Attribute location of Vertex::pos
+        static constexpr GLuint PositionAttribute = 0;
+        /// Attribute location of Vertex::norm
+        static constexpr GLuint NormalAttribute = 1;
+        /// Attribute location of Vertex::uv
+        static constexpr GLuint TexCoordAttribute = 2;
+
+    private:
+        VertexArena::Ptr arena;
+        VertexArena::Range range;
+        VertexFormat format;
+        GLuint vertexBuffer;
+        GLuint indexBuffer;
+        GLuint vertexArray;
+        GLenum indexType;
+        GLenum usage;
+        size_t vertexCount;
+        size_t indexCount;
+        AABB bounds;
+
+    public:
+        /**
+         * Create an empty Mesh. This will draw nothing until
+         * Mesh::update() is called.
+         *
+         * @param type the layout the points are buffered in
+         */
+        Mesh(VertexFormat::Type type = VertexFormat::Float);
+
+        /**
+         * Create a Mesh and buffer vertices and indices.
+         *
+         * @param vertices the points of the mesh
+         * @param vertexCount the number of vertices
+         * @param indices 3 indices into vertices for each triangle, or nullptr
+         *                to draw vertices as a triangle list
+         * @param indexCount the number of indices
+         * @param usage buffer usage hint, ie. GL_STATIC_DRAW
+         * @param type the layout the points are buffered in
+         */
+        Mesh(const Vertex * vertices,
+             size_t vertexCount,
+             const uint32_t * indices,
+             size_t indexCount,
+             GLenum usage = GL_STATIC_DRAW,
+             VertexFormat::Type type = VertexFormat::Float);
+
+        /**
+         * Create a Mesh in a VertexArena. The points are buffered in the
+         * layout of the arena.
+         *
+         * @param arena the VertexArena to place the mesh in
+         * @param vertices the points of the mesh
+         * @param vertexCount the number of vertices
+         * @param indices 3 indices into vertices for each triangle, or nullptr
+         *                to draw vertices as a triangle list
+         * @param indexCount the number of indices
+         */
+        Mesh(const VertexArena::Ptr & arena,
+             const Vertex * vertices,
+             size_t vertexCount,
+             const uint32_t * indices,
+             size_t indexCount);
+
+        /// @brief  Move constructor
+        Mesh(Mesh && other);
+
+        /// @brief  Move assignment
+        Mesh & operator=(Mesh && other);
+
+        Mesh(const Mesh &) = delete;
+        Mesh & operator=(const Mesh &) = delete;
+
+        ~Mesh();
+
+        /**
+         * Replace the contents of the buffers.
+         *
+         * Indices are buffered as 16 bit if all vertices can be addressed,
+         * otherwise they are buffered as 32 bit. A mesh in a VertexArena is
+         * moved to a new Range of the arena and usage is ignored.
+         *
+         * @param vertices the points of the mesh
+         * @param vertexCount the number of vertices
+         * @param indices 3 indices into vertices for each triangle, or nullptr
+         *                to draw vertices as a triangle list
+         * @param indexCount the number of indices
+         * @param usage buffer usage hint, ie. GL_STATIC_DRAW
+         */
+        void update(const Vertex * vertices,
+                    size_t vertexCount,
+                    const uint32_t * indices,
+                    size_t indexCount,
+                    GLenum usage = GL_STATIC_DRAW);
+
+        /**
+         * Overwrite part of the vertex buffer in place with glBufferSubData.
+         * The buffers are not reallocated and indices are left unchanged.
+         *
+         * The bounds are extended to include the new points but never shrink,
+         * call Mesh::update() to recompute them exactly.
+         *
+         * @param first the index of the first vertex to replace
+         * @param vertices the new points
+         * @param count the number of vertices to replace
+         *
+         * @return false if the vertices are outside the mesh, or a Quantized
+         *         point is outside the quantization box, nothing is written
+         */
+        bool updateVertices(size_t first,
+                            const Vertex * vertices,
+                            size_t count);
+
+        /**
+         * Bind the buffers and enable the vertex attributes on the vertex
+         * array that is currently bound. Used to build a vertex array with
+         * extra attributes that reads this mesh, ie. by InstancedModel.
+         */
+        void attach() const;
+
+        /**
+         * Get the VertexArena the mesh is placed in.
+         *
+         * @return the VertexArena or nullptr if the mesh has it's own buffers
+         */
+        const VertexArena::Ptr & getArena() const;
+
+        /**
+         * Get the Range of the arena holding the mesh.
+         *
+         * @return the Range, empty if the mesh is not in an arena
+         */
+        const VertexArena::Range & getRange() const;
+
+        /**
+         * Get the layout and quantization of the points.
+         *
+         * @return the VertexFormat
+         */
+        const VertexFormat & getFormat() const;
+
+        /**
+         * Get the vertex array that reads this mesh.
+         *
+         * @return the vertex array name, shared with all meshes in the same
+         *         arena
+         */
+        GLuint getVertexArray() const;
+
+        /**
+         * Get the type of the index buffer.
+         *
+         * @return GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+         */
+        GLenum getIndexType() const;
+
+        /**
+         * Get the usage hint the buffers were last created with.
+         *
+         * @return the usage hint, GL_STATIC_DRAW for a mesh in a VertexArena
+         */
+        GLenum getUsage() const;
+
+        /**
+         * Get the number of vertices.
+         *
+         * @return the vertex count
+         */
+        size_t getVertexCount() const;
+
+        /**
+         * Get the number of indices.
+         *
+         * @return the index count, 0 if the mesh is a triangle list that is
+         *         not in an arena
+         */
+        size_t getIndexCount() const;
+
+        /**
+         * Get the byte offset of the first index in the index buffer.
+         *
+         * @return the offset to pass to glDrawElements
+         */
+        size_t getIndexOffset() const;
+
+        /**
+         * Get the bounding box of the vertices.
+         *
+         * @return the AABB
+         */
+        const AABB & getBounds() const;
+
+        /**
+         * Draw the mesh with the shader and material that are bound.
+         */
+        void draw() const;
+    };
+}
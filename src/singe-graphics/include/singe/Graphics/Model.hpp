@@ -1,12 +1,20 @@
 #pragma once
 
+#include <GL/glew.h>
+
 #include <glpp/Buffer.hpp>
 #include <glpp/extra/Vertex.hpp>
 #include <memory>
+#include <utility>
 #include <vector>
 
+#include "Bounds.hpp"
 #include "Material.hpp"
+#include "Mesh.hpp"
 #include "RenderState.hpp"
+#include "TransformCache.hpp"
+#include "TransformStore.hpp"
+#include "VertexFormat.hpp"
 
 namespace singe {
     using std::shared_ptr;
@@ -14,27 +22,73 @@ namespace singe {
 
     using glpp::Buffer;
     using glpp::extra::Vertex;
-    using glpp::extra::VertexBufferArray;
 
     /**
-     * VertexArrayBuffer with optional Material.
+     * Mesh with optional Material.
+     *
+     * Remember to call Model::update() after making changes to points or
+     * indices. This will buffer the mesh points into the vertex buffer and
+     * the indices into the index buffer.
+     *
+     * If indices is empty, points are drawn as a triangle list. Otherwise
+     * each group of 3 indices into points is drawn as a triangle.
+     *
+     * The Mesh can be shared with other models, ie. models loaded from the
+     * same file by ResourceManager. Each of those models still has it's own
+     * copy of the points. Model::update() never changes a shared Mesh, the
+     * model gets a new Mesh of it's own instead.
+     *
+     * Models that change a few points each frame can mark the changed points
+     * with Model::markDirty(), then Model::update() only uploads those points
+     * instead of the whole mesh.
      *
-     * Remember to call Model::update() after making changes to points. This
-     * will buffer the mesh points into the vertex buffer.
+     * Model::update() buffers points in vertexFormat, use a compact format to
+     * reduce the size of each vertex.
      */
     class Model {
     public:
         using Ptr = shared_ptr<Model>;
         using ConstPtr = const shared_ptr<Model>;
 
+    protected:
+        Mesh::Ptr mesh;
+        AABB bounds;
+        /// Incremented each time bounds (or getBounds()) changes
+        uint64_t revision;
+
     private:
-        VertexBufferArray array;
+        mutable TransformCache worldTransform;
+        mutable AABB worldBounds;
+        mutable uint64_t worldRevision;
+        /// Ranges of points changed since the last update, [begin, end)
+        vector<std::pair<size_t, size_t>> dirty;
+        /// Was mesh created by update() rather than given to setMesh()
+        bool ownsMesh;
+
+        /// Upload only the dirty ranges, false if a full update is needed
+        bool updateDirty(Buffer::Usage usage);
+
+        /// Can update() write into mesh without affecting other models
+        bool writableMesh() const;
 
     public:
         vector<Vertex> points;
+        vector<unsigned int> indices;
+        /// Layout Model::update() buffers points in
+        VertexFormat::Type vertexFormat;
         Material::Ptr material;
         Transform transform;
 
+        /**
+         * Optional store to read the world matrix from instead of transform.
+         * The store world matrix of transformHandle replaces the world matrix,
+         * the parent is not applied as the store has it's own hierarchy.
+         * TransformStore::update() must be called before drawing.
+         */
+        TransformStore::Ptr transformStore;
+        /// Node in transformStore used when transformStore is set
+        TransformStore::Handle transformHandle;
+
         /**
          * Create an empty Model. This will do nothing until points are added to
          * mesh and Model::update() is called.
@@ -57,6 +111,13 @@ namespace singe {
          */
         Model(vector<Vertex> && points);
 
+        /**
+         * Create a Model that draws mesh. The mesh is shared, not copied.
+         *
+         * @param mesh the Mesh to draw
+         */
+        Model(const Mesh::Ptr & mesh);
+
         /// @brief  Move constructor
         /// @param other Other Model to move fields from
         Model(Model && other);
@@ -73,14 +134,132 @@ namespace singe {
         virtual ~Model();
 
         /**
-         * Buffer points into the vertex buffer.
+         * Merge identical points and replace the triangle list with indices
+         * into the unique points.
+         *
+         * This does nothing if indices is not empty. Call Model::update() after
+         * to buffer the new points and indices.
+         */
+        void weld();
+
+        /**
+         * Merge identical points and fill indices with indices into the unique
+         * points. This does not need an OpenGL context.
+         *
+         * @param points the triangle list, replaced by the unique points
+         * @param indices filled with an index into points for each triangle
+         *                corner, must be empty
+         */
+        static void weld(vector<Vertex> & points,
+                         vector<unsigned int> & indices);
+
+        /**
+         * Buffer points into the vertex buffer and indices into the index
+         * buffer.
+         *
+         * Indices are buffered as 16 bit if all points can be addressed,
+         * otherwise they are buffered as 32 bit. Points are encoded in
+         * vertexFormat, the model gets a new Mesh if the current one uses a
+         * different format.
+         *
+         * This method must be called after any changes to points or indices.
+         *
+         * If points have been marked with Model::markDirty(), the Mesh is
+         * owned by this model, the number of points and indices is unchanged
+         * and the buffers were created with the same usage, only the marked
+         * points are written into the existing vertex buffer. The bounds then
+         * grow to include the new points but do not shrink. Otherwise
+         * everything is buffered again. The marked ranges are cleared either
+         * way.
+         *
+         * The model owns a Mesh created by Model::update() as long as it is
+         * not passed to Model::setMesh() of another model. A Mesh given to
+         * Model::setMesh(), such as the models of ResourceManager::loadModel()
+         * have, is never written. The first update buffers everything into a
+         * Mesh of it's own and later updates of marked points are partial.
          *
-         * This method must be called after any changes to points.
+         * A model with no points that already has a Mesh, such as a model
+         * created from a Mesh, keeps it's Mesh and nothing is buffered. Use
+         * Model::setMesh() to replace or remove the Mesh.
          *
          * @param usage glpp::Buffer usage hint
          */
         void update(Buffer::Usage usage = Buffer::Static);
 
+        /**
+         * Mark points that have changed so the next Model::update() only
+         * uploads them. Changes to indices are not tracked, do not mark any
+         * points when indices change.
+         *
+         * @param begin the index of the first changed point
+         * @param end one past the index of the last changed point
+         */
+        void markDirty(size_t begin, size_t end);
+
+        /**
+         * Sort ranges and merge the ones that overlap or touch. Ranges are
+         * clamped to size and empty ranges are removed. This does not need
+         * an OpenGL context.
+         *
+         * @param ranges the [begin, end) ranges, replaced by the merged ranges
+         * @param size the number of points
+         */
+        static void mergeRanges(vector<std::pair<size_t, size_t>> & ranges,
+                                size_t size);
+
+        /**
+         * Get the Mesh drawn by this model.
+         *
+         * @return the Mesh or nullptr if there is none
+         */
+        const Mesh::Ptr & getMesh() const;
+
+        /**
+         * Draw mesh instead of the current Mesh. The mesh is shared, not
+         * copied, and points and indices are left unchanged.
+         *
+         * @param mesh the Mesh to draw
+         */
+        void setMesh(const Mesh::Ptr & mesh);
+
+        /**
+         * Get the bounding box of the mesh in model space (before transform
+         * is applied). This is the bounds of the Mesh.
+         *
+         * @return the model space AABB
+         */
+        virtual const AABB & getBounds() const;
+
+        /**
+         * Update the cached world transform and world bounds if transform,
+         * the parent or the mesh bounds have changed. A model shared by more
+         * than one scene only holds the result for the last parent, so read it
+         * right after updating it.
+         *
+         * @param parent the world matrix of the parent
+         * @param parentVersion the TransformCache version of the parent, 0 if
+         *                      there is no parent cache
+         *
+         * @return true if the world bounds changed
+         */
+        bool updateWorld(const mat4 & parent, uint64_t parentVersion = 0) const;
+
+        /**
+         * Get the cached world transform from the last call to
+         * Model::updateWorld().
+         *
+         * @return the world TransformCache
+         */
+        const TransformCache & getWorldTransform() const;
+
+        /**
+         * Get the world space bounds from the last call to
+         * Model::updateWorld().
+         *
+         * @return the world space AABB
+         */
+        const AABB & getWorldBounds() const;
+
         /**
          * Draw the vertex buffer.
          *
@@ -90,5 +269,32 @@ namespace singe {
          * @param state the parent state with transform for shader's mvp uniform
          */
         void draw(RenderState state) const;
+
+        /**
+         * Draw the vertex buffer without binding the material or shader.
+         *
+         * This is used by RenderQueue after it has bound the material state
+         * shared by consecutive draws.
+         */
+        virtual void drawMesh() const;
+
+        /**
+         * Can RenderQueue draw the mesh as part of a multi draw command
+         * instead of calling Model::drawMesh().
+         *
+         * @return true if the mesh is in a VertexArena and is drawn once
+         */
+        virtual bool canMultiDraw() const;
+
+        /**
+         * Multiply the model matrix of state by the decode matrix of a
+         * Quantized mesh (see VertexFormat). Used by Model::draw() and
+         * RenderQueue after the world transform is set. The decode matrix
+         * scales uniformly, so shaders that transform normals by the model
+         * matrix must normalize them.
+         *
+         * @param state the state to decode positions with
+         */
+        virtual void applyDecode(RenderState & state) const;
     };
 }
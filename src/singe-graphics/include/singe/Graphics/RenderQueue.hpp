@@ -0,0 +1,290 @@
+#pragma once
+
+#include <glpp/extra/Grid.hpp>
+#include <memory>
+#include <singe/Support/ThreadPool.hpp>
+#include <vector>
+
+#include "Bounds.hpp"
+#include "Material.hpp"
+#include "Model.hpp"
+#include "RenderState.hpp"
+#include "Scene.hpp"
+#include "Shader.hpp"
+#include "Texture.hpp"
+#include "TextureArray.hpp"
+#include "UniformBlock.hpp"
+#include "UniformRing.hpp"
+#include "VertexArena.hpp"
+
+namespace singe {
+    using std::shared_ptr;
+    using std::vector;
+    using glpp::extra::Grid;
+
+    /**
+     * Flatten a Scene tree into draw items that are sorted by state and drawn
+     * with redundant shader and texture binds skipped.
+     *
+     * Opaque items are sorted by shader, then textures. Items whose Material
+     * has an alpha below 1 are drawn after them from back to front. The sort
+     * is stable and grids are drawn before any model.
+     *
+     * A RenderQueue can be kept between frames to re-use it's allocations.
+     */
+    class RenderQueue {
+    public:
+        /**
+         * Counters from the last call to RenderQueue::flush().
+         */
+        struct Stats {
+            /// Number of models drawn
+            size_t draws = 0;
+            /// Number of times a shader was bound
+            size_t shaderBinds = 0;
+            /// Number of times material textures were bound
+            size_t textureBinds = 0;
+            /// Number of scenes and models rejected by frustum culling
+            size_t culled = 0;
+            /// Number of glMultiDrawElementsIndirect calls
+            size_t multiDraws = 0;
+        };
+
+    private:
+        struct Item {
+            RenderState state;
+            const Model * model;
+            const Material * material;
+            const Shader * shader;
+            const Texture * textures[3];
+            const TextureArray * textureArray;
+            /// Is the material alpha blended
+            bool blended;
+            /// Distance in front of the camera, used to sort blended items
+            float depth;
+
+            /// Do this and other bind the same textures
+            bool sameTextures(const Item & other) const;
+
+            /// Is the shader fed by the SingeDrawList block
+            bool usesDrawList() const;
+        };
+
+        /// Consecutive items sharing one range of the SingeDrawList block
+        struct Batch {
+            /// Position of the first item in order
+            size_t begin;
+            size_t count;
+            /// Offset of the range in drawListRing
+            size_t offset;
+            /// First command of the batch in drawCommands
+            size_t firstCommand;
+            /// Arena drawn by one multi draw call, nullptr to draw each item
+            const VertexArena * arena;
+        };
+
+        /// Layout of a glMultiDrawElementsIndirect command
+        struct DrawCommand {
+            GLuint count;
+            GLuint instanceCount;
+            GLuint firstIndex;
+            GLint baseVertex;
+            GLuint baseInstance;
+        };
+
+        struct GridItem {
+            const Grid * grid;
+            mat4 mvp;
+        };
+
+        /// Draw items of one scene or sub-tree
+        struct CommandList {
+            vector<Item> items;
+            vector<GridItem> grids;
+            size_t culled = 0;
+
+            void clear();
+        };
+
+        /// Scene reached by RenderQueue::submitParallel()
+        struct Node {
+            const Scene * scene;
+            RenderState state;
+            uint64_t parentVersion;
+            bool clean;
+            /// Index of the parent in expanded, SIZE_MAX for the root
+            size_t parent;
+            /// World bounds of the models and children
+            AABB bounds;
+            /// Was the scene culled as a whole
+            bool culled;
+            /// Index of the list in workerCommands, SIZE_MAX until assigned
+            size_t list;
+        };
+
+        CommandList commands;
+        vector<CommandList> workerCommands;
+        vector<size_t> order;
+        Stats stats;
+        bool culling;
+        Frustum frustum;
+        ThreadPool::Ptr pool;
+        RenderState frame;
+        float time;
+        UniformBlock::Ptr frameBlock;
+        UniformRing::Ptr drawRing;
+        UniformRing::Ptr drawListRing;
+        vector<Batch> batches;
+        vector<DrawCommand> drawCommands;
+        GLuint commandBuffer;
+
+        void bindFrame();
+
+        size_t writeDraws(size_t count, size_t stride);
+
+        void writeDrawLists();
+
+        void drawBatch(const Batch & batch);
+
+        void submitParallel(const Scene & scene, RenderState state);
+
+        bool enterScene(const Scene & scene,
+                        RenderState & state,
+                        uint64_t parentVersion,
+                        bool & clean,
+                        CommandList & list,
+                        AABB & bounds) const;
+
+        AABB submitScene(const Scene & scene,
+                         RenderState state,
+                         uint64_t parentVersion,
+                         bool clean,
+                         CommandList & list) const;
+
+        void submitModel(const Model & model,
+                         RenderState state,
+                         CommandList & list) const;
+
+    public:
+        RenderQueue();
+
+        RenderQueue(RenderQueue && other);
+
+        RenderQueue & operator=(RenderQueue && other);
+
+        RenderQueue(const RenderQueue &) = delete;
+        RenderQueue & operator=(const RenderQueue &) = delete;
+
+        ~RenderQueue();
+
+        /**
+         * Is frustum culling enabled.
+         *
+         * @return is culling enabled
+         */
+        bool getCulling() const;
+
+        /**
+         * Enable or disable frustum culling. Culling is enabled by default.
+         *
+         * @param enabled should models outside the frustum be skipped
+         */
+        void setCulling(bool enabled);
+
+        /**
+         * Get the ThreadPool used to build command lists.
+         *
+         * @return the ThreadPool or nullptr if submit is single threaded
+         */
+        const ThreadPool::Ptr & getThreadPool() const;
+
+        /**
+         * Set the ThreadPool used to build command lists when submitting a
+         * Scene. The pool is only used for scenes with children.
+         *
+         * The top of the scene is expanded on the calling thread until there
+         * are a few sub-trees per worker, which are then flattened on the
+         * workers. A Model or Scene must not appear in more than one of these
+         * sub-trees, as it's cached world transform would be updated from
+         * multiple threads. Submitting from a job of the same pool does not
+         * use the workers.
+         *
+         * @param pool the ThreadPool or nullptr to submit on the calling thread
+         */
+        void setThreadPool(const ThreadPool::Ptr & pool);
+
+        /**
+         * Set the time sent in the SingeFrame block.
+         *
+         * @param seconds the time in seconds
+         */
+        void setTime(float seconds);
+
+        /**
+         * Add all models in scene and it's children to the queue.
+         *
+         * The cached world transform of each scene and model is updated as it
+         * is reached, so a node reached from more than one parent is drawn
+         * with the matrix of each parent. When culling is enabled, models
+         * outside the view frustum of state are skipped and clean sub-trees
+         * with Scene::staticTransforms set are rejected as a whole.
+         *
+         * @param scene the Scene to add
+         * @param state the RenderState with the current global transform
+         */
+        void submit(const Scene & scene, RenderState state);
+
+        /**
+         * Add a single model to the queue.
+         *
+         * @param model the Model to add
+         * @param state the RenderState with the parent transform of model
+         */
+        void submit(const Model & model, RenderState state);
+
+        /**
+         * Add a flat list of models to the queue without walking a Scene
+         * tree. This is meant for models that use a TransformStore, whose
+         * hierarchy is already resolved by TransformStore::update().
+         *
+         * @param models the Models to add
+         * @param state the RenderState with the parent transform of models
+         *              without a TransformStore
+         */
+        void submit(const vector<Model::Ptr> & models, RenderState state);
+
+        /**
+         * Get the number of models in the queue.
+         *
+         * @return the number of queued models
+         */
+        size_t size() const;
+
+        /**
+         * Remove all items from the queue without drawing.
+         */
+        void clear();
+
+        /**
+         * Sort and draw all items in the queue, then clear the queue. This
+         * must be called from the thread that owns the OpenGL context.
+         *
+         * Shaders that declare the built in uniform blocks (see UniformBlock)
+         * get the SingeFrame block from the RenderState of the last submit,
+         * the SingeMaterial block of each material and a SingeDraw range per
+         * item, instead of Shader::applyState(). Shaders that declare the
+         * SingeDrawList block are drawn in batches of consecutive items with
+         * the same shader and textures, with one
+         * glMultiDrawElementsIndirect call per batch for VertexArena meshes
+         * when it is supported.
+         */
+        void flush();
+
+        /**
+         * Get the counters from the last call to RenderQueue::flush().
+         *
+         * @return the Stats from the last flush
+         */
+        const Stats & getStats() const;
+    };
+}
@@ -22,6 +22,7 @@ namespace singe {
     class RenderState {
         mat4 projection;
         mat4 view;
+        mat4 vp;
         mat4 model;
         mat4 local;
         bool drawGrid;
@@ -76,13 +77,28 @@ namespace singe {
         void setGridEnable(bool enabled);
 
         /**
-         * Get the vp transform.
+         * Get the projection transform.
+         *
+         * @return the projection matrix
+         */
+        const mat4 & getProjection() const;
+
+        /**
+         * Get the view transform.
+         *
+         * @return the view matrix
+         */
+        const mat4 & getView() const;
+
+        /**
+         * Get the vp transform. This is calculated once when the RenderState is
+         * created.
          *
          * VP  = projection * view
          *
          * @return the resulting matrix
          */
-        mat4 getVP() const;
+        const mat4 & getVP() const;
 
         /**
          * Get the mvp transform.
@@ -121,5 +137,14 @@ namespace singe {
          * @param matrix the matrix used to multiply model and replace local
          */
         void pushTransform(const mat4 & matrix);
+
+        /**
+         * Replace the model and local transform with already calculated
+         * matrices, such as those from a TransformCache.
+         *
+         * @param model the new model matrix
+         * @param local the new local matrix
+         */
+        void setTransform(const mat4 & model, const mat4 & local);
     };
 }
@@ -5,8 +5,11 @@
 #include <memory>
 #include <vector>
 
+#include "Bounds.hpp"
 #include "Model.hpp"
 #include "RenderState.hpp"
+#include "TransformCache.hpp"
+#include "TransformStore.hpp"
 
 using glpp::extra::Grid;
 
@@ -17,6 +20,17 @@ namespace singe {
 
     /**
      * Group of Models and child Scenes.
+     *
+     * The world matrices of the scene and it's models are cached and only
+     * re-calculated when their Transform or parent changes. A Scene or Model
+     * can be reached from more than one parent, the cache is then
+     * re-calculated for each parent it is reached from.
+     *
+     * A sub-tree that never moves can set staticTransforms. Once it has been
+     * walked, it's transforms are not checked again and it is culled as a
+     * whole from it's cached bounds until Scene::invalidate() is called or
+     * the parent world matrix changes. Scenes and models inside a static
+     * sub-tree must not be reachable from anywhere else.
      */
     struct Scene {
         using Ptr = shared_ptr<Scene>;
@@ -27,6 +41,29 @@ namespace singe {
         shared_ptr<Grid> grid;
         Transform transform;
 
+        /**
+         * The transforms and meshes of this scene and everything below it do
+         * not change unless Scene::invalidate() is called.
+         */
+        bool staticTransforms;
+
+        /**
+         * Optional store to read the world matrix from instead of transform.
+         * The store world matrix of transformHandle replaces the world matrix,
+         * the parent is not applied as the store has it's own hierarchy.
+         * TransformStore::update() must be called before drawing.
+         */
+        TransformStore::Ptr transformStore;
+        /// Node in transformStore used when transformStore is set
+        TransformStore::Handle transformHandle;
+
+    private:
+        mutable TransformCache worldTransform;
+        mutable AABB worldBounds;
+        /// A static sub-tree has been walked since it last changed
+        mutable bool clean;
+
+    public:
         Scene();
 
         Scene(Scene && other);
@@ -53,10 +90,89 @@ namespace singe {
         Model::Ptr & addModel();
 
         /**
-         * Draw child scenes and then mesh in this scene.
+         * Update the cached world transforms of this scene, it's models and
+         * child scenes. Only transforms that changed, or whose parent changed,
+         * are re-calculated and clean static sub-trees are skipped.
+         *
+         * The world space bounds of this scene are re-calculated from it's
+         * models and child scenes if any of them changed. A scene with a grid
+         * has infinite bounds so it is never culled.
+         *
+         * A node reached from more than one parent keeps the matrix of the
+         * last parent it was reached from. RenderQueue reads each node right
+         * after updating it, so shared nodes are drawn correctly.
+         *
+         * @param parent the world matrix of the parent
+         * @param parentVersion the TransformCache version of the parent, 0 if
+         *                      there is no parent cache
+         *
+         * @return true if the world bounds changed
+         */
+        bool updateWorld(const mat4 & parent = mat4(1),
+                         uint64_t parentVersion = 0) const;
+
+        /**
+         * Update the cached world transform of only this scene, not it's
+         * models or child scenes. This is used by code that walks the tree
+         * itself, such as RenderQueue.
+         *
+         * @param parent the world matrix of the parent
+         * @param parentVersion the TransformCache version of the parent, 0 if
+         *                      there is no parent cache
+         *
+         * @return true if the world matrix changed
+         */
+        bool updateTransform(const mat4 & parent = mat4(1),
+                             uint64_t parentVersion = 0) const;
+
+        /**
+         * Store the world space bounds of the sub-tree after it has been
+         * walked, and mark a static sub-tree as clean.
+         *
+         * @param bounds the world space bounds of the models and children
+         */
+        void updateBounds(const AABB & bounds) const;
+
+        /**
+         * Can the sub-tree be skipped when the world matrix did not change.
+         *
+         * @return true if staticTransforms is set and the sub-tree was walked
+         *         since it last changed
+         */
+        bool isClean() const;
+
+        /**
+         * Make the next walk of a static sub-tree check every transform and
+         * mesh below this scene again. Call this after changing anything
+         * inside a sub-tree with staticTransforms set.
+         */
+        void invalidate();
+
+        /**
+         * Get the cached world transform from the last call to
+         * Scene::updateWorld() or Scene::updateTransform().
+         *
+         * @return the world TransformCache
+         */
+        const TransformCache & getWorldTransform() const;
+
+        /**
+         * Get the world space bounds from the last call to
+         * Scene::updateWorld() or Scene::updateBounds().
+         *
+         * @return the world space AABB
+         */
+        const AABB & getBounds() const;
+
+        /**
+         * Draw mesh in this scene and all child scenes.
          *
          * Models in this scene will be drawn with this transform and child
-         * scenes will transform with this scene as their origin.
+         * scenes will transform with this scene as their origin. This is a
+         * shortcut for submitting the scene to a temporary RenderQueue and
+         * flushing it. The queue's buffers are created and deleted on every
+         * call, so code that draws every frame should keep a RenderQueue and
+         * call RenderQueue::submit() and RenderQueue::flush() instead.
          *
          * @param state the RenderState with the current global transform
          */
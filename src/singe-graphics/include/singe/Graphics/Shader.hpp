@@ -1,11 +1,15 @@
 #pragma once
 
+#include <GL/glew.h>
+
 #include <glpp/Shader.hpp>
 #include <memory>
+#include <optional>
 #include <string>
 #include <vector>
 
 #include "RenderState.hpp"
+#include "UniformBlock.hpp"
 #include "UniformExtra.hpp"
 
 namespace singe {
@@ -15,6 +19,14 @@ namespace singe {
 
     /**
      * Wrapper for glpp shader which also holds mvp uniform.
+     *
+     * A Shader can also take ownership of a program that was linked or loaded
+     * from a program binary without glpp, see ProgramCache.
+     *
+     * If the program declares any of the built in uniform blocks (see
+     * UniformBlock) they are connected to their binding point when the Shader
+     * is created. A sampler called Material::TextureArrayName is set to
+     * Material::TextureArrayUnit the same way.
      */
     class Shader {
     public:
@@ -22,8 +34,18 @@ namespace singe {
         using ConstPtr = const shared_ptr<Shader>;
 
     protected:
-        glpp::Shader m_shader;
+        std::optional<glpp::Shader> m_shader;
+        GLuint m_program;
+        bool m_ownsProgram;
+        unsigned int m_blocks;
         vector<UniformExtra::Ptr> m_extras;
+        mutable vector<uint64_t> m_sentVersions;
+        vector<UniformBlock::Ptr> m_extraBlocks;
+        mutable UniformBlock::Ptr m_drawBlock;
+
+    private:
+        void connectBlocks();
+        void connectSamplers();
 
     public:
         /**
@@ -33,17 +55,47 @@ namespace singe {
          */
         Shader(glpp::Shader && shader);
 
+        /**
+         * Constructor that takes ownership of a linked program. The program
+         * is deleted when the Shader is destroyed.
+         *
+         * @param program the linked program name
+         */
+        Shader(GLuint program);
+
+        Shader(const Shader &) = delete;
+        Shader & operator=(const Shader &) = delete;
+
         virtual ~Shader();
 
         /**
-         * Get a reference to the glpp::Shader.
+         * Get the OpenGL program name.
          *
-         * @return the glpp::Shader
+         * @return the program name
          */
-        const glpp::Shader & shader() const;
+        GLuint program() const;
 
         /**
-         * Get a glpp::Uniform for name from the glpp::Shader.
+         * Does the program declare a built in uniform block.
+         *
+         * @param binding the binding point of the built in block
+         *
+         * @return true if the block is used by the program
+         */
+        bool hasBlock(UniformBlock::Binding binding) const;
+
+        /**
+         * Connect a uniform block in the program to a binding point.
+         *
+         * @param name the block name in the program
+         * @param binding the binding point, see UniformBlock::UserBinding
+         *
+         * @return false if the program has no block called name
+         */
+        bool bindBlock(const string & name, GLuint binding) const;
+
+        /**
+         * Get a glpp::Uniform for name from the program.
          *
          * @param name the uniform name
          *
@@ -64,7 +116,36 @@ namespace singe {
         void bind() const;
 
         /**
-         * Bind the shader and apply any extra uniforms.
+         * Send all extra uniforms to the shader. The shader must already be
+         * bound. Extras whose version has not changed since they were last
+         * sent by this shader are skipped.
+         *
+         * Extras that target a UniformBlock are written to the block and the
+         * block is uploaded if it changed, then bound.
+         */
+        void sendExtras() const;
+
+        /**
+         * Apply per draw uniforms from state. The shader must already be
+         * bound.
+         *
+         * If the program has a SingeDraw block the mvp and model matrix are
+         * written to a block owned by this shader, otherwise this does
+         * nothing. RenderQueue streams this block itself instead.
+         *
+         * @param state the RenderState including transforms
+         */
+        virtual void applyState(RenderState & state) const;
+
+        /**
+         * Bind the shader, apply any extra uniforms and per draw uniforms.
+         *
+         * This calls Shader::bind(), Shader::sendExtras() and
+         * Shader::applyState(). Subclasses that override this to set their
+         * own uniforms keep working, RenderQueue calls it for every item
+         * drawn with a shader that does not declare the SingeDraw or
+         * SingeDrawList block. New subclasses should override
+         * Shader::applyState() instead.
          *
          * @param state the RenderState including transforms
          */
@@ -97,6 +178,14 @@ namespace singe {
          */
         MVPShader(glpp::Shader && shader);
 
+        /**
+         * Constructor that takes ownership of a linked program. The program
+         * must have a uniform called mvp of type mat4.
+         *
+         * @param program the linked program name
+         */
+        MVPShader(GLuint program);
+
         /**
          * Get a reference to the mvp glpp::Uniform.
          *
@@ -105,10 +194,11 @@ namespace singe {
         const glpp::Uniform & mvp() const;
 
         /**
-         * Bind the shader and apply the mvp uniform.
+         * Apply the mvp uniform, or the SingeDraw block if the program
+         * declares it. The shader must already be bound.
          *
          * @param state the RenderState including transforms
          */
-        void bind(RenderState & state) const override;
+        void applyState(RenderState & state) const override;
     };
 }
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace singe {
+    using std::shared_ptr;
+
+    /**
+     * OpenGL 2D texture with RGBA8 or S3TC compressed storage and mipmaps.
+     *
+     * The texture name is created with the Texture and the pixels are uploaded
+     * separately with Texture::upload(). This lets a Texture be handed out and
+     * bound before it's image has finished loading, sampling a texture that
+     * has not been uploaded returns black.
+     *
+     * Binding goes through the GLStateCache so a texture that is already
+     * bound to the unit is not bound again.
+     *
+     * The name is deleted by the destructor, so the last reference must be
+     * released on the thread that owns the context.
+     */
+    class Texture {
+    public:
+        using Ptr = shared_ptr<Texture>;
+        using ConstPtr = const shared_ptr<Texture>;
+
+        /**
+         * One level of a pre-built mip chain.
+         */
+        struct Level {
+            unsigned width;
+            unsigned height;
+            const uint8_t * data;
+            /// Size of data in bytes
+            size_t size;
+        };
+
+    private:
+        GLuint name;
+        unsigned width;
+        unsigned height;
+
+    public:
+        /**
+         * Create a Texture without storage.
+         */
+        Texture();
+
+        /// @brief  Move constructor
+        Texture(Texture && other);
+
+        /// @brief  Move assignment
+        Texture & operator=(Texture && other);
+
+        Texture(const Texture &) = delete;
+        Texture & operator=(const Texture &) = delete;
+
+        ~Texture();
+
+        /**
+         * Get the OpenGL texture name.
+         *
+         * @return the texture name
+         */
+        GLuint getName() const;
+
+        /**
+         * Get the width of the uploaded image.
+         *
+         * @return the width in pixels or 0 if nothing is uploaded
+         */
+        unsigned getWidth() const;
+
+        /**
+         * Get the height of the uploaded image.
+         *
+         * @return the height in pixels or 0 if nothing is uploaded
+         */
+        unsigned getHeight() const;
+
+        /**
+         * Has an image been uploaded.
+         *
+         * @return is the texture loaded
+         */
+        bool isLoaded() const;
+
+        /**
+         * Upload an image and generate mipmaps. This must be called from the
+         * thread that owns the OpenGL context.
+         *
+         * @param pixels the RGBA8 pixels, first row is the bottom of the image
+         * @param width the width in pixels
+         * @param height the height in pixels
+         */
+        void upload(const uint8_t * pixels, unsigned width, unsigned height);
+
+        /**
+         * Upload a pre-built mip chain without generating mipmaps. This must
+         * be called from the thread that owns the OpenGL context.
+         *
+         * @param format GL_RGBA8 for RGBA8 pixels or a compressed internal
+         *               format, ie. GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+         * @param levels the mip levels starting with the full size image,
+         *               first row is the bottom of the image
+         * @param levelCount the number of levels
+         */
+        void upload(GLenum format, const Level * levels, size_t levelCount);
+
+        /**
+         * Can the context sample S3TC (BC1 / BC3) compressed textures. This
+         * must be called from the thread that owns the OpenGL context.
+         *
+         * @return is GL_EXT_texture_compression_s3tc supported
+         */
+        static bool supportsCompression();
+
+        /**
+         * Get the size of one 4x4 block of a compressed format.
+         *
+         * @param format the internal format
+         *
+         * @return the size in bytes, 0 if format is not S3TC compressed
+         */
+        static size_t blockSize(GLenum format);
+
+        /**
+         * Bind the texture to a texture unit.
+         *
+         * @param unit the texture unit starting at 0
+         */
+        void bind(GLuint unit = 0) const;
+    };
+}
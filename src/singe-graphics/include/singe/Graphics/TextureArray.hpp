@@ -0,0 +1,125 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "Texture.hpp"
+
+namespace singe {
+    using std::shared_ptr;
+
+    /**
+     * OpenGL 2D array texture where every layer has the same size, format and
+     * number of mip levels.
+     *
+     * Materials that reference a layer of the same TextureArray bind the same
+     * texture, so models that only differ by texture can be drawn without
+     * re-binding. Shaders sample it with a sampler2DArray and the layer
+     * index, see Material::textureArray.
+     *
+     * The storage of all layers is allocated by the constructor and each layer
+     * is uploaded with TextureArray::upload().
+     */
+    class TextureArray {
+    public:
+        using Ptr = shared_ptr<TextureArray>;
+        using ConstPtr = const shared_ptr<TextureArray>;
+
+    private:
+        GLuint name;
+        GLenum format;
+        unsigned width;
+        unsigned height;
+        unsigned layers;
+        size_t levelCount;
+
+    public:
+        /**
+         * Create a TextureArray and allocate the storage of every layer. This
+         * must be called from the thread that owns the OpenGL context.
+         *
+         * @param format GL_RGBA8 or a compressed internal format, ie.
+         *               GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+         * @param width the width of each layer in pixels
+         * @param height the height of each layer in pixels
+         * @param layers the number of layers
+         * @param levelCount the number of mip levels of each layer
+         */
+        TextureArray(GLenum format,
+                     unsigned width,
+                     unsigned height,
+                     unsigned layers,
+                     size_t levelCount);
+
+        /// @brief  Move constructor
+        TextureArray(TextureArray && other);
+
+        /// @brief  Move assignment
+        TextureArray & operator=(TextureArray && other);
+
+        TextureArray(const TextureArray &) = delete;
+        TextureArray & operator=(const TextureArray &) = delete;
+
+        ~TextureArray();
+
+        /**
+         * Get the OpenGL texture name.
+         *
+         * @return the texture name
+         */
+        GLuint getName() const;
+
+        /**
+         * Get the internal format of the layers.
+         *
+         * @return the internal format
+         */
+        GLenum getFormat() const;
+
+        /**
+         * Get the width of each layer.
+         *
+         * @return the width in pixels
+         */
+        unsigned getWidth() const;
+
+        /**
+         * Get the height of each layer.
+         *
+         * @return the height in pixels
+         */
+        unsigned getHeight() const;
+
+        /**
+         * Get the number of layers.
+         *
+         * @return the layer count
+         */
+        unsigned getLayers() const;
+
+        /**
+         * Upload the mip chain of one layer. This must be called from the
+         * thread that owns the OpenGL context.
+         *
+         * @param layer the layer index
+         * @param levels the mip levels in the format of the array, starting
+         *               with the full size image
+         * @param levelCount the number of levels, extra levels are ignored
+         *
+         * @return false if layer is out of range or the levels do not match
+         *         the size of the array
+         */
+        bool upload(unsigned layer, const Texture::Level * levels,
+                    size_t levelCount);
+
+        /**
+         * Bind the texture to a texture unit.
+         *
+         * @param unit the texture unit starting at 0
+         */
+        void bind(GLuint unit) const;
+    };
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <glpp/extra/Transform.hpp>
+
+namespace singe {
+    using glm::mat4;
+    using glpp::extra::Transform;
+
+    /**
+     * Cached local and world matrix of a Transform in a hierarchy.
+     *
+     * The local matrix is only re-calculated when the Transform changes and
+     * the world matrix only when the local matrix or the parent world matrix
+     * changes. Each time the world matrix changes it is given a new version so
+     * children can detect a changed parent by comparing versions.
+     *
+     * A root has no parent version (0) so it's parent matrix is compared
+     * instead.
+     */
+    class TransformCache {
+        Transform last;
+        mat4 local;
+        mat4 world;
+        mat4 parent;
+        uint64_t version;
+        uint64_t parentVersion;
+
+        bool updateWorld(bool localDirty,
+                         const mat4 & parent,
+                         uint64_t parentVersion);
+
+    public:
+        /**
+         * Create an invalid cache, the first update will always recalculate.
+         */
+        TransformCache();
+
+        /**
+         * Update the cached matrices if transform or the parent have changed.
+         *
+         * @param transform the local Transform
+         * @param parent the world matrix of the parent
+         * @param parentVersion the version of the parent, 0 for a root
+         *
+         * @return true if the world matrix changed
+         */
+        bool update(const Transform & transform,
+                    const mat4 & parent,
+                    uint64_t parentVersion = 0);
+
+        /**
+         * Update the cached matrices if local or the parent have changed. This
+         * is used when the local matrix comes from somewhere other than a
+         * Transform, such as a TransformStore.
+         *
+         * @param local the local matrix
+         * @param parent the world matrix of the parent
+         * @param parentVersion the version of the parent, 0 for a root
+         *
+         * @return true if the world matrix changed
+         */
+        bool update(const mat4 & local,
+                    const mat4 & parent,
+                    uint64_t parentVersion = 0);
+
+        /**
+         * Force the next update to recalculate.
+         */
+        void invalidate();
+
+        /**
+         * Get the cached local matrix.
+         *
+         * @return the local matrix
+         */
+        const mat4 & getLocal() const;
+
+        /**
+         * Get the cached world matrix.
+         *
+         * @return the world matrix
+         */
+        const mat4 & getWorld() const;
+
+        /**
+         * Get the version of the world matrix. This is 0 before the first
+         * update and a new unique value each time the world matrix changes.
+         *
+         * @return the world matrix version
+         */
+        uint64_t getVersion() const;
+    };
+}
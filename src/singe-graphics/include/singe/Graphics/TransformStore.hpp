@@ -0,0 +1,164 @@
+#pragma once
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glpp/extra/Transform.hpp>
+#include <memory>
+#include <vector>
+
+namespace singe {
+    using std::shared_ptr;
+    using std::vector;
+    using glm::mat4;
+    using glm::quat;
+    using glm::vec3;
+    using glpp::extra::Transform;
+
+    /**
+     * Flat transform hierarchy stored as separate position, rotation and scale
+     * arrays.
+     *
+     * Nodes are stored in the order they are added and a parent must be added
+     * before it's children, so all world matrices are calculated in one linear
+     * sweep by TransformStore::update(). Only nodes that changed, or whose
+     * parent changed, are re-calculated. The parent * local multiply uses SSE
+     * when available.
+     *
+     * Scene and Model can reference a node by handle with their transformStore
+     * and transformHandle members. The store world matrix is then their world
+     * matrix, the scene graph parent is not applied. This is optional and
+     * meant for very large scenes, the Transform of each Scene and Model works
+     * without it. Models that all use a store can be drawn without a Scene
+     * tree by RenderQueue::submit(const vector<Model::Ptr> &, RenderState).
+     */
+    class TransformStore {
+    public:
+        using Ptr = shared_ptr<TransformStore>;
+        using ConstPtr = const shared_ptr<TransformStore>;
+
+        /// Index of a node in the store
+        using Handle = uint32_t;
+
+        /// Handle used for no node, ie. a root has no parent
+        static constexpr Handle None = UINT32_MAX;
+
+    private:
+        vector<Handle> parents;
+        vector<vec3> positions;
+        vector<quat> rotations;
+        vector<vec3> scales;
+        vector<mat4> worlds;
+        vector<uint8_t> dirty;
+
+    public:
+        TransformStore();
+
+        TransformStore(TransformStore && other);
+
+        TransformStore & operator=(TransformStore && other);
+
+        TransformStore(const TransformStore &) = delete;
+        TransformStore & operator=(const TransformStore &) = delete;
+
+        ~TransformStore();
+
+        /**
+         * Reserve space for count nodes.
+         *
+         * @param count the number of nodes
+         */
+        void reserve(size_t count);
+
+        /**
+         * Add a node to the store.
+         *
+         * @param transform the initial local transform
+         * @param parent the parent node, which must already be in the store.
+         *               Any other node is an error and the node is added as a
+         *               root.
+         *
+         * @return the handle of the new node
+         */
+        Handle add(const Transform & transform = Transform(),
+                   Handle parent = None);
+
+        /**
+         * Remove all nodes. Any handles become invalid.
+         */
+        void clear();
+
+        /**
+         * Get the number of nodes in the store.
+         *
+         * @return the number of nodes
+         */
+        size_t size() const;
+
+        /**
+         * Get the parent of a node.
+         *
+         * @param handle the node
+         *
+         * @return the parent node or TransformStore::None
+         */
+        Handle getParent(Handle handle) const;
+
+        /**
+         * Replace the local transform of a node.
+         *
+         * @param handle the node
+         * @param transform the new local transform
+         */
+        void set(Handle handle, const Transform & transform);
+
+        /**
+         * Get the local transform of a node.
+         *
+         * @param handle the node
+         *
+         * @return the local transform
+         */
+        Transform get(Handle handle) const;
+
+        /**
+         * Set the local position of a node.
+         *
+         * @param handle the node
+         * @param position the new position
+         */
+        void setPosition(Handle handle, const vec3 & position);
+
+        /**
+         * Set the local rotation of a node.
+         *
+         * @param handle the node
+         * @param rotation the new rotation
+         */
+        void setRotation(Handle handle, const quat & rotation);
+
+        /**
+         * Set the local scale of a node.
+         *
+         * @param handle the node
+         * @param scale the new scale
+         */
+        void setScale(Handle handle, const vec3 & scale);
+
+        /**
+         * Re-calculate the world matrix of every node that changed, or whose
+         * parent changed, since the last update.
+         */
+        void update();
+
+        /**
+         * Get the world matrix of a node from the last call to
+         * TransformStore::update().
+         *
+         * @param handle the node
+         *
+         * @return the world matrix
+         */
+        const mat4 & getWorld(Handle handle) const;
+    };
+}
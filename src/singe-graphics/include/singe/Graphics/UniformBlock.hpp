@@ -0,0 +1,214 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+
+namespace singe {
+    using std::shared_ptr;
+    using std::vector;
+    using glm::mat2;
+    using glm::mat3;
+    using glm::mat4;
+    using glm::vec2;
+    using glm::vec3;
+    using glm::vec4;
+
+    /**
+     * Uniform buffer object with a CPU side copy using the std140 layout.
+     *
+     * Values are written to the CPU copy with UniformBlock::set() which only
+     * marks the block dirty if the bytes changed. UniformBlock::upload() sends
+     * the copy to the buffer only when it is dirty.
+     *
+     * A Shader automatically connects the blocks below to their binding point
+     * if the program declares them.
+     *
+     * ```glsl
+     * layout(std140) uniform SingeFrame {
+     *     mat4 view;
+     *     mat4 projection;
+     *     mat4 vp;
+     *     float time;
+     * };
+     *
+     * layout(std140) uniform SingeMaterial {
+     *     vec3 ambient;
+     *     vec3 diffuse;
+     *     vec3 specular;
+     *     float specExp;
+     *     float alpha;
+     *     int layer;
+     * };
+     *
+     * layout(std140) uniform SingeDraw {
+     *     mat4 mvp;
+     *     mat4 model;
+     * };
+     * ```
+     *
+     * A shader can declare SingeDrawList instead of SingeDraw to let
+     * RenderQueue draw runs of models with one multi draw call. Each entry
+     * holds the SingeDraw and SingeMaterial data of one draw and is selected
+     * by the draw index attribute (see VertexArena).
+     *
+     * ```glsl
+     * struct SingeDrawData {
+     *     mat4 mvp;
+     *     mat4 model;
+     *     vec3 ambient;
+     *     vec3 diffuse;
+     *     vec3 specular;
+     *     float specExp;
+     *     float alpha;
+     *     int layer;
+     * };
+     *
+     * layout(std140) uniform SingeDrawList {
+     *     SingeDrawData draws[64];
+     * };
+     *
+     * layout(location = 7) in uint singeDrawIndex;
+     * ```
+     */
+    class UniformBlock {
+    public:
+        using Ptr = shared_ptr<UniformBlock>;
+        using ConstPtr = const shared_ptr<UniformBlock>;
+
+        /**
+         * Binding points of the built in blocks. Blocks added by the user
+         * should use UserBinding or higher.
+         */
+        enum Binding : GLuint {
+            FrameBinding = 0,
+            MaterialBinding,
+            DrawBinding,
+            DrawListBinding,
+            UserBinding,
+        };
+
+        /// Name of the per frame block
+        static constexpr const char * FrameName = "SingeFrame";
+        /// Name of the per material block
+        static constexpr const char * MaterialName = "SingeMaterial";
+        /// Name of the per draw block
+        static constexpr const char * DrawName = "SingeDraw";
+        /// Name of the multi draw block
+        static constexpr const char * DrawListName = "SingeDrawList";
+        /// Define of the shader variants that read SingeDrawList
+        static constexpr const char * DrawListDefine = "SINGE_DRAW_LIST";
+
+        /// Size of the SingeFrame block
+        static constexpr size_t FrameSize = 208;
+        /// Size of the SingeMaterial block
+        static constexpr size_t MaterialSize = 64;
+        /// Size of the SingeDraw block
+        static constexpr size_t DrawSize = 128;
+        /// Size of one SingeDrawData entry, SingeDraw then SingeMaterial
+        static constexpr size_t DrawListStride = DrawSize + MaterialSize;
+        /// Number of entries in the SingeDrawList block
+        static constexpr size_t DrawListCount = 64;
+        /// Size of the SingeDrawList block
+        static constexpr size_t DrawListSize = DrawListStride * DrawListCount;
+
+    private:
+        GLuint buffer;
+        GLuint binding;
+        vector<uint8_t> data;
+        bool dirty;
+
+        void write(size_t offset, const void * value, size_t size);
+
+    public:
+        /**
+         * Create a UniformBlock and it's buffer.
+         *
+         * @param binding the uniform buffer binding point
+         * @param size the size of the block in bytes
+         */
+        UniformBlock(GLuint binding, size_t size);
+
+        /// @brief  Move constructor
+        UniformBlock(UniformBlock && other);
+
+        /// @brief  Move assignment
+        UniformBlock & operator=(UniformBlock && other);
+
+        UniformBlock(const UniformBlock &) = delete;
+        UniformBlock & operator=(const UniformBlock &) = delete;
+
+        ~UniformBlock();
+
+        /**
+         * Get the uniform buffer binding point.
+         *
+         * @return the binding point
+         */
+        GLuint getBinding() const;
+
+        /**
+         * Get the size of the block in bytes.
+         *
+         * @return the block size
+         */
+        size_t size() const;
+
+        /**
+         * Has the CPU copy changed since the last upload.
+         *
+         * @return is the block dirty
+         */
+        bool isDirty() const;
+
+        /**
+         * Write a value at offset using the std140 layout of it's type.
+         *
+         * @param offset the std140 offset of the member in bytes
+         * @param value the value to write
+         */
+        void set(size_t offset, bool value);
+
+        /// @copydoc set(size_t, bool)
+        void set(size_t offset, int value);
+
+        /// @copydoc set(size_t, bool)
+        void set(size_t offset, unsigned int value);
+
+        /// @copydoc set(size_t, bool)
+        void set(size_t offset, float value);
+
+        /// @copydoc set(size_t, bool)
+        void set(size_t offset, const vec2 & value);
+
+        /// @copydoc set(size_t, bool)
+        void set(size_t offset, const vec3 & value);
+
+        /// @copydoc set(size_t, bool)
+        void set(size_t offset, const vec4 & value);
+
+        /// @copydoc set(size_t, bool)
+        void set(size_t offset, const mat2 & value);
+
+        /// @copydoc set(size_t, bool)
+        void set(size_t offset, const mat3 & value);
+
+        /// @copydoc set(size_t, bool)
+        void set(size_t offset, const mat4 & value);
+
+        /**
+         * Send the CPU copy to the buffer if it is dirty.
+         *
+         * @return true if the block was uploaded
+         */
+        bool upload();
+
+        /**
+         * Bind the buffer to it's binding point.
+         */
+        void bind() const;
+    };
+}
@@ -1,9 +1,12 @@
 #pragma once
 
 #include <glm/glm.hpp>
+#include <cstdint>
 #include <glpp/Shader.hpp>
 #include <memory>
 
+#include "UniformBlock.hpp"
+
 namespace singe {
     using std::shared_ptr;
     using glm::mat2;
@@ -19,6 +22,15 @@ namespace singe {
      * This is an abstract base class with virtual send() method. This method is
      * implemented by the derived class to send their value to the appropriate
      * uniform type.
+     *
+     * A UniformExtra can instead target a member of a UniformBlock, in which
+     * case send() writes the value to the block and the Shader uploads the
+     * block if it changed.
+     *
+     * Each UniformExtra has a version which UniformExtra::update() increments
+     * when value changes. A Shader updates each extra before sending it,
+     * remembers the version it last sent and skips the extra if it is the
+     * same, so unchanged values are not sent again.
      */
     class UniformExtra {
     public:
@@ -27,6 +39,39 @@ namespace singe {
 
     protected:
         glpp::Uniform uniform;
+        UniformBlock::Ptr block;
+        size_t offset;
+        uint64_t version;
+
+        /**
+         * Compare value with last. If it changed, last is set to value and
+         * the version is incremented.
+         *
+         * @param value the current value
+         * @param last the value from the last call
+         */
+        template<typename T>
+        void track(const T & value, T & last) {
+            if (value == last)
+                return;
+            last = value;
+            version++;
+        }
+
+        /**
+         * Write value to the block if there is one, otherwise send it with a
+         * glpp::Uniform setter.
+         *
+         * @param value the value to write
+         * @param setter the glpp::Uniform method for the type of value
+         */
+        template<typename T, typename Setter>
+        void write(const T & value, Setter setter) const {
+            if (block)
+                block->set(offset, value);
+            else
+                (uniform.*setter)(value);
+        }
 
     public:
         /**
@@ -36,6 +81,14 @@ namespace singe {
          */
         UniformExtra(glpp::Uniform uniform);
 
+        /**
+         * Create a new UniformExtra that writes to a UniformBlock.
+         *
+         * @param block the UniformBlock to write to
+         * @param offset the std140 offset of the member in block
+         */
+        UniformExtra(UniformBlock::ConstPtr & block, size_t offset);
+
         /**
          * Virtual destructor.
          */
@@ -46,6 +99,27 @@ namespace singe {
          * will be called when a shader is bound to update it's uniforms.
          */
         virtual void send() const = 0;
+
+        /**
+         * Get the UniformBlock this extra writes to.
+         *
+         * @return the UniformBlock or nullptr if a uniform is used
+         */
+        const UniformBlock::Ptr & getBlock() const;
+
+        /**
+         * Virtual method to be implemented by derived classes. Check value
+         * for changes since the last call, see UniformExtra::getVersion().
+         */
+        virtual void update() = 0;
+
+        /**
+         * Get the version of value. This is 1 when created and increments
+         * each time UniformExtra::update() finds that value changed.
+         *
+         * @return the current version
+         */
+        uint64_t getVersion() const;
     };
 
     /**
@@ -59,6 +133,10 @@ namespace singe {
         /// The uniform value
         bool value;
 
+    private:
+        bool last;
+
+    public:
         /**
          * Create a new BoolUniformExtra.
          *
@@ -67,7 +145,20 @@ namespace singe {
         BoolUniformExtra(glpp::Uniform uniform);
 
         /**
-         * Send the uniform to the shader.
+         * Create a new BoolUniformExtra that writes to a UniformBlock.
+         *
+         * @param block the UniformBlock to write to
+         * @param offset the std140 offset of the member in block
+         */
+        BoolUniformExtra(UniformBlock::ConstPtr & block, size_t offset);
+
+        /**
+         * Check value for changes since the last call.
+         */
+        void update() override;
+
+        /**
+         * Send the uniform to the shader or write it to the block.
          */
         void send() const override;
     };
@@ -83,6 +174,10 @@ namespace singe {
         /// The uniform value
         int value;
 
+    private:
+        int last;
+
+    public:
         /**
          * Create a new IntUniformExtra.
          *
@@ -91,7 +186,20 @@ namespace singe {
         IntUniformExtra(glpp::Uniform uniform);
 
         /**
-         * Send the uniform to the shader.
+         * Create a new IntUniformExtra that writes to a UniformBlock.
+         *
+         * @param block the UniformBlock to write to
+         * @param offset the std140 offset of the member in block
+         */
+        IntUniformExtra(UniformBlock::ConstPtr & block, size_t offset);
+
+        /**
+         * Check value for changes since the last call.
+         */
+        void update() override;
+
+        /**
+         * Send the uniform to the shader or write it to the block.
          */
         void send() const override;
     };
@@ -107,6 +215,10 @@ namespace singe {
         /// The uniform value
         unsigned int value;
 
+    private:
+        unsigned int last;
+
+    public:
         /**
          * Create a new UIntUniformExtra.
          *
@@ -115,7 +227,20 @@ namespace singe {
         UIntUniformExtra(glpp::Uniform uniform);
 
         /**
-         * Send the uniform to the shader.
+         * Create a new UIntUniformExtra that writes to a UniformBlock.
+         *
+         * @param block the UniformBlock to write to
+         * @param offset the std140 offset of the member in block
+         */
+        UIntUniformExtra(UniformBlock::ConstPtr & block, size_t offset);
+
+        /**
+         * Check value for changes since the last call.
+         */
+        void update() override;
+
+        /**
+         * Send the uniform to the shader or write it to the block.
          */
         void send() const override;
     };
@@ -131,6 +256,10 @@ namespace singe {
         /// The uniform value
         float value;
 
+    private:
+        float last;
+
+    public:
         /**
          * Create a new FloatUniformExtra.
          *
@@ -139,7 +268,20 @@ namespace singe {
         FloatUniformExtra(glpp::Uniform uniform);
 
         /**
-         * Send the uniform to the shader.
+         * Create a new FloatUniformExtra that writes to a UniformBlock.
+         *
+         * @param block the UniformBlock to write to
+         * @param offset the std140 offset of the member in block
+         */
+        FloatUniformExtra(UniformBlock::ConstPtr & block, size_t offset);
+
+        /**
+         * Check value for changes since the last call.
+         */
+        void update() override;
+
+        /**
+         * Send the uniform to the shader or write it to the block.
          */
         void send() const override;
     };
@@ -155,6 +297,10 @@ namespace singe {
         /// The uniform value
         vec2 value;
 
+    private:
+        vec2 last;
+
+    public:
         /**
          * Create a new Vec2UniformExtra.
          *
@@ -163,7 +309,20 @@ namespace singe {
         Vec2UniformExtra(glpp::Uniform uniform);
 
         /**
-         * Send the uniform to the shader.
+         * Create a new Vec2UniformExtra that writes to a UniformBlock.
+         *
+         * @param block the UniformBlock to write to
+         * @param offset the std140 offset of the member in block
+         */
+        Vec2UniformExtra(UniformBlock::ConstPtr & block, size_t offset);
+
+        /**
+         * Check value for changes since the last call.
+         */
+        void update() override;
+
+        /**
+         * Send the uniform to the shader or write it to the block.
          */
         void send() const override;
     };
@@ -179,6 +338,10 @@ namespace singe {
         /// The uniform value
         vec3 value;
 
+    private:
+        vec3 last;
+
+    public:
         /**
          * Create a new Vec3UniformExtra.
          *
@@ -187,7 +350,20 @@ namespace singe {
         Vec3UniformExtra(glpp::Uniform uniform);
 
         /**
-         * Send the uniform to the shader.
+         * Create a new Vec3UniformExtra that writes to a UniformBlock.
+         *
+         * @param block the UniformBlock to write to
+         * @param offset the std140 offset of the member in block
+         */
+        Vec3UniformExtra(UniformBlock::ConstPtr & block, size_t offset);
+
+        /**
+         * Check value for changes since the last call.
+         */
+        void update() override;
+
+        /**
+         * Send the uniform to the shader or write it to the block.
          */
         void send() const override;
     };
@@ -203,6 +379,10 @@ namespace singe {
         /// The uniform value
         vec4 value;
 
+    private:
+        vec4 last;
+
+    public:
         /**
          * Create a new Vec4UniformExtra.
          *
@@ -211,7 +391,20 @@ namespace singe {
         Vec4UniformExtra(glpp::Uniform uniform);
 
         /**
-         * Send the uniform to the shader.
+         * Create a new Vec4UniformExtra that writes to a UniformBlock.
+         *
+         * @param block the UniformBlock to write to
+         * @param offset the std140 offset of the member in block
+         */
+        Vec4UniformExtra(UniformBlock::ConstPtr & block, size_t offset);
+
+        /**
+         * Check value for changes since the last call.
+         */
+        void update() override;
+
+        /**
+         * Send the uniform to the shader or write it to the block.
          */
         void send() const override;
     };
@@ -227,6 +420,10 @@ namespace singe {
         /// The uniform value
         mat2 value;
 
+    private:
+        mat2 last;
+
+    public:
         /**
          * Create a new Mat2UniformExtra.
          *
@@ -235,7 +432,20 @@ namespace singe {
         Mat2UniformExtra(glpp::Uniform uniform);
 
         /**
-         * Send the uniform to the shader.
+         * Create a new Mat2UniformExtra that writes to a UniformBlock.
+         *
+         * @param block the UniformBlock to write to
+         * @param offset the std140 offset of the member in block
+         */
+        Mat2UniformExtra(UniformBlock::ConstPtr & block, size_t offset);
+
+        /**
+         * Check value for changes since the last call.
+         */
+        void update() override;
+
+        /**
+         * Send the uniform to the shader or write it to the block.
          */
         void send() const override;
     };
@@ -251,6 +461,10 @@ namespace singe {
         /// The uniform value
         mat3 value;
 
+    private:
+        mat3 last;
+
+    public:
         /**
          * Create a new Mat3UniformExtra.
          *
@@ -259,7 +473,20 @@ namespace singe {
         Mat3UniformExtra(glpp::Uniform uniform);
 
         /**
-         * Send the uniform to the shader.
+         * Create a new Mat3UniformExtra that writes to a UniformBlock.
+         *
+         * @param block the UniformBlock to write to
+         * @param offset the std140 offset of the member in block
+         */
+        Mat3UniformExtra(UniformBlock::ConstPtr & block, size_t offset);
+
+        /**
+         * Check value for changes since the last call.
+         */
+        void update() override;
+
+        /**
+         * Send the uniform to the shader or write it to the block.
          */
         void send() const override;
     };
@@ -275,6 +502,10 @@ namespace singe {
         /// The uniform value
         mat4 value;
 
+    private:
+        mat4 last;
+
+    public:
         /**
          * Create a new Mat4UniformExtra.
          *
@@ -283,7 +514,20 @@ namespace singe {
         Mat4UniformExtra(glpp::Uniform uniform);
 
         /**
-         * Send the uniform to the shader.
+         * Create a new Mat4UniformExtra that writes to a UniformBlock.
+         *
+         * @param block the UniformBlock to write to
+         * @param offset the std140 offset of the member in block
+         */
+        Mat4UniformExtra(UniformBlock::ConstPtr & block, size_t offset);
+
+        /**
+         * Check value for changes since the last call.
+         */
+        void update() override;
+
+        /**
+         * Send the uniform to the shader or write it to the block.
          */
         void send() const override;
     };
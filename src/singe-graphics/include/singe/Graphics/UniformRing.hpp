@@ -0,0 +1,113 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+
+namespace singe {
+    using std::shared_ptr;
+
+    /**
+     * Ring buffer used to stream per draw uniform blocks.
+     *
+     * Each call to UniformRing::map() returns a write pointer to the next free
+     * region. Every draw then binds it's part of the region with
+     * UniformRing::bindRange() so the data for many draws is written with one
+     * map instead of a glUniform call per draw.
+     *
+     * When ARB_buffer_storage is available the buffer is persistently mapped
+     * once and fences keep regions that are still in use by the GPU from
+     * being overwritten. Otherwise each region is mapped unsynchronized and
+     * the buffer is orphaned when the ring wraps around.
+     */
+    class UniformRing {
+    public:
+        using Ptr = shared_ptr<UniformRing>;
+        using ConstPtr = const shared_ptr<UniformRing>;
+
+    private:
+        struct Fence {
+            GLsync sync;
+            size_t begin;
+            size_t end;
+        };
+
+        GLuint buffer;
+        size_t capacity;
+        size_t head;
+        size_t alignment;
+        bool persistent;
+        uint8_t * mapped;
+        size_t mappedBegin;
+        size_t mappedEnd;
+        std::deque<Fence> fences;
+
+        void create(size_t capacity);
+
+        void destroy();
+
+        void waitFor(size_t begin, size_t end);
+
+    public:
+        /**
+         * Create a UniformRing and it's buffer.
+         *
+         * @param capacity the initial size of the buffer in bytes
+         */
+        UniformRing(size_t capacity = 1 << 20);
+
+        UniformRing(const UniformRing &) = delete;
+        UniformRing & operator=(const UniformRing &) = delete;
+
+        ~UniformRing();
+
+        /**
+         * Get the alignment of offsets passed to UniformRing::bindRange(),
+         * this is GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT.
+         *
+         * @return the offset alignment in bytes
+         */
+        size_t getAlignment() const;
+
+        /**
+         * Is the buffer persistently mapped.
+         *
+         * @return true if ARB_buffer_storage is used
+         */
+        bool isPersistent() const;
+
+        /**
+         * Map the next size bytes of the ring for writing. The buffer grows if
+         * size is larger than it's capacity.
+         *
+         * @param size the number of bytes to write
+         * @param offset set to the buffer offset of the region, this is a
+         *               multiple of UniformRing::getAlignment()
+         *
+         * @return pointer to the start of the region
+         */
+        uint8_t * map(size_t size, size_t & offset);
+
+        /**
+         * Finish writing the region returned by UniformRing::map().
+         */
+        void unmap();
+
+        /**
+         * Bind part of the ring to a uniform buffer binding point.
+         *
+         * @param binding the binding point
+         * @param offset the buffer offset, must be aligned
+         * @param size the number of bytes to bind
+         */
+        void bindRange(GLuint binding, size_t offset, size_t size) const;
+
+        /**
+         * Mark the last mapped region as in use by the draws issued since it
+         * was mapped. Call this after the last draw using the region.
+         */
+        void fence();
+    };
+}
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <glpp/extra/Vertex.hpp>
+#include <memory>
+#include <singe/Support/FreeList.hpp>
+#include <vector>
+
+#include "VertexFormat.hpp"
+
+namespace singe {
+    using std::shared_ptr;
+    using std::vector;
+    using glpp::extra::Vertex;
+
+    /**
+     * Shared vertex and index buffers that many meshes are placed into, with
+     * one vertex array that reads all of them.
+     *
+     * Meshes in the same arena are drawn without switching vertex arrays, so
+     * RenderQueue can draw a run of them with a single
+     * glMultiDrawElementsIndirect call.
+     *
+     * Each mesh gets a Range of the buffers from a first fit free list.
+     * Indices are always stored as 32 bit and are relative to the first
+     * vertex of the Range, triangle lists are given sequential indices. The
+     * buffers grow (by copying into larger buffers) when a mesh does not fit,
+     * ranges keep their offsets when this happens. Growing replaces the
+     * buffer names and increments the generation, vertex arrays other than
+     * the arena's own that read the buffers must be attached again when it
+     * changes, see VertexArena::getGeneration().
+     *
+     * Every mesh in an arena uses the arena's VertexFormat::Type, Quantized
+     * meshes each have their own quantization box.
+     *
+     * When multi draw indirect is supported the vertex array also reads a
+     * per instance draw index at DrawIndexAttribute. RenderQueue sets the
+     * base instance of each indirect command so the draw index selects the
+     * draw's entry in the SingeDrawList block (see UniformBlock).
+     */
+    class VertexArena {
+    public:
+        using Ptr = shared_ptr<VertexArena>;
+        using ConstPtr = const shared_ptr<VertexArena>;
+
+        /// Attribute location of the per draw index, after the instance
+        /// matrix of InstancedModel
+        static constexpr GLuint DrawIndexAttribute = 7;
+
+        /// Part of the arena holding one mesh
+        struct Range {
+            /// First vertex, the base vertex of the draw
+            size_t firstVertex = 0;
+            size_t vertexCount = 0;
+            /// First index in the index buffer
+            size_t firstIndex = 0;
+            size_t indexCount = 0;
+        };
+
+    private:
+        VertexFormat::Type type;
+        GLuint vertexBuffer;
+        GLuint indexBuffer;
+        GLuint drawIndexBuffer;
+        GLuint vertexArray;
+        FreeList vertices;
+        FreeList indices;
+        bool multiDraw;
+        uint64_t generation;
+
+        void attachBuffers();
+
+        static size_t allocate(FreeList & list,
+                               GLuint & buffer,
+                               size_t elementSize,
+                               size_t size);
+
+    public:
+        /**
+         * Create a VertexArena and it's buffers.
+         *
+         * @param type the layout of the vertices
+         * @param vertexCapacity the initial number of vertices
+         * @param indexCapacity the initial number of indices
+         */
+        VertexArena(VertexFormat::Type type = VertexFormat::Float,
+                    size_t vertexCapacity = 1 << 16,
+                    size_t indexCapacity = 1 << 18);
+
+        VertexArena(const VertexArena &) = delete;
+        VertexArena & operator=(const VertexArena &) = delete;
+
+        ~VertexArena();
+
+        /**
+         * Can runs of arena meshes be drawn with glMultiDrawElementsIndirect.
+         *
+         * @return true if ARB_multi_draw_indirect and ARB_base_instance are
+         *         available
+         */
+        static bool supportsMultiDraw();
+
+        /**
+         * Does the vertex array read the draw index at DrawIndexAttribute.
+         *
+         * @return true if multi draw indirect is supported
+         */
+        bool hasDrawIndex() const;
+
+        /**
+         * Get the layout of the vertices.
+         *
+         * @return the VertexFormat::Type
+         */
+        VertexFormat::Type getType() const;
+
+        /**
+         * Place a mesh in the arena.
+         *
+         * @param vertices the points of the mesh, already encoded in the
+         *                 layout of the arena
+         * @param vertexCount the number of vertices
+         * @param indices 3 indices into vertices for each triangle, or nullptr
+         *                for a triangle list
+         * @param indexCount the number of indices
+         *
+         * @return the Range holding the mesh
+         */
+        Range allocate(const void * vertices,
+                       size_t vertexCount,
+                       const uint32_t * indices,
+                       size_t indexCount);
+
+        /**
+         * Free the space used by a mesh.
+         *
+         * @param range the Range returned by VertexArena::allocate()
+         */
+        void release(const Range & range);
+
+        /**
+         * Get the vertex array that reads every mesh in the arena.
+         *
+         * @return the vertex array name
+         */
+        GLuint getVertexArray() const;
+
+        /**
+         * Get the shared vertex buffer.
+         *
+         * @return the buffer name
+         */
+        GLuint getVertexBuffer() const;
+
+        /**
+         * Get the shared index buffer, indices are GL_UNSIGNED_INT.
+         *
+         * @return the buffer name
+         */
+        GLuint getIndexBuffer() const;
+
+        /**
+         * Get the number of times the buffers have been replaced. A vertex
+         * array that reads the buffers, ie. one set up with Mesh::attach(),
+         * is stale if the generation changed since it was attached.
+         *
+         * @return the generation, 0 until the arena first grows
+         */
+        uint64_t getGeneration() const;
+
+        /**
+         * Get the number of vertices the arena can hold before it grows.
+         *
+         * @return the vertex capacity
+         */
+        size_t getVertexCapacity() const;
+
+        /**
+         * Get the number of indices the arena can hold before it grows.
+         *
+         * @return the index capacity
+         */
+        size_t getIndexCapacity() const;
+    };
+}
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <glpp/extra/Vertex.hpp>
+
+#include "Bounds.hpp"
+
+namespace singe {
+    using glm::mat4;
+    using glm::vec3;
+    using glpp::extra::Vertex;
+
+    /**
+     * Layout of the vertices in a vertex buffer and how glpp::extra::Vertex
+     * points are encoded into it.
+     *
+     * | Type      | Position           | Normal      | UV           | Size |
+     * |-----------|--------------------|-------------|--------------|------|
+     * | Float     | 3 float            | 3 float     | 2 float      | 32   |
+     * | Packed    | 3 float            | 10-10-10-2  | 2 half float | 20   |
+     * | Quantized | 3 normalized short | 10-10-10-2  | 2 half float | 16   |
+     *
+     * All types are read by the same shader inputs (vec3 position, vec3
+     * normal and vec2 texture coordinate), the attribute setup converts them.
+     *
+     * Quantized positions are stored relative to a box around the mesh
+     * bounds. The box is a cube so the decode matrix returned by
+     * VertexFormat::getDecode() only scales uniformly and normals are not
+     * skewed, shaders that transform normals by the model matrix must
+     * normalize them. Model and RenderQueue apply the decode matrix to the
+     * model matrix, so shaders need no changes.
+     */
+    class VertexFormat {
+    public:
+        /// Vertex layouts, see VertexFormat
+        enum Type : uint8_t {
+            Float = 0,
+            Packed,
+            Quantized,
+        };
+
+    private:
+        Type type;
+        vec3 offset;
+        float scale;
+
+    public:
+        /**
+         * Create a VertexFormat. A Quantized format created this way covers
+         * the unit cube.
+         *
+         * @param type the vertex layout
+         */
+        VertexFormat(Type type = Float);
+
+        /**
+         * Create a VertexFormat that can encode the points inside bounds.
+         *
+         * @param type the vertex layout
+         * @param bounds the bounds of the points, used by Quantized
+         */
+        VertexFormat(Type type, const AABB & bounds);
+
+        /**
+         * Get the vertex layout.
+         *
+         * @return the Type
+         */
+        Type getType() const;
+
+        /**
+         * Get the size of one encoded vertex.
+         *
+         * @return the size in bytes
+         */
+        size_t getStride() const;
+
+        /**
+         * Get the size of one vertex of a layout.
+         *
+         * @param type the vertex layout
+         *
+         * @return the size in bytes
+         */
+        static size_t getStride(Type type);
+
+        /**
+         * Are positions stored relative to the quantization box.
+         *
+         * @return true if the type is Quantized
+         */
+        bool isQuantized() const;
+
+        /**
+         * Can a position be encoded without clamping.
+         *
+         * @param pos the position
+         *
+         * @return false if the format is Quantized and pos is outside the
+         *         quantization box
+         */
+        bool contains(const vec3 & pos) const;
+
+        /**
+         * Get the matrix that maps decoded positions to model space.
+         *
+         * @return the decode matrix, identity unless the format is Quantized
+         */
+        mat4 getDecode() const;
+
+        /**
+         * Encode vertices into the layout.
+         *
+         * @param vertices the points to encode
+         * @param count the number of vertices
+         * @param out receives count * getStride() bytes
+         */
+        void encode(const Vertex * vertices, size_t count, void * out) const;
+
+        /**
+         * Round a float to the nearest half float. Out of range values become
+         * infinity.
+         *
+         * @param value the value to convert
+         *
+         * @return the bits of the half float
+         */
+        static uint16_t toHalf(float value);
+
+        /**
+         * Pack a normal as signed normalized 10-10-10-2, w is 0.
+         *
+         * @param norm the normal, components are clamped to [-1, 1]
+         *
+         * @return the packed normal
+         */
+        static uint32_t packNormal(const vec3 & norm);
+
+        /**
+         * Enable the position, normal and texture coordinate attributes of a
+         * layout on the vertex array that is bound, reading the buffer bound
+         * to GL_ARRAY_BUFFER.
+         *
+         * @param type the vertex layout
+         * @param base the byte offset of the first vertex in the buffer
+         */
+        static void attach(Type type, size_t base = 0);
+    };
+}
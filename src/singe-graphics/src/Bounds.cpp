@@ -0,0 +1,88 @@
+#include "singe/Graphics/Bounds.hpp"
+
+#include <limits>
+
+namespace singe {
+    using std::numeric_limits;
+
+    AABB::AABB()
+        : min(numeric_limits<float>::max()),
+          max(numeric_limits<float>::lowest()) {}
+
+    AABB::AABB(const vec3 & min, const vec3 & max) : min(min), max(max) {}
+
+    AABB AABB::infinite() {
+        return AABB(vec3(-numeric_limits<float>::infinity()),
+                    vec3(numeric_limits<float>::infinity()));
+    }
+
+    bool AABB::isEmpty() const {
+        return min.x > max.x || min.y > max.y || min.z > max.z;
+    }
+
+    bool AABB::isInfinite() const {
+        return min.x == -numeric_limits<float>::infinity();
+    }
+
+    void AABB::extend(const vec3 & point) {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    }
+
+    void AABB::extend(const AABB & other) {
+        if (other.isEmpty())
+            return;
+        min = glm::min(min, other.min);
+        max = glm::max(max, other.max);
+    }
+
+    AABB AABB::transformed(const mat4 & matrix) const {
+        if (isEmpty() || isInfinite())
+            return *this;
+
+        vec3 center = (min + max) * 0.5f;
+        vec3 extent = (max - min) * 0.5f;
+
+        vec3 newCenter = vec3(matrix * vec4(center, 1.0f));
+        vec3 newExtent = glm::abs(vec3(matrix[0])) * extent.x
+                         + glm::abs(vec3(matrix[1])) * extent.y
+                         + glm::abs(vec3(matrix[2])) * extent.z;
+
+        return AABB(newCenter - newExtent, newCenter + newExtent);
+    }
+}
+
+namespace singe {
+    Frustum::Frustum() : Frustum(mat4(1)) {}
+
+    Frustum::Frustum(const mat4 & vp) {
+        vec4 row[4];
+        for (int i = 0; i < 4; i++) {
+            row[i] = vec4(vp[0][i], vp[1][i], vp[2][i], vp[3][i]);
+        }
+
+        planes[0] = row[3] + row[0]; // left
+        planes[1] = row[3] - row[0]; // right
+        planes[2] = row[3] + row[1]; // bottom
+        planes[3] = row[3] - row[1]; // top
+        planes[4] = row[3] + row[2]; // near
+        planes[5] = row[3] - row[2]; // far
+    }
+
+    bool Frustum::intersects(const AABB & box) const {
+        if (box.isEmpty())
+            return false;
+        if (box.isInfinite())
+            return true;
+
+        for (auto & plane : planes) {
+            // Corner furthest along the plane normal
+            vec3 p(plane.x > 0 ? box.max.x : box.min.x,
+                   plane.y > 0 ? box.max.y : box.min.y,
+                   plane.z > 0 ? box.max.z : box.min.z);
+            if (glm::dot(vec3(plane), p) + plane.w < 0)
+                return false;
+        }
+        return true;
+    }
+}
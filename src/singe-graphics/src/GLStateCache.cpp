@@ -0,0 +1,147 @@
+#include "singe/Graphics/GLStateCache.hpp"
+
+namespace singe {
+    /// Name that is never returned by OpenGL, marks shadowed state unknown
+    static constexpr GLuint UnknownName = ~GLuint(0);
+    /// Enum value that is never a valid argument, marks state unknown
+    static constexpr GLenum UnknownEnum = ~GLenum(0);
+
+    GLStateCache::GLStateCache() {
+        invalidate();
+    }
+
+    GLStateCache & GLStateCache::current() {
+        static GLStateCache cache;
+        return cache;
+    }
+
+    bool GLStateCache::change(bool changed) {
+        if (changed)
+            stats.issued++;
+        else
+            stats.skipped++;
+        return changed;
+    }
+
+    void GLStateCache::setToggle(Toggle & toggle, GLenum cap, bool enabled) {
+        Toggle value = enabled ? Enabled : Disabled;
+        if (!change(toggle != value))
+            return;
+        toggle = value;
+        if (enabled)
+            glEnable(cap);
+        else
+            glDisable(cap);
+    }
+
+    void GLStateCache::setActiveUnit(GLuint unit) {
+        if (!change(activeUnit != unit))
+            return;
+        activeUnit = unit;
+        glActiveTexture(GL_TEXTURE0 + unit);
+    }
+
+    void GLStateCache::invalidate() {
+        invalidateProgram();
+        invalidateVertexArray();
+        invalidateTextures();
+        blend = depthTest = cullFace = Unknown;
+        blendSrc = blendDst = UnknownEnum;
+        depthFunc = UnknownEnum;
+        cullMode = frontFace = UnknownEnum;
+    }
+
+    void GLStateCache::invalidateProgram() {
+        program = UnknownName;
+    }
+
+    void GLStateCache::invalidateVertexArray() {
+        vertexArray = UnknownName;
+    }
+
+    void GLStateCache::invalidateTextures() {
+        activeUnit = UnknownName;
+        for (auto & texture : textures)
+            texture = {UnknownEnum, UnknownName};
+    }
+
+    void GLStateCache::useProgram(GLuint program) {
+        if (!change(this->program != program))
+            return;
+        this->program = program;
+        glUseProgram(program);
+    }
+
+    void GLStateCache::bindVertexArray(GLuint vertexArray) {
+        if (!change(this->vertexArray != vertexArray))
+            return;
+        this->vertexArray = vertexArray;
+        glBindVertexArray(vertexArray);
+    }
+
+    void GLStateCache::bindTexture(GLuint unit, GLenum target, GLuint texture) {
+        if (unit >= TextureUnits) {
+            change(true);
+            activeUnit = unit;
+            glActiveTexture(GL_TEXTURE0 + unit);
+            glBindTexture(target, texture);
+            return;
+        }
+
+        TextureBinding & binding = textures[unit];
+        if (!change(binding.target != target || binding.name != texture))
+            return;
+        setActiveUnit(unit);
+        binding = {target, texture};
+        glBindTexture(target, texture);
+    }
+
+    void GLStateCache::setBlend(bool enabled) {
+        setToggle(blend, GL_BLEND, enabled);
+    }
+
+    void GLStateCache::setBlendFunc(GLenum src, GLenum dst) {
+        if (!change(blendSrc != src || blendDst != dst))
+            return;
+        blendSrc = src;
+        blendDst = dst;
+        glBlendFunc(src, dst);
+    }
+
+    void GLStateCache::setDepthTest(bool enabled) {
+        setToggle(depthTest, GL_DEPTH_TEST, enabled);
+    }
+
+    void GLStateCache::setDepthFunc(GLenum func) {
+        if (!change(depthFunc != func))
+            return;
+        depthFunc = func;
+        glDepthFunc(func);
+    }
+
+    void GLStateCache::setCullFace(bool enabled) {
+        setToggle(cullFace, GL_CULL_FACE, enabled);
+    }
+
+    void GLStateCache::setCullMode(GLenum mode) {
+        if (!change(cullMode != mode))
+            return;
+        cullMode = mode;
+        glCullFace(mode);
+    }
+
+    void GLStateCache::setFrontFace(GLenum mode) {
+        if (!change(frontFace != mode))
+            return;
+        frontFace = mode;
+        glFrontFace(mode);
+    }
+
+    const GLStateCache::Stats & GLStateCache::getStats() const {
+        return stats;
+    }
+
+    void GLStateCache::resetStats() {
+        stats = Stats();
+    }
+}
@@ -0,0 +1,181 @@
+#include "singe/Graphics/InstancedModel.hpp"
+
+#include <memory>
+
+#include "singe/Graphics/GLStateCache.hpp"
+
+namespace singe {
+    using std::move;
+
+    InstancedModel::InstancedModel()
+        : instanceBuffer(0),
+          instanceCount(0),
+          instanceArray(0),
+          instanceRevision(0),
+          instanceGeneration(0),
+          instanceDecode(1.0f) {}
+
+    InstancedModel::InstancedModel(Model && model)
+        : Model(move(model)),
+          instanceBuffer(0),
+          instanceCount(0),
+          instanceArray(0),
+          instanceRevision(0),
+          instanceGeneration(0),
+          instanceDecode(1.0f) {}
+
+    InstancedModel::InstancedModel(InstancedModel && other)
+        : Model(move(other)),
+          instanceBuffer(other.instanceBuffer),
+          instanceCount(other.instanceCount),
+          instanceBounds(other.instanceBounds),
+          instanceArray(other.instanceArray),
+          instanceRevision(0),
+          instanceGeneration(0),
+          instanceMatrices(move(other.instanceMatrices)),
+          instanceDecode(other.instanceDecode),
+          instances(move(other.instances)) {
+        other.instanceBuffer = 0;
+        other.instanceCount = 0;
+        other.instanceArray = 0;
+    }
+
+    InstancedModel & InstancedModel::operator=(InstancedModel && other) {
+        Model::operator=(move(other));
+        if (instanceBuffer)
+            glDeleteBuffers(1, &instanceBuffer);
+        if (instanceArray) {
+            glDeleteVertexArrays(1, &instanceArray);
+            GLStateCache::current().invalidateVertexArray();
+        }
+        instanceBuffer = other.instanceBuffer;
+        instanceCount = other.instanceCount;
+        instanceBounds = other.instanceBounds;
+        instanceArray = other.instanceArray;
+        instanceRevision = 0;
+        instanceGeneration = 0;
+        instanceMatrices = move(other.instanceMatrices);
+        instanceDecode = other.instanceDecode;
+        instances = move(other.instances);
+        other.instanceBuffer = 0;
+        other.instanceCount = 0;
+        other.instanceArray = 0;
+        return *this;
+    }
+
+    InstancedModel::~InstancedModel() {
+        if (instanceBuffer)
+            glDeleteBuffers(1, &instanceBuffer);
+        if (instanceArray) {
+            glDeleteVertexArrays(1, &instanceArray);
+            GLStateCache::current().invalidateVertexArray();
+        }
+    }
+
+    uint64_t InstancedModel::arenaGeneration() const {
+        auto & arena = mesh->getArena();
+        return arena ? arena->getGeneration() : 0;
+    }
+
+    void InstancedModel::attachMesh() const {
+        auto & cache = GLStateCache::current();
+
+        if (!instanceArray)
+            glGenVertexArrays(1, &instanceArray);
+        cache.bindVertexArray(instanceArray);
+
+        mesh->attach();
+
+        glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+        for (GLuint i = 0; i < 4; i++) {
+            GLuint location = InstanceAttribute + i;
+            glEnableVertexAttribArray(location);
+            glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(mat4),
+                                  (void *)(i * sizeof(glm::vec4)));
+            glVertexAttribDivisor(location, 1);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        instanceRevision = revision;
+        instanceGeneration = arenaGeneration();
+    }
+
+    mat4 InstancedModel::meshDecode() const {
+        return mesh ? mesh->getFormat().getDecode() : mat4(1.0f);
+    }
+
+    vector<mat4> InstancedModel::decodeInstances() const {
+        // Quantized positions are decoded before the instance transform
+        vector<mat4> matrices;
+        matrices.reserve(instanceMatrices.size());
+        for (auto & matrix : instanceMatrices)
+            matrices.push_back(matrix * instanceDecode);
+        return matrices;
+    }
+
+    void InstancedModel::updateInstances(Buffer::Usage usage) {
+        instanceMatrices.clear();
+        instanceMatrices.reserve(instances.size());
+        instanceBounds = AABB();
+        for (auto & instance : instances) {
+            mat4 matrix = instance.toMatrix();
+            instanceBounds.extend(bounds.transformed(matrix));
+            instanceMatrices.push_back(matrix);
+        }
+        revision++;
+
+        instanceDecode = meshDecode();
+        auto matrices = decodeInstances();
+
+        if (!instanceBuffer)
+            glGenBuffers(1, &instanceBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+        glBufferData(GL_ARRAY_BUFFER, matrices.size() * sizeof(mat4),
+                     matrices.data(), usage);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        instanceCount = matrices.size();
+    }
+
+    const AABB & InstancedModel::getBounds() const {
+        return instanceBounds;
+    }
+
+    void InstancedModel::drawMesh() const {
+        if (instanceCount == 0 || !mesh || mesh->getVertexCount() == 0)
+            return;
+
+        // The mesh buffers may have been replaced by Model::update() or by
+        // it's arena growing
+        if (instanceRevision != revision
+            || instanceGeneration != arenaGeneration())
+            attachMesh();
+
+        // Model::update() may have quantized the mesh with a new box
+        mat4 decode = meshDecode();
+        if (decode != instanceDecode) {
+            instanceDecode = decode;
+            auto matrices = decodeInstances();
+            glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+            glBufferSubData(GL_ARRAY_BUFFER, 0, matrices.size() * sizeof(mat4),
+                            matrices.data());
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+
+        GLStateCache::current().bindVertexArray(instanceArray);
+        if (mesh->getIndexCount() > 0)
+            glDrawElementsInstanced(Buffer::Triangles, mesh->getIndexCount(),
+                                    mesh->getIndexType(),
+                                    (void *)mesh->getIndexOffset(),
+                                    instanceCount);
+        else
+            glDrawArraysInstanced(Buffer::Triangles, 0, mesh->getVertexCount(),
+                                  instanceCount);
+    }
+
+    bool InstancedModel::canMultiDraw() const {
+        return false;
+    }
+
+    void InstancedModel::applyDecode(RenderState &) const {}
+}
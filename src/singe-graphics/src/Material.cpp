@@ -1,11 +1,13 @@
 #include "singe/Graphics/Material.hpp"
 
+#include <cstring>
+#include <glm/gtc/type_ptr.hpp>
 #include <memory>
 
 namespace singe {
     using std::move;
 
-    Material::Material() {}
+    Material::Material() : textureLayer(0) {}
 
     Material::Material(Material && other)
         : shader(other.shader),
@@ -17,7 +19,10 @@ namespace singe {
           alpha(other.alpha),
           texture(move(other.texture)),
           normalTexture(move(other.normalTexture)),
-          specularTexture(move(other.specularTexture)) {}
+          specularTexture(move(other.specularTexture)),
+          textureArray(move(other.textureArray)),
+          textureLayer(other.textureLayer),
+          block(move(other.block)) {}
 
     Material & Material::operator=(Material && other) {
         shader = other.shader;
@@ -30,28 +35,87 @@ namespace singe {
         texture = move(other.texture);
         normalTexture = move(other.normalTexture);
         specularTexture = move(other.specularTexture);
+        textureArray = move(other.textureArray);
+        textureLayer = other.textureLayer;
+        block = move(other.block);
         return *this;
     }
 
     Material::~Material() {}
 
+    Material::Ptr Material::clone() const {
+        auto material = std::make_shared<Material>();
+        material->shader = shader;
+        material->name = name;
+        material->ambient = ambient;
+        material->diffuse = diffuse;
+        material->specular = specular;
+        material->specExp = specExp;
+        material->alpha = alpha;
+        material->texture = texture;
+        material->normalTexture = normalTexture;
+        material->specularTexture = specularTexture;
+        material->textureArray = textureArray;
+        material->textureLayer = textureLayer;
+        return material;
+    }
+
+    vector<string> Material::getDefines() const {
+        vector<string> defines;
+        if (textureArray)
+            defines.push_back(TextureArrayDefine);
+        if (normalTexture)
+            defines.push_back(NormalMapDefine);
+        return defines;
+    }
+
     void Material::bind() const {
         if (shader)
             shader->bind();
 
-        if (texture) {
-            glActiveTexture(GL_TEXTURE0);
-            texture->bind();
-        }
+        bindTextures();
+        bindUniforms();
+    }
+
+    void Material::bindTextures() const {
+        if (texture)
+            texture->bind(0);
+
+        if (normalTexture)
+            normalTexture->bind(1);
 
-        if (normalTexture) {
-            glActiveTexture(GL_TEXTURE1);
-            normalTexture->bind();
-        }
+        if (specularTexture)
+            specularTexture->bind(2);
+
+        if (textureArray)
+            textureArray->bind(TextureArrayUnit);
+    }
+
+    void Material::bindUniforms() const {
+        if (!shader || !shader->hasBlock(UniformBlock::MaterialBinding))
+            return;
+
+        if (!block)
+            block = std::make_shared<UniformBlock>(
+                UniformBlock::MaterialBinding, UniformBlock::MaterialSize);
+
+        block->set(0, ambient);
+        block->set(16, diffuse);
+        block->set(32, specular);
+        block->set(44, specExp);
+        block->set(48, alpha);
+        block->set(52, textureLayer);
+        block->upload();
+        block->bind();
+    }
 
-        if (specularTexture) {
-            glActiveTexture(GL_TEXTURE2);
-            specularTexture->bind();
-        }
+    void Material::writeUniforms(uint8_t * out) const {
+        std::memset(out, 0, UniformBlock::MaterialSize);
+        std::memcpy(out, glm::value_ptr(ambient), sizeof(vec3));
+        std::memcpy(out + 16, glm::value_ptr(diffuse), sizeof(vec3));
+        std::memcpy(out + 32, glm::value_ptr(specular), sizeof(vec3));
+        std::memcpy(out + 44, &specExp, sizeof(float));
+        std::memcpy(out + 48, &alpha, sizeof(float));
+        std::memcpy(out + 52, &textureLayer, sizeof(int));
     }
 }
@@ -0,0 +1,277 @@
+#include "singe/Graphics/Mesh.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "singe/Graphics/GLStateCache.hpp"
+
+namespace singe {
+    using std::move;
+    using std::vector;
+
+    Mesh::Mesh(VertexFormat::Type type)
+        : format(type),
+          vertexBuffer(0),
+          indexBuffer(0),
+          vertexArray(0),
+          indexType(GL_UNSIGNED_SHORT),
+          usage(GL_STATIC_DRAW),
+          vertexCount(0),
+          indexCount(0) {}
+
+    Mesh::Mesh(const Vertex * vertices,
+               size_t vertexCount,
+               const uint32_t * indices,
+               size_t indexCount,
+               GLenum usage,
+               VertexFormat::Type type)
+        : Mesh(type) {
+        update(vertices, vertexCount, indices, indexCount, usage);
+    }
+
+    Mesh::Mesh(const VertexArena::Ptr & arena,
+               const Vertex * vertices,
+               size_t vertexCount,
+               const uint32_t * indices,
+               size_t indexCount)
+        : Mesh(arena->getType()) {
+        this->arena = arena;
+        update(vertices, vertexCount, indices, indexCount);
+    }
+
+    Mesh::Mesh(Mesh && other)
+        : arena(move(other.arena)),
+          range(other.range),
+          format(other.format),
+          vertexBuffer(other.vertexBuffer),
+          indexBuffer(other.indexBuffer),
+          vertexArray(other.vertexArray),
+          indexType(other.indexType),
+          usage(other.usage),
+          vertexCount(other.vertexCount),
+          indexCount(other.indexCount),
+          bounds(other.bounds) {
+        other.range = VertexArena::Range();
+        other.vertexBuffer = other.indexBuffer = other.vertexArray = 0;
+        other.vertexCount = other.indexCount = 0;
+    }
+
+    Mesh & Mesh::operator=(Mesh && other) {
+        if (arena)
+            arena->release(range);
+        if (vertexArray) {
+            glDeleteVertexArrays(1, &vertexArray);
+            GLStateCache::current().invalidateVertexArray();
+        }
+        if (vertexBuffer)
+            glDeleteBuffers(1, &vertexBuffer);
+        if (indexBuffer)
+            glDeleteBuffers(1, &indexBuffer);
+        arena = move(other.arena);
+        range = other.range;
+        format = other.format;
+        vertexBuffer = other.vertexBuffer;
+        indexBuffer = other.indexBuffer;
+        vertexArray = other.vertexArray;
+        indexType = other.indexType;
+        usage = other.usage;
+        vertexCount = other.vertexCount;
+        indexCount = other.indexCount;
+        bounds = other.bounds;
+        other.range = VertexArena::Range();
+        other.vertexBuffer = other.indexBuffer = other.vertexArray = 0;
+        other.vertexCount = other.indexCount = 0;
+        return *this;
+    }
+
+    Mesh::~Mesh() {
+        if (arena)
+            arena->release(range);
+        if (vertexArray) {
+            glDeleteVertexArrays(1, &vertexArray);
+            // The name can be re-used by the next vertex array that is created
+            GLStateCache::current().invalidateVertexArray();
+        }
+        if (vertexBuffer)
+            glDeleteBuffers(1, &vertexBuffer);
+        if (indexBuffer)
+            glDeleteBuffers(1, &indexBuffer);
+    }
+
+    void Mesh::update(const Vertex * vertices,
+                      size_t vertexCount,
+                      const uint32_t * indices,
+                      size_t indexCount,
+                      GLenum usage) {
+        bounds = AABB();
+        for (size_t i = 0; i < vertexCount; i++) bounds.extend(vertices[i].pos);
+
+        format = VertexFormat(format.getType(), bounds);
+        vector<uint8_t> encoded;
+        const void * data = vertices;
+        if (format.getType() != VertexFormat::Float) {
+            encoded.resize(vertexCount * format.getStride());
+            format.encode(vertices, vertexCount, encoded.data());
+            data = encoded.data();
+        }
+
+        if (arena) {
+            arena->release(range);
+            range = arena->allocate(data, vertexCount, indices, indexCount);
+            indexType = GL_UNSIGNED_INT;
+            this->vertexCount = range.vertexCount;
+            this->indexCount = range.indexCount;
+            return;
+        }
+
+        this->usage = usage;
+        auto & cache = GLStateCache::current();
+
+        if (!vertexArray) {
+            glGenVertexArrays(1, &vertexArray);
+            glGenBuffers(1, &vertexBuffer);
+        }
+        // The element buffer binding is vertex array state
+        cache.bindVertexArray(vertexArray);
+
+        glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+        glBufferData(GL_ARRAY_BUFFER, vertexCount * format.getStride(), data,
+                     usage);
+
+        if (!indices)
+            indexCount = 0;
+        if (indexCount > 0) {
+            if (!indexBuffer)
+                glGenBuffers(1, &indexBuffer);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+
+            if (vertexCount <= 0x10000) {
+                vector<uint16_t> shortIndices(indices, indices + indexCount);
+                glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                             shortIndices.size() * sizeof(uint16_t),
+                             shortIndices.data(), usage);
+                indexType = GL_UNSIGNED_SHORT;
+            }
+            else {
+                glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                             indexCount * sizeof(uint32_t), indices, usage);
+                indexType = GL_UNSIGNED_INT;
+            }
+        }
+
+        this->vertexCount = vertexCount;
+        this->indexCount = indexCount;
+
+        attach();
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    bool Mesh::updateVertices(size_t first,
+                              const Vertex * vertices,
+                              size_t count) {
+        if (first > vertexCount || count > vertexCount - first)
+            return false;
+        if (count == 0)
+            return true;
+        for (size_t i = 0; i < count; i++) {
+            if (!format.contains(vertices[i].pos))
+                return false;
+        }
+
+        for (size_t i = 0; i < count; i++) bounds.extend(vertices[i].pos);
+
+        vector<uint8_t> encoded;
+        const void * data = vertices;
+        if (format.getType() != VertexFormat::Float) {
+            encoded.resize(count * format.getStride());
+            format.encode(vertices, count, encoded.data());
+            data = encoded.data();
+        }
+
+        size_t stride = format.getStride();
+        size_t base = arena ? range.firstVertex : 0;
+        // Written through the copy target so no vertex array state changes
+        glBindBuffer(GL_COPY_WRITE_BUFFER,
+                     arena ? arena->getVertexBuffer() : vertexBuffer);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, (base + first) * stride,
+                        count * stride, data);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        return true;
+    }
+
+    void Mesh::attach() const {
+        // Arena meshes are read from their range of the shared buffers
+        size_t base = arena ? range.firstVertex * format.getStride() : 0;
+        glBindBuffer(GL_ARRAY_BUFFER,
+                     arena ? arena->getVertexBuffer() : vertexBuffer);
+        VertexFormat::attach(format.getType(), base);
+
+        if (arena)
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, arena->getIndexBuffer());
+        else
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,
+                         indexCount > 0 ? indexBuffer : 0);
+    }
+
+    const VertexArena::Ptr & Mesh::getArena() const {
+        return arena;
+    }
+
+    const VertexArena::Range & Mesh::getRange() const {
+        return range;
+    }
+
+    const VertexFormat & Mesh::getFormat() const {
+        return format;
+    }
+
+    GLuint Mesh::getVertexArray() const {
+        return arena ? arena->getVertexArray() : vertexArray;
+    }
+
+    GLenum Mesh::getIndexType() const {
+        return indexType;
+    }
+
+    GLenum Mesh::getUsage() const {
+        return usage;
+    }
+
+    size_t Mesh::getVertexCount() const {
+        return vertexCount;
+    }
+
+    size_t Mesh::getIndexCount() const {
+        return indexCount;
+    }
+
+    size_t Mesh::getIndexOffset() const {
+        return arena ? range.firstIndex * sizeof(uint32_t) : 0;
+    }
+
+    const AABB & Mesh::getBounds() const {
+        return bounds;
+    }
+
+    void Mesh::draw() const {
+        if (arena) {
+            if (vertexCount == 0)
+                return;
+            GLStateCache::current().bindVertexArray(arena->getVertexArray());
+            glDrawElementsBaseVertex(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT,
+                                     (void *)getIndexOffset(),
+                                     range.firstVertex);
+            return;
+        }
+
+        if (!vertexArray || vertexCount == 0)
+            return;
+
+        GLStateCache::current().bindVertexArray(vertexArray);
+        if (indexCount > 0)
+            glDrawElements(GL_TRIANGLES, indexCount, indexType, nullptr);
+        else
+            glDrawArrays(GL_TRIANGLES, 0, vertexCount);
+    }
+}
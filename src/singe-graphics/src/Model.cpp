@@ -1,50 +1,279 @@
 #include "singe/Graphics/Model.hpp"
 
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <memory>
+#include <unordered_map>
 
 namespace singe {
     using std::move;
+    using std::unordered_map;
 
-    Model::Model() : material(nullptr) {}
+    namespace {
+        /// Hash the bits of a Vertex so identical points compare equal
+        struct VertexHash {
+            size_t operator()(const Vertex & vertex) const {
+                const auto * bytes = reinterpret_cast<const uint8_t *>(&vertex);
+                // FNV-1a
+                uint64_t hash = 14695981039346656037ull;
+                for (size_t i = 0; i < sizeof(Vertex); i++) {
+                    hash ^= bytes[i];
+                    hash *= 1099511628211ull;
+                }
+                return hash;
+            }
+        };
+
+        struct VertexEqual {
+            bool operator()(const Vertex & lhs, const Vertex & rhs) const {
+                return std::memcmp(&lhs, &rhs, sizeof(Vertex)) == 0;
+            }
+        };
+    }
+
+    Model::Model()
+        : revision(0),
+          worldRevision(0),
+          ownsMesh(false),
+          vertexFormat(VertexFormat::Float),
+          material(nullptr),
+          transformHandle(TransformStore::None) {}
 
     Model::Model(const vector<Vertex> & points)
-        : points(points), material(nullptr) {
+        : revision(0),
+          worldRevision(0),
+          ownsMesh(false),
+          points(points),
+          vertexFormat(VertexFormat::Float),
+          material(nullptr),
+          transformHandle(TransformStore::None) {
         update();
     }
 
     Model::Model(vector<Vertex> && points)
-        : points(move(points)), material(nullptr) {
+        : revision(0),
+          worldRevision(0),
+          ownsMesh(false),
+          points(move(points)),
+          vertexFormat(VertexFormat::Float),
+          material(nullptr),
+          transformHandle(TransformStore::None) {
         update();
     }
 
+    Model::Model(const Mesh::Ptr & mesh) : Model() {
+        setMesh(mesh);
+    }
+
     Model::Model(Model && other)
-        : points(move(other.points)),
-          array(move(other.array)),
+        : mesh(move(other.mesh)),
+          bounds(other.bounds),
+          revision(other.revision + 1),
+          worldRevision(0),
+          dirty(move(other.dirty)),
+          ownsMesh(other.ownsMesh),
+          points(move(other.points)),
+          indices(move(other.indices)),
+          vertexFormat(other.vertexFormat),
           material(other.material),
-          transform(other.transform) {}
+          transform(other.transform),
+          transformStore(move(other.transformStore)),
+          transformHandle(other.transformHandle) {}
 
     Model & Model::operator=(Model && other) {
+        mesh = move(other.mesh);
+        bounds = other.bounds;
+        revision++;
+        worldTransform.invalidate();
+        dirty = move(other.dirty);
+        ownsMesh = other.ownsMesh;
         points = move(other.points);
-        array = move(other.array);
+        indices = move(other.indices);
+        vertexFormat = other.vertexFormat;
         material = other.material;
         transform = other.transform;
+        transformStore = move(other.transformStore);
+        transformHandle = other.transformHandle;
         return *this;
     }
 
     Model::~Model() {}
 
+    void Model::weld() {
+        if (!indices.empty())
+            return;
+
+        weld(points, indices);
+    }
+
+    void Model::weld(vector<Vertex> & points, vector<unsigned int> & indices) {
+        unordered_map<Vertex, unsigned int, VertexHash, VertexEqual> unique;
+        unique.reserve(points.size());
+
+        vector<Vertex> welded;
+        welded.reserve(points.size());
+        indices.reserve(points.size());
+
+        for (auto & point : points) {
+            auto [it, inserted] = unique.try_emplace(point, welded.size());
+            if (inserted)
+                welded.push_back(point);
+            indices.push_back(it->second);
+        }
+
+        welded.shrink_to_fit();
+        points = move(welded);
+    }
+
     void Model::update(Buffer::Usage usage) {
-        array.bufferData(points, usage);
-        array.unbind();
+        // A Model created from a Mesh has nothing to buffer
+        if (points.empty() && mesh && mesh->getVertexCount() > 0) {
+            dirty.clear();
+            return;
+        }
+
+        if (updateDirty(usage)) {
+            bounds = mesh->getBounds();
+            revision++;
+            return;
+        }
+        dirty.clear();
+
+        // Copy on write, models sharing the old mesh keep drawing it
+        if (!writableMesh()) {
+            mesh = std::make_shared<Mesh>(vertexFormat);
+            ownsMesh = true;
+        }
+
+        static_assert(sizeof(unsigned int) == sizeof(uint32_t));
+        mesh->update(points.data(), points.size(),
+                     reinterpret_cast<const uint32_t *>(indices.data()),
+                     indices.size(), usage);
+
+        bounds = mesh->getBounds();
+        revision++;
+    }
+
+    bool Model::updateDirty(Buffer::Usage usage) {
+        if (dirty.empty() || !writableMesh())
+            return false;
+
+        // Arena buffers are always GL_STATIC_DRAW
+        if (!mesh->getArena() && mesh->getUsage() != GLenum(usage))
+            return false;
+
+        // Arena meshes store sequential indices for triangle lists
+        size_t indexCount = indices.empty() && mesh->getArena()
+                                ? points.size()
+                                : indices.size();
+        if (mesh->getVertexCount() != points.size()
+            || mesh->getIndexCount() != indexCount)
+            return false;
+
+        // Each run of changed points is written once
+        mergeRanges(dirty, points.size());
+        for (auto [begin, end] : dirty) {
+            // Quantized points can move outside the quantization box
+            if (!mesh->updateVertices(begin, points.data() + begin,
+                                      end - begin))
+                return false;
+        }
+        dirty.clear();
+        return true;
+    }
+
+    bool Model::writableMesh() const {
+        // A Mesh from setMesh() may be cached by ResourceManager, one created
+        // by update() is only shared if it was passed to another setMesh()
+        return mesh && ownsMesh && mesh.use_count() == 1
+               && mesh->getFormat().getType() == vertexFormat;
+    }
+
+    void Model::mergeRanges(vector<std::pair<size_t, size_t>> & ranges,
+                            size_t size) {
+        std::sort(ranges.begin(), ranges.end());
+        size_t count = 0;
+        for (size_t i = 0; i < ranges.size();) {
+            size_t begin = ranges[i].first;
+            size_t end = ranges[i].second;
+            for (i++; i < ranges.size() && ranges[i].first <= end; i++)
+                end = std::max(end, ranges[i].second);
+
+            end = std::min(end, size);
+            if (begin < end)
+                ranges[count++] = {begin, end};
+        }
+        ranges.resize(count);
+    }
+
+    void Model::markDirty(size_t begin, size_t end) {
+        if (begin < end)
+            dirty.emplace_back(begin, end);
+    }
+
+    const Mesh::Ptr & Model::getMesh() const {
+        return mesh;
+    }
+
+    void Model::setMesh(const Mesh::Ptr & mesh) {
+        this->mesh = mesh;
+        ownsMesh = false;
+        bounds = mesh ? mesh->getBounds() : AABB();
+        revision++;
+    }
+
+    const AABB & Model::getBounds() const {
+        return bounds;
+    }
+
+    bool Model::updateWorld(const mat4 & parent, uint64_t parentVersion) const {
+        bool changed;
+        if (transformStore)
+            changed = worldTransform.update(
+                transformStore->getWorld(transformHandle), mat4(1));
+        else
+            changed = worldTransform.update(transform, parent, parentVersion);
+
+        if (!changed && worldRevision == revision)
+            return false;
+
+        worldBounds = getBounds().transformed(worldTransform.getWorld());
+        worldRevision = revision;
+        return true;
+    }
+
+    const TransformCache & Model::getWorldTransform() const {
+        return worldTransform;
+    }
+
+    const AABB & Model::getWorldBounds() const {
+        return worldBounds;
     }
 
     void Model::draw(RenderState state) const {
         state.pushTransform(transform);
+        applyDecode(state);
         if (material) {
             material->bind();
             if (material->shader)
                 material->shader->bind(state);
         }
-        array.drawArrays(Buffer::Triangles, 0, points.size());
+        drawMesh();
+    }
+
+    void Model::drawMesh() const {
+        if (mesh)
+            mesh->draw();
+    }
+
+    bool Model::canMultiDraw() const {
+        return mesh && mesh->getArena() && mesh->getVertexCount() > 0;
+    }
+
+    void Model::applyDecode(RenderState & state) const {
+        if (mesh && mesh->getFormat().isQuantized())
+            state.setTransform(state.getModel() * mesh->getFormat().getDecode(),
+                               state.getLocal());
     }
 }
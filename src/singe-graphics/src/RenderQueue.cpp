@@ -0,0 +1,628 @@
+#include "singe/Graphics/RenderQueue.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <future>
+#include <glm/gtc/type_ptr.hpp>
+#include <iterator>
+#include <memory>
+#include <tuple>
+
+#include "singe/Graphics/GLStateCache.hpp"
+
+namespace singe {
+    using std::move;
+    using std::tie;
+
+    void RenderQueue::CommandList::clear() {
+        items.clear();
+        grids.clear();
+        culled = 0;
+    }
+
+    bool RenderQueue::Item::sameTextures(const Item & other) const {
+        return std::equal(textures, textures + 3, other.textures)
+               && textureArray == other.textureArray;
+    }
+
+    bool RenderQueue::Item::usesDrawList() const {
+        return shader && shader->hasBlock(UniformBlock::DrawListBinding);
+    }
+
+    RenderQueue::RenderQueue() : culling(true), time(0), commandBuffer(0) {}
+
+    RenderQueue::RenderQueue(RenderQueue && other)
+        : commands(move(other.commands)),
+          workerCommands(move(other.workerCommands)),
+          order(move(other.order)),
+          stats(other.stats),
+          culling(other.culling),
+          frustum(other.frustum),
+          pool(move(other.pool)),
+          frame(other.frame),
+          time(other.time),
+          frameBlock(move(other.frameBlock)),
+          drawRing(move(other.drawRing)),
+          drawListRing(move(other.drawListRing)),
+          batches(move(other.batches)),
+          drawCommands(move(other.drawCommands)),
+          commandBuffer(other.commandBuffer) {
+        other.commandBuffer = 0;
+    }
+
+    RenderQueue & RenderQueue::operator=(RenderQueue && other) {
+        if (commandBuffer)
+            glDeleteBuffers(1, &commandBuffer);
+        commands = move(other.commands);
+        workerCommands = move(other.workerCommands);
+        order = move(other.order);
+        stats = other.stats;
+        culling = other.culling;
+        frustum = other.frustum;
+        pool = move(other.pool);
+        frame = other.frame;
+        time = other.time;
+        frameBlock = move(other.frameBlock);
+        drawRing = move(other.drawRing);
+        drawListRing = move(other.drawListRing);
+        batches = move(other.batches);
+        drawCommands = move(other.drawCommands);
+        commandBuffer = other.commandBuffer;
+        other.commandBuffer = 0;
+        return *this;
+    }
+
+    RenderQueue::~RenderQueue() {
+        if (commandBuffer)
+            glDeleteBuffers(1, &commandBuffer);
+    }
+
+    void RenderQueue::submitParallel(const Scene & scene, RenderState state) {
+        // Expand a level at a time on this thread until there are enough
+        // sub-trees to keep every worker busy. An expanded scene stays in
+        // front of it's children so frontier is always in depth first order
+        // and merging the lists in that order matches submitScene().
+        size_t target = pool->size() * 4;
+        vector<Node> expanded;
+        vector<Node> frontier {
+            {&scene, state, 0, false, SIZE_MAX, AABB(), false, SIZE_MAX}};
+        vector<Node> next;
+        size_t pending = 1;
+        while (pending < target) {
+            bool grew = false;
+            next.clear();
+            pending = 0;
+            for (auto & node : frontier) {
+                if (node.list != SIZE_MAX || node.scene->children.empty()) {
+                    if (node.list == SIZE_MAX)
+                        pending++;
+                    next.push_back(node);
+                    continue;
+                }
+
+                size_t index = expanded.size();
+                if (workerCommands.size() <= index)
+                    workerCommands.resize(index + 1);
+                Node & parent = expanded.emplace_back(node);
+                parent.list = index;
+                parent.culled =
+                    !enterScene(*parent.scene, parent.state,
+                                parent.parentVersion, parent.clean,
+                                workerCommands[index], parent.bounds);
+                next.push_back(parent);
+                if (parent.culled)
+                    continue;
+
+                uint64_t version =
+                    parent.scene->getWorldTransform().getVersion();
+                for (auto & child : parent.scene->children) {
+                    next.push_back({child.get(), parent.state, version,
+                                    parent.clean, index, AABB(), false,
+                                    SIZE_MAX});
+                }
+                pending += parent.scene->children.size();
+                grew = true;
+            }
+            frontier.swap(next);
+            if (!grew)
+                break;
+        }
+
+        // Lists below first belong to expanded scenes, each sub-tree left in
+        // frontier gets the next list
+        size_t first = expanded.size();
+        size_t lists = first;
+        for (auto & node : frontier) {
+            if (node.list == SIZE_MAX)
+                node.list = lists++;
+        }
+        if (workerCommands.size() < lists)
+            workerCommands.resize(lists);
+
+        // Each job submits a contiguous run of sub-trees
+        size_t count = std::min(pending, target);
+        vector<std::future<void>> jobs;
+        jobs.reserve(count);
+        for (size_t i = 0; i < count; i++) {
+            size_t begin = frontier.size() * i / count;
+            size_t end = frontier.size() * (i + 1) / count;
+            jobs.push_back(
+                pool->submit([this, &frontier, first, begin, end]() {
+                    for (size_t n = begin; n < end; n++) {
+                        Node & node = frontier[n];
+                        if (node.list < first)
+                            continue;
+                        node.bounds = submitScene(
+                            *node.scene, node.state, node.parentVersion,
+                            node.clean, workerCommands[node.list]);
+                    }
+                }));
+        }
+
+        // Wait for every job before re-throwing, they reference frontier
+        std::exception_ptr error;
+        for (auto & job : jobs) {
+            try {
+                job.get();
+            }
+            catch (...) {
+                if (!error)
+                    error = std::current_exception();
+            }
+        }
+        if (error) {
+            for (size_t i = 0; i < lists; i++) workerCommands[i].clear();
+            std::rethrow_exception(error);
+        }
+
+        // Children are always after their parent, so walking backwards
+        // finishes each scene before it's bounds are added to the parent
+        for (auto & node : frontier) {
+            if (node.list >= first && node.parent != SIZE_MAX)
+                expanded[node.parent].bounds.extend(node.bounds);
+        }
+        for (size_t i = expanded.size(); i-- > 0;) {
+            Node & node = expanded[i];
+            if (!node.culled && !node.clean)
+                node.scene->updateBounds(node.bounds);
+            if (node.parent != SIZE_MAX)
+                expanded[node.parent].bounds.extend(node.scene->getBounds());
+        }
+
+        for (auto & node : frontier) {
+            CommandList & list = workerCommands[node.list];
+            commands.items.insert(commands.items.end(),
+                                  std::make_move_iterator(list.items.begin()),
+                                  std::make_move_iterator(list.items.end()));
+            commands.grids.insert(commands.grids.end(), list.grids.begin(),
+                                  list.grids.end());
+            commands.culled += list.culled;
+            list.clear();
+        }
+    }
+
+    bool RenderQueue::enterScene(const Scene & scene,
+                                 RenderState & state,
+                                 uint64_t parentVersion,
+                                 bool & clean,
+                                 CommandList & list,
+                                 AABB & bounds) const {
+        // The world matrix is updated and read right away so a scene reached
+        // from more than one parent is drawn with each of them
+        if (!clean)
+            clean = !scene.updateTransform(state.getModel(), parentVersion)
+                    && scene.isClean();
+
+        // Only a clean static sub-tree has bounds that are known before it is
+        // walked, other sub-trees rely on culling each model
+        if (clean && culling && !frustum.intersects(scene.getBounds())) {
+            list.culled++;
+            return false;
+        }
+
+        auto & world = scene.getWorldTransform();
+        state.setTransform(world.getWorld(), world.getLocal());
+        uint64_t version = world.getVersion();
+
+        if (scene.grid && state.getGridEnable())
+            list.grids.push_back({scene.grid.get(), state.getMVP()});
+        for (auto & model : scene.models) {
+            if (!clean)
+                model->updateWorld(world.getWorld(), version);
+            bounds.extend(model->getWorldBounds());
+            submitModel(*model, state, list);
+        }
+        return true;
+    }
+
+    AABB RenderQueue::submitScene(const Scene & scene,
+                                  RenderState state,
+                                  uint64_t parentVersion,
+                                  bool clean,
+                                  CommandList & list) const {
+        AABB bounds;
+        if (!enterScene(scene, state, parentVersion, clean, list, bounds))
+            return scene.getBounds();
+
+        uint64_t version = scene.getWorldTransform().getVersion();
+        for (auto & child : scene.children)
+            bounds.extend(submitScene(*child, state, version, clean, list));
+
+        if (!clean)
+            scene.updateBounds(bounds);
+        return scene.getBounds();
+    }
+
+    void RenderQueue::submitModel(const Model & model,
+                                  RenderState state,
+                                  CommandList & list) const {
+        if (culling && !frustum.intersects(model.getWorldBounds())) {
+            list.culled++;
+            return;
+        }
+
+        auto & world = model.getWorldTransform();
+        state.setTransform(world.getWorld(), world.getLocal());
+        model.applyDecode(state);
+
+        const Material * material = model.material.get();
+        const Shader * shader = material ? material->shader.get() : nullptr;
+
+        Item & item =
+            list.items.emplace_back(Item {state, &model, material, shader});
+        item.blended = material && material->alpha < 1.0f;
+        item.depth = 0;
+        if (item.blended) {
+            // Clip space w is the distance along the view direction
+            auto & bounds = model.getWorldBounds();
+            vec4 center = bounds.isEmpty() || bounds.isInfinite()
+                              ? world.getWorld()[3]
+                              : vec4((bounds.min + bounds.max) * 0.5f, 1.0f);
+            item.depth = (state.getVP() * center).w;
+        }
+        if (material) {
+            item.textures[0] = material->texture.get();
+            item.textures[1] = material->normalTexture.get();
+            item.textures[2] = material->specularTexture.get();
+            item.textureArray = material->textureArray.get();
+        }
+        else {
+            item.textures[0] = item.textures[1] = item.textures[2] = nullptr;
+            item.textureArray = nullptr;
+        }
+    }
+
+    bool RenderQueue::getCulling() const {
+        return culling;
+    }
+
+    void RenderQueue::setCulling(bool enabled) {
+        culling = enabled;
+    }
+
+    const ThreadPool::Ptr & RenderQueue::getThreadPool() const {
+        return pool;
+    }
+
+    void RenderQueue::setThreadPool(const ThreadPool::Ptr & pool) {
+        this->pool = pool;
+    }
+
+    void RenderQueue::setTime(float seconds) {
+        time = seconds;
+    }
+
+    void RenderQueue::submit(const Scene & scene, RenderState state) {
+        frame = state;
+        if (culling)
+            frustum = Frustum(state.getVP());
+
+        if (pool && !scene.children.empty() && !pool->isWorker()) {
+            submitParallel(scene, state);
+            return;
+        }
+
+        submitScene(scene, state, 0, false, commands);
+    }
+
+    void RenderQueue::submit(const Model & model, RenderState state) {
+        frame = state;
+        model.updateWorld(state.getModel());
+        if (culling)
+            frustum = Frustum(state.getVP());
+        submitModel(model, state, commands);
+    }
+
+    void RenderQueue::submit(const vector<Model::Ptr> & models,
+                             RenderState state) {
+        frame = state;
+        if (culling)
+            frustum = Frustum(state.getVP());
+
+        commands.items.reserve(commands.items.size() + models.size());
+        for (auto & model : models) {
+            model->updateWorld(state.getModel());
+            submitModel(*model, state, commands);
+        }
+    }
+
+    size_t RenderQueue::size() const {
+        return commands.items.size();
+    }
+
+    void RenderQueue::clear() {
+        commands.clear();
+        order.clear();
+    }
+
+    void RenderQueue::flush() {
+        stats = Stats();
+        stats.culled = commands.culled;
+
+        auto & items = commands.items;
+        order.resize(items.size());
+        for (size_t i = 0; i < order.size(); i++) order[i] = i;
+
+        // Stable so equal keys keep submission order
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            auto & lhs = items[a];
+            auto & rhs = items[b];
+            if (lhs.blended != rhs.blended)
+                return rhs.blended;
+            if (lhs.blended)
+                return lhs.depth > rhs.depth;
+            return tie(lhs.shader, lhs.textures[0], lhs.textures[1],
+                       lhs.textures[2], lhs.textureArray)
+                   < tie(rhs.shader, rhs.textures[0], rhs.textures[1],
+                         rhs.textures[2], rhs.textureArray);
+        });
+
+        bool frameUsed = false;
+        bool drawListUsed = false;
+        size_t drawCount = 0;
+        for (auto & item : items) {
+            if (!item.shader)
+                continue;
+            if (item.shader->hasBlock(UniformBlock::FrameBinding))
+                frameUsed = true;
+            if (item.usesDrawList())
+                drawListUsed = true;
+            else if (item.shader->hasBlock(UniformBlock::DrawBinding))
+                drawCount++;
+        }
+
+        if (frameUsed)
+            bindFrame();
+
+        size_t drawStride = 0;
+        size_t drawOffset = 0;
+        if (drawCount > 0) {
+            if (!drawRing)
+                drawRing = std::make_shared<UniformRing>();
+            size_t alignment = drawRing->getAlignment();
+            drawStride = (UniformBlock::DrawSize + alignment - 1) / alignment
+                         * alignment;
+            drawOffset = writeDraws(drawCount, drawStride);
+        }
+
+        if (drawListUsed)
+            writeDrawLists();
+
+        if (!commands.grids.empty()) {
+            for (auto & grid : commands.grids) grid.grid->draw(grid.mvp);
+            // Grid binds it's own program and vertex array
+            auto & cache = GLStateCache::current();
+            cache.invalidateProgram();
+            cache.invalidateVertexArray();
+        }
+
+        const Item * last = nullptr;
+        size_t nextBatch = 0;
+        for (size_t n = 0; n < order.size();) {
+            Item & item = items[order[n]];
+
+            if (!last || item.shader != last->shader) {
+                if (item.shader) {
+                    item.shader->bind();
+                    item.shader->sendExtras();
+                    stats.shaderBinds++;
+                }
+            }
+
+            if (item.material && (!last || !item.sameTextures(*last))) {
+                item.material->bindTextures();
+                stats.textureBinds++;
+            }
+
+            if (item.material && (!last || item.material != last->material))
+                item.material->bindUniforms();
+
+            if (item.usesDrawList()) {
+                const Batch & batch = batches[nextBatch++];
+                drawBatch(batch);
+                n += batch.count;
+                last = &items[order[n - 1]];
+                continue;
+            }
+
+            if (item.shader) {
+                if (item.shader->hasBlock(UniformBlock::DrawBinding)) {
+                    drawRing->bindRange(UniformBlock::DrawBinding, drawOffset,
+                                        UniformBlock::DrawSize);
+                    drawOffset += drawStride;
+                }
+                else {
+                    // Already bound, this only applies per draw uniforms
+                    // or the override of a Shader subclass
+                    item.shader->bind(item.state);
+                }
+            }
+
+            item.model->drawMesh();
+            stats.draws++;
+
+            last = &item;
+            n++;
+        }
+
+        if (drawCount > 0)
+            drawRing->fence();
+        if (!batches.empty())
+            drawListRing->fence();
+        batches.clear();
+
+        clear();
+    }
+
+    void RenderQueue::bindFrame() {
+        if (!frameBlock)
+            frameBlock = std::make_shared<UniformBlock>(
+                UniformBlock::FrameBinding, UniformBlock::FrameSize);
+
+        frameBlock->set(0, frame.getView());
+        frameBlock->set(64, frame.getProjection());
+        frameBlock->set(128, frame.getVP());
+        frameBlock->set(192, time);
+        frameBlock->upload();
+        frameBlock->bind();
+    }
+
+    size_t RenderQueue::writeDraws(size_t count, size_t stride) {
+        size_t offset;
+        uint8_t * data = drawRing->map(count * stride, offset);
+
+        // Written in draw order so each draw advances by one stride
+        for (size_t i : order) {
+            Item & item = commands.items[i];
+            if (!item.shader || item.usesDrawList()
+                || !item.shader->hasBlock(UniformBlock::DrawBinding))
+                continue;
+
+            mat4 mvp = item.state.getMVP();
+            std::memcpy(data, glm::value_ptr(mvp), sizeof(mat4));
+            std::memcpy(data + sizeof(mat4),
+                        glm::value_ptr(item.state.getModel()), sizeof(mat4));
+            data += stride;
+        }
+
+        drawRing->unmap();
+        return offset;
+    }
+
+    void RenderQueue::writeDrawLists() {
+        batches.clear();
+        drawCommands.clear();
+
+        auto & items = commands.items;
+        bool multiDraw = VertexArena::supportsMultiDraw();
+        for (size_t n = 0; n < order.size(); n++) {
+            const Item & item = items[order[n]];
+            if (!item.usesDrawList())
+                continue;
+
+            const VertexArena * arena = nullptr;
+            if (multiDraw && item.model->canMultiDraw())
+                arena = item.model->getMesh()->getArena().get();
+
+            bool join = false;
+            if (!batches.empty()) {
+                const Batch & batch = batches.back();
+                const Item & first = items[order[batch.begin]];
+                join = batch.begin + batch.count == n
+                       && batch.count < UniformBlock::DrawListCount
+                       && batch.arena == arena && first.shader == item.shader
+                       && first.sameTextures(item);
+            }
+            if (!join)
+                batches.push_back({n, 0, 0, drawCommands.size(), arena});
+
+            Batch & batch = batches.back();
+            if (arena) {
+                // The base instance selects the entry in the draw list
+                auto & range = item.model->getMesh()->getRange();
+                drawCommands.push_back(
+                    {GLuint(range.indexCount), 1, GLuint(range.firstIndex),
+                     GLint(range.firstVertex), GLuint(batch.count)});
+            }
+            batch.count++;
+        }
+
+        if (!drawListRing)
+            drawListRing = std::make_shared<UniformRing>();
+        size_t alignment = drawListRing->getAlignment();
+        size_t size = 0;
+        for (auto & batch : batches) {
+            batch.offset = size;
+            size += (batch.count * UniformBlock::DrawListStride + alignment - 1)
+                    / alignment * alignment;
+        }
+
+        // Every batch binds a whole block, so the last one needs room past
+        // it's own entries
+        size_t offset;
+        uint8_t * data =
+            drawListRing->map(size + UniformBlock::DrawListSize, offset);
+        for (auto & batch : batches) {
+            uint8_t * entry = data + batch.offset;
+            for (size_t i = 0; i < batch.count; i++) {
+                Item & item = items[order[batch.begin + i]];
+                mat4 mvp = item.state.getMVP();
+                std::memcpy(entry, glm::value_ptr(mvp), sizeof(mat4));
+                std::memcpy(entry + sizeof(mat4),
+                            glm::value_ptr(item.state.getModel()),
+                            sizeof(mat4));
+                if (item.material)
+                    item.material->writeUniforms(entry
+                                                 + UniformBlock::DrawSize);
+                else
+                    std::memset(entry + UniformBlock::DrawSize, 0,
+                                UniformBlock::MaterialSize);
+                entry += UniformBlock::DrawListStride;
+            }
+            batch.offset += offset;
+        }
+        drawListRing->unmap();
+
+        if (drawCommands.empty())
+            return;
+
+        if (!commandBuffer)
+            glGenBuffers(1, &commandBuffer);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER,
+                     drawCommands.size() * sizeof(DrawCommand),
+                     drawCommands.data(), GL_STREAM_DRAW);
+    }
+
+    void RenderQueue::drawBatch(const Batch & batch) {
+        drawListRing->bindRange(UniformBlock::DrawListBinding, batch.offset,
+                                UniformBlock::DrawListSize);
+
+        if (batch.arena) {
+            GLStateCache::current().bindVertexArray(
+                batch.arena->getVertexArray());
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+            glMultiDrawElementsIndirect(
+                GL_TRIANGLES, GL_UNSIGNED_INT,
+                (void *)(batch.firstCommand * sizeof(DrawCommand)),
+                batch.count, 0);
+            stats.multiDraws++;
+        }
+        else {
+            for (size_t i = 0; i < batch.count; i++) {
+                // Vertex arrays without a draw index buffer read the
+                // constant attribute value
+                glVertexAttribI4ui(VertexArena::DrawIndexAttribute, i, 0, 0,
+                                   0);
+                commands.items[order[batch.begin + i]].model->drawMesh();
+            }
+        }
+        stats.draws += batch.count;
+    }
+
+    const RenderQueue::Stats & RenderQueue::getStats() const {
+        return stats;
+    }
+}
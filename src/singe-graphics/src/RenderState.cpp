@@ -2,7 +2,7 @@
 
 namespace singe {
     RenderState::RenderState()
-        : projection(1), view(1), model(1), local(1), drawGrid(false) {}
+        : projection(1), view(1), vp(1), model(1), local(1), drawGrid(false) {}
 
     RenderState::RenderState(const mat4 & projection,
                              const mat4 & view,
@@ -11,6 +11,7 @@ namespace singe {
                              bool drawGrid)
         : projection(projection),
           view(view),
+          vp(projection * view),
           model(model),
           local(local),
           drawGrid(drawGrid) {}
@@ -21,6 +22,7 @@ namespace singe {
                              bool drawGrid)
         : projection(camera.projMatrix()),
           view(camera.viewMatrix()),
+          vp(projection * view),
           model(model),
           local(local),
           drawGrid(drawGrid) {}
@@ -35,12 +37,20 @@ namespace singe {
         drawGrid = enabled;
     }
 
-    mat4 RenderState::getVP() const {
-        return projection * view;
+    const mat4 & RenderState::getProjection() const {
+        return projection;
+    }
+
+    const mat4 & RenderState::getView() const {
+        return view;
+    }
+
+    const mat4 & RenderState::getVP() const {
+        return vp;
     }
 
     mat4 RenderState::getMVP() const {
-        return getVP() * model;
+        return vp * model;
     }
 
     const mat4 & RenderState::getModel() const {
@@ -59,4 +69,9 @@ namespace singe {
         model *= matrix;
         local = matrix;
     }
+
+    void RenderState::setTransform(const mat4 & model, const mat4 & local) {
+        this->model = model;
+        this->local = local;
+    }
 }
@@ -2,23 +2,38 @@
 
 #include <memory>
 
+#include "singe/Graphics/RenderQueue.hpp"
+
 namespace singe {
     using std::make_shared;
     using std::move;
 
-    Scene::Scene() {}
+    Scene::Scene()
+        : staticTransforms(false),
+          transformHandle(TransformStore::None),
+          clean(false) {}
 
     Scene::Scene(Scene && other)
         : children(move(other.children)),
           models(move(other.models)),
+          grid(move(other.grid)),
           transform(move(other.transform)),
-          grid(move(other.grid)) {}
+          staticTransforms(other.staticTransforms),
+          transformStore(move(other.transformStore)),
+          transformHandle(other.transformHandle),
+          worldBounds(other.worldBounds),
+          clean(false) {}
 
     Scene & Scene::operator=(Scene && other) {
         children = move(other.children);
         models = move(other.models);
         transform = move(other.transform);
         grid = move(other.grid);
+        staticTransforms = other.staticTransforms;
+        transformStore = move(other.transformStore);
+        transformHandle = other.transformHandle;
+        worldBounds = other.worldBounds;
+        clean = false;
         return *this;
     }
 
@@ -32,11 +47,65 @@ namespace singe {
         return models.emplace_back(make_shared<Model>());
     }
 
+    bool Scene::updateWorld(const mat4 & parent, uint64_t parentVersion) const {
+        bool changed = updateTransform(parent, parentVersion);
+        if (!changed && isClean())
+            return false;
+
+        const mat4 & world = worldTransform.getWorld();
+        uint64_t version = worldTransform.getVersion();
+
+        for (auto & model : models) {
+            if (model->updateWorld(world, version))
+                changed = true;
+        }
+        for (auto & child : children) {
+            if (child->updateWorld(world, version))
+                changed = true;
+        }
+
+        if (changed) {
+            AABB bounds;
+            for (auto & model : models) bounds.extend(model->getWorldBounds());
+            for (auto & child : children) bounds.extend(child->getBounds());
+            updateBounds(bounds);
+        }
+        clean = staticTransforms;
+        return changed;
+    }
+
+    bool Scene::updateTransform(const mat4 & parent,
+                                uint64_t parentVersion) const {
+        if (transformStore)
+            return worldTransform.update(
+                transformStore->getWorld(transformHandle), mat4(1));
+        return worldTransform.update(transform, parent, parentVersion);
+    }
+
+    void Scene::updateBounds(const AABB & bounds) const {
+        worldBounds = grid ? AABB::infinite() : bounds;
+        clean = staticTransforms;
+    }
+
+    bool Scene::isClean() const {
+        return staticTransforms && clean;
+    }
+
+    void Scene::invalidate() {
+        clean = false;
+    }
+
+    const TransformCache & Scene::getWorldTransform() const {
+        return worldTransform;
+    }
+
+    const AABB & Scene::getBounds() const {
+        return worldBounds;
+    }
+
     void Scene::draw(RenderState state) const {
-        state.pushTransform(transform);
-        if (grid && state.getGridEnable())
-            grid->draw(state.getMVP());
-        for (auto & model : models) model->draw(state);
-        for (auto & child : children) child->draw(state);
+        RenderQueue queue;
+        queue.submit(*this, state);
+        queue.flush();
     }
 }
@@ -1,52 +1,162 @@
 #include "singe/Graphics/Shader.hpp"
 
+#include <algorithm>
 #include <memory>
 
+#include "singe/Graphics/GLStateCache.hpp"
+#include "singe/Graphics/Material.hpp"
+
 namespace singe {
     using std::move;
 
-    Shader::Shader(glpp::Shader && shader) : m_shader(move(shader)) {}
+    Shader::Shader(glpp::Shader && shader)
+        : m_shader(move(shader)),
+          m_program(0),
+          m_ownsProgram(false),
+          m_blocks(0) {
+        // glpp does not expose the program name so read it back from GL
+        GLint previous = 0;
+        glGetIntegerv(GL_CURRENT_PROGRAM, &previous);
+        m_shader->bind();
+        GLint program = 0;
+        glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+        glUseProgram(previous);
+        m_program = program;
+
+        connectBlocks();
+        connectSamplers();
+    }
+
+    Shader::Shader(GLuint program)
+        : m_program(program), m_ownsProgram(true), m_blocks(0) {
+        connectBlocks();
+        connectSamplers();
+    }
+
+    Shader::~Shader() {
+        if (m_ownsProgram && m_program) {
+            glDeleteProgram(m_program);
+            // The name can be re-used by the next program that is created
+            GLStateCache::current().invalidateProgram();
+        }
+    }
+
+    void Shader::connectBlocks() {
+        if (bindBlock(UniformBlock::FrameName, UniformBlock::FrameBinding))
+            m_blocks |= 1 << UniformBlock::FrameBinding;
+        if (bindBlock(UniformBlock::MaterialName,
+                      UniformBlock::MaterialBinding))
+            m_blocks |= 1 << UniformBlock::MaterialBinding;
+        if (bindBlock(UniformBlock::DrawName, UniformBlock::DrawBinding))
+            m_blocks |= 1 << UniformBlock::DrawBinding;
+        if (bindBlock(UniformBlock::DrawListName,
+                      UniformBlock::DrawListBinding))
+            m_blocks |= 1 << UniformBlock::DrawListBinding;
+    }
+
+    void Shader::connectSamplers() {
+        GLint location =
+            glGetUniformLocation(m_program, Material::TextureArrayName);
+        if (location < 0)
+            return;
+
+        // Samplers can only be set on the program in use
+        GLint previous = 0;
+        glGetIntegerv(GL_CURRENT_PROGRAM, &previous);
+        glUseProgram(m_program);
+        glUniform1i(location, Material::TextureArrayUnit);
+        glUseProgram(previous);
+    }
+
+    GLuint Shader::program() const {
+        return m_program;
+    }
 
-    Shader::~Shader() {}
+    bool Shader::hasBlock(UniformBlock::Binding binding) const {
+        return m_blocks & (1 << binding);
+    }
 
-    const glpp::Shader & Shader::shader() const {
-        return m_shader;
+    bool Shader::bindBlock(const string & name, GLuint binding) const {
+        GLuint index = glGetUniformBlockIndex(m_program, name.c_str());
+        if (index == GL_INVALID_INDEX)
+            return false;
+        glUniformBlockBinding(m_program, index, binding);
+        return true;
     }
 
     glpp::Uniform Shader::uniform(const string & name) const {
-        return m_shader.uniform(name.data());
+        return glpp::Uniform(glGetUniformLocation(m_program, name.c_str()));
     }
 
     void Shader::addExtra(const shared_ptr<UniformExtra> & extra) {
         m_extras.emplace_back(extra);
+        m_sentVersions.push_back(0);
+
+        auto & block = extra->getBlock();
+        if (block
+            && std::find(m_extraBlocks.begin(), m_extraBlocks.end(), block)
+                   == m_extraBlocks.end())
+            m_extraBlocks.push_back(block);
     }
 
     void Shader::bind() const {
-        m_shader.bind();
+        GLStateCache::current().useProgram(m_program);
     }
 
-    void Shader::bind(RenderState & state) const {
-        m_shader.bind();
-        for (auto & extra : m_extras) {
-            extra->send();
+    void Shader::sendExtras() const {
+        for (size_t i = 0; i < m_extras.size(); i++) {
+            m_extras[i]->update();
+            uint64_t version = m_extras[i]->getVersion();
+            if (version == m_sentVersions[i])
+                continue;
+            m_extras[i]->send();
+            m_sentVersions[i] = version;
+        }
+        for (auto & block : m_extraBlocks) {
+            block->upload();
+            block->bind();
         }
     }
 
+    void Shader::applyState(RenderState & state) const {
+        if (!hasBlock(UniformBlock::DrawBinding))
+            return;
+
+        if (!m_drawBlock)
+            m_drawBlock = std::make_shared<UniformBlock>(
+                UniformBlock::DrawBinding, UniformBlock::DrawSize);
+        m_drawBlock->set(0, state.getMVP());
+        m_drawBlock->set(sizeof(mat4), state.getModel());
+        m_drawBlock->upload();
+        m_drawBlock->bind();
+    }
+
+    void Shader::bind(RenderState & state) const {
+        bind();
+        sendExtras();
+        applyState(state);
+    }
+
     void Shader::unbind() const {
-        m_shader.unbind();
+        GLStateCache::current().useProgram(0);
     }
 }
 
 namespace singe {
     MVPShader::MVPShader(glpp::Shader && shader)
-        : Shader(move(shader)), m_mvp(m_shader.uniform("mvp")) {}
+        : Shader(move(shader)), m_mvp(uniform("mvp")) {}
+
+    MVPShader::MVPShader(GLuint program)
+        : Shader(program), m_mvp(uniform("mvp")) {}
 
     const glpp::Uniform & MVPShader::mvp() const {
         return m_mvp;
     }
 
-    void MVPShader::bind(RenderState & state) const {
-        Shader::bind(state);
-        m_mvp.setMat4(state.getMVP());
+    void MVPShader::applyState(RenderState & state) const {
+        if (hasBlock(UniformBlock::DrawBinding))
+            Shader::applyState(state);
+        else
+            m_mvp.setMat4(state.getMVP());
     }
 }
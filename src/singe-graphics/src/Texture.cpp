@@ -0,0 +1,120 @@
+#include "singe/Graphics/Texture.hpp"
+
+#include "singe/Graphics/GLStateCache.hpp"
+
+namespace singe {
+    Texture::Texture() : name(0), width(0), height(0) {
+        glGenTextures(1, &name);
+    }
+
+    Texture::Texture(Texture && other)
+        : name(other.name), width(other.width), height(other.height) {
+        other.name = 0;
+        other.width = other.height = 0;
+    }
+
+    Texture & Texture::operator=(Texture && other) {
+        if (name) {
+            glDeleteTextures(1, &name);
+            GLStateCache::current().invalidateTextures();
+        }
+        name = other.name;
+        width = other.width;
+        height = other.height;
+        other.name = 0;
+        other.width = other.height = 0;
+        return *this;
+    }
+
+    Texture::~Texture() {
+        if (name) {
+            glDeleteTextures(1, &name);
+            // The name can be re-used by the next texture that is created
+            GLStateCache::current().invalidateTextures();
+        }
+    }
+
+    GLuint Texture::getName() const {
+        return name;
+    }
+
+    unsigned Texture::getWidth() const {
+        return width;
+    }
+
+    unsigned Texture::getHeight() const {
+        return height;
+    }
+
+    bool Texture::isLoaded() const {
+        return width > 0 && height > 0;
+    }
+
+    void Texture::upload(const uint8_t * pixels,
+                         unsigned width,
+                         unsigned height) {
+        bind(0);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA,
+                     GL_UNSIGNED_BYTE, pixels);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                        GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        this->width = width;
+        this->height = height;
+    }
+
+    void Texture::upload(GLenum format,
+                         const Level * levels,
+                         size_t levelCount) {
+        if (levelCount == 0)
+            return;
+
+        bind(0);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        for (size_t i = 0; i < levelCount; i++) {
+            auto & level = levels[i];
+            if (format == GL_RGBA8)
+                glTexImage2D(GL_TEXTURE_2D, i, GL_RGBA8, level.width,
+                             level.height, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                             level.data);
+            else
+                glCompressedTexImage2D(GL_TEXTURE_2D, i, format, level.width,
+                                       level.height, 0, level.size,
+                                       level.data);
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                        levelCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        width = levels[0].width;
+        height = levels[0].height;
+    }
+
+    bool Texture::supportsCompression() {
+        return GLEW_EXT_texture_compression_s3tc;
+    }
+
+    size_t Texture::blockSize(GLenum format) {
+        switch (format) {
+            case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+            case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+                return 8;
+            case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
+            case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+                return 16;
+            default:
+                return 0;
+        }
+    }
+
+    void Texture::bind(GLuint unit) const {
+        GLStateCache::current().bindTexture(unit, GL_TEXTURE_2D, name);
+    }
+}
@@ -0,0 +1,132 @@
+#include "singe/Graphics/TextureArray.hpp"
+
+#include <algorithm>
+
+#include "singe/Graphics/GLStateCache.hpp"
+
+namespace singe {
+    TextureArray::TextureArray(GLenum format,
+                               unsigned width,
+                               unsigned height,
+                               unsigned layers,
+                               size_t levelCount)
+        : name(0),
+          format(format),
+          width(width),
+          height(height),
+          layers(layers),
+          levelCount(levelCount) {
+        glGenTextures(1, &name);
+        bind(0);
+
+        size_t block = Texture::blockSize(format);
+        for (size_t i = 0; i < levelCount; i++) {
+            unsigned levelWidth = std::max(1u, width >> i);
+            unsigned levelHeight = std::max(1u, height >> i);
+            if (block == 0) {
+                glTexImage3D(GL_TEXTURE_2D_ARRAY, i, format, levelWidth,
+                             levelHeight, layers, 0, GL_RGBA,
+                             GL_UNSIGNED_BYTE, nullptr);
+            }
+            else {
+                size_t size = size_t((levelWidth + 3) / 4)
+                              * ((levelHeight + 3) / 4) * block * layers;
+                glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, i, format,
+                                       levelWidth, levelHeight, layers, 0,
+                                       size, nullptr);
+            }
+        }
+
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BASE_LEVEL, 0);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL,
+                        levelCount > 0 ? levelCount - 1 : 0);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER,
+                        levelCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER,
+                        GL_LINEAR);
+    }
+
+    TextureArray::TextureArray(TextureArray && other)
+        : name(other.name),
+          format(other.format),
+          width(other.width),
+          height(other.height),
+          layers(other.layers),
+          levelCount(other.levelCount) {
+        other.name = 0;
+        other.layers = 0;
+    }
+
+    TextureArray & TextureArray::operator=(TextureArray && other) {
+        if (name) {
+            glDeleteTextures(1, &name);
+            GLStateCache::current().invalidateTextures();
+        }
+        name = other.name;
+        format = other.format;
+        width = other.width;
+        height = other.height;
+        layers = other.layers;
+        levelCount = other.levelCount;
+        other.name = 0;
+        other.layers = 0;
+        return *this;
+    }
+
+    TextureArray::~TextureArray() {
+        if (name) {
+            glDeleteTextures(1, &name);
+            // The name can be re-used by the next texture that is created
+            GLStateCache::current().invalidateTextures();
+        }
+    }
+
+    GLuint TextureArray::getName() const {
+        return name;
+    }
+
+    GLenum TextureArray::getFormat() const {
+        return format;
+    }
+
+    unsigned TextureArray::getWidth() const {
+        return width;
+    }
+
+    unsigned TextureArray::getHeight() const {
+        return height;
+    }
+
+    unsigned TextureArray::getLayers() const {
+        return layers;
+    }
+
+    bool TextureArray::upload(unsigned layer,
+                              const Texture::Level * levels,
+                              size_t levelCount) {
+        if (layer >= layers || levelCount < this->levelCount
+            || levels[0].width != width || levels[0].height != height)
+            return false;
+
+        bind(0);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        for (size_t i = 0; i < this->levelCount; i++) {
+            auto & level = levels[i];
+            if (Texture::blockSize(format) == 0)
+                glTexSubImage3D(GL_TEXTURE_2D_ARRAY, i, 0, 0, layer,
+                                level.width, level.height, 1, GL_RGBA,
+                                GL_UNSIGNED_BYTE, level.data);
+            else
+                glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, i, 0, 0, layer,
+                                          level.width, level.height, 1,
+                                          format, level.size, level.data);
+        }
+        return true;
+    }
+
+    void TextureArray::bind(GLuint unit) const {
+        GLStateCache::current().bindTexture(unit, GL_TEXTURE_2D_ARRAY, name);
+    }
+}
@@ -0,0 +1,70 @@
+#include "singe/Graphics/TransformCache.hpp"
+
+#include <atomic>
+
+namespace singe {
+    static std::atomic<uint64_t> nextVersion(1);
+
+    static bool sameTransform(const Transform & lhs, const Transform & rhs) {
+        return lhs.getPosition() == rhs.getPosition()
+               && lhs.getRotation() == rhs.getRotation()
+               && lhs.getScale() == rhs.getScale();
+    }
+
+    TransformCache::TransformCache()
+        : local(1), world(1), parent(1), version(0), parentVersion(0) {}
+
+    bool TransformCache::update(const Transform & transform,
+                                const mat4 & parent,
+                                uint64_t parentVersion) {
+        bool localDirty = version == 0 || !sameTransform(transform, last);
+        if (localDirty) {
+            last = transform;
+            local = transform.toMatrix();
+        }
+
+        return updateWorld(localDirty, parent, parentVersion);
+    }
+
+    bool TransformCache::update(const mat4 & local,
+                                const mat4 & parent,
+                                uint64_t parentVersion) {
+        bool localDirty = version == 0 || local != this->local;
+        if (localDirty)
+            this->local = local;
+
+        return updateWorld(localDirty, parent, parentVersion);
+    }
+
+    bool TransformCache::updateWorld(bool localDirty,
+                                     const mat4 & parent,
+                                     uint64_t parentVersion) {
+        bool parentDirty = parentVersion != this->parentVersion
+                           || (parentVersion == 0 && parent != this->parent);
+
+        if (!localDirty && !parentDirty)
+            return false;
+
+        this->parent = parent;
+        this->parentVersion = parentVersion;
+        world = parent * local;
+        version = nextVersion++;
+        return true;
+    }
+
+    void TransformCache::invalidate() {
+        version = 0;
+    }
+
+    const mat4 & TransformCache::getLocal() const {
+        return local;
+    }
+
+    const mat4 & TransformCache::getWorld() const {
+        return world;
+    }
+
+    uint64_t TransformCache::getVersion() const {
+        return version;
+    }
+}
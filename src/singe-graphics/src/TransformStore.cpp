@@ -0,0 +1,193 @@
+#include "singe/Graphics/TransformStore.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <memory>
+#include <singe/Support/log.hpp>
+
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define SINGE_TRANSFORM_SSE
+#endif
+
+namespace singe {
+    using std::move;
+
+    /// Local matrix from translation, rotation and scale (T * R * S)
+    static inline void composeLocal(const vec3 & p,
+                                    const quat & q,
+                                    const vec3 & s,
+                                    float * out) {
+        float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+        float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+        float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+
+        out[0] = (1 - 2 * (yy + zz)) * s.x;
+        out[1] = 2 * (xy + wz) * s.x;
+        out[2] = 2 * (xz - wy) * s.x;
+        out[3] = 0;
+
+        out[4] = 2 * (xy - wz) * s.y;
+        out[5] = (1 - 2 * (xx + zz)) * s.y;
+        out[6] = 2 * (yz + wx) * s.y;
+        out[7] = 0;
+
+        out[8] = 2 * (xz + wy) * s.z;
+        out[9] = 2 * (yz - wx) * s.z;
+        out[10] = (1 - 2 * (xx + yy)) * s.z;
+        out[11] = 0;
+
+        out[12] = p.x;
+        out[13] = p.y;
+        out[14] = p.z;
+        out[15] = 1;
+    }
+
+    /// Column major 4x4 multiply, out = a * b. out must not alias a or b.
+    static inline void multiply(const float * a, const float * b, float * out) {
+#ifdef SINGE_TRANSFORM_SSE
+        __m128 a0 = _mm_loadu_ps(a);
+        __m128 a1 = _mm_loadu_ps(a + 4);
+        __m128 a2 = _mm_loadu_ps(a + 8);
+        __m128 a3 = _mm_loadu_ps(a + 12);
+        for (int i = 0; i < 4; i++) {
+            const float * col = b + i * 4;
+            __m128 r = _mm_mul_ps(a0, _mm_set1_ps(col[0]));
+            r = _mm_add_ps(r, _mm_mul_ps(a1, _mm_set1_ps(col[1])));
+            r = _mm_add_ps(r, _mm_mul_ps(a2, _mm_set1_ps(col[2])));
+            r = _mm_add_ps(r, _mm_mul_ps(a3, _mm_set1_ps(col[3])));
+            _mm_storeu_ps(out + i * 4, r);
+        }
+#else
+        for (int i = 0; i < 4; i++) {
+            const float * col = b + i * 4;
+            for (int j = 0; j < 4; j++) {
+                out[i * 4 + j] = a[j] * col[0] + a[4 + j] * col[1]
+                                 + a[8 + j] * col[2] + a[12 + j] * col[3];
+            }
+        }
+#endif
+    }
+
+    TransformStore::TransformStore() {}
+
+    TransformStore::TransformStore(TransformStore && other)
+        : parents(move(other.parents)),
+          positions(move(other.positions)),
+          rotations(move(other.rotations)),
+          scales(move(other.scales)),
+          worlds(move(other.worlds)),
+          dirty(move(other.dirty)) {}
+
+    TransformStore & TransformStore::operator=(TransformStore && other) {
+        parents = move(other.parents);
+        positions = move(other.positions);
+        rotations = move(other.rotations);
+        scales = move(other.scales);
+        worlds = move(other.worlds);
+        dirty = move(other.dirty);
+        return *this;
+    }
+
+    TransformStore::~TransformStore() {}
+
+    void TransformStore::reserve(size_t count) {
+        parents.reserve(count);
+        positions.reserve(count);
+        rotations.reserve(count);
+        scales.reserve(count);
+        worlds.reserve(count);
+        dirty.reserve(count);
+    }
+
+    TransformStore::Handle TransformStore::add(const Transform & transform,
+                                               Handle parent) {
+        Handle handle = parents.size();
+        if (parent != None && parent >= handle) {
+            Logging::Graphics->error(
+                "TransformStore parent {} of node {} is not in the store",
+                parent, handle);
+            assert(!"TransformStore parent must be added before it's children");
+            parent = None;
+        }
+        parents.push_back(parent);
+        positions.push_back(transform.getPosition());
+        rotations.push_back(transform.getRotation());
+        scales.push_back(transform.getScale());
+        worlds.emplace_back(1);
+        dirty.push_back(1);
+        return handle;
+    }
+
+    void TransformStore::clear() {
+        parents.clear();
+        positions.clear();
+        rotations.clear();
+        scales.clear();
+        worlds.clear();
+        dirty.clear();
+    }
+
+    size_t TransformStore::size() const {
+        return parents.size();
+    }
+
+    TransformStore::Handle TransformStore::getParent(Handle handle) const {
+        return parents[handle];
+    }
+
+    void TransformStore::set(Handle handle, const Transform & transform) {
+        positions[handle] = transform.getPosition();
+        rotations[handle] = transform.getRotation();
+        scales[handle] = transform.getScale();
+        dirty[handle] = 1;
+    }
+
+    Transform TransformStore::get(Handle handle) const {
+        return Transform(positions[handle], rotations[handle], scales[handle]);
+    }
+
+    void TransformStore::setPosition(Handle handle, const vec3 & position) {
+        positions[handle] = position;
+        dirty[handle] = 1;
+    }
+
+    void TransformStore::setRotation(Handle handle, const quat & rotation) {
+        rotations[handle] = rotation;
+        dirty[handle] = 1;
+    }
+
+    void TransformStore::setScale(Handle handle, const vec3 & scale) {
+        scales[handle] = scale;
+        dirty[handle] = 1;
+    }
+
+    void TransformStore::update() {
+        float local[16];
+        size_t count = parents.size();
+        for (size_t i = 0; i < count; i++) {
+            Handle parent = parents[i];
+            // Parents come first so their dirty flag is already final
+            if (parent != None && dirty[parent])
+                dirty[i] = 1;
+            if (!dirty[i])
+                continue;
+
+            float * world = &worlds[i][0][0];
+            if (parent == None) {
+                composeLocal(positions[i], rotations[i], scales[i], world);
+            }
+            else {
+                composeLocal(positions[i], rotations[i], scales[i], local);
+                multiply(&worlds[parent][0][0], local, world);
+            }
+        }
+
+        // Flags are kept until the sweep ends so children see them
+        std::fill(dirty.begin(), dirty.end(), 0);
+    }
+
+    const mat4 & TransformStore::getWorld(Handle handle) const {
+        return worlds[handle];
+    }
+}
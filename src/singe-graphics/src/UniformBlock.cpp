@@ -0,0 +1,124 @@
+#include "singe/Graphics/UniformBlock.hpp"
+
+#include <cstring>
+#include <glm/gtc/type_ptr.hpp>
+#include <memory>
+
+namespace singe {
+    using std::move;
+
+    UniformBlock::UniformBlock(GLuint binding, size_t size)
+        : buffer(0), binding(binding), data(size, 0), dirty(true) {
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+        glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    UniformBlock::UniformBlock(UniformBlock && other)
+        : buffer(other.buffer),
+          binding(other.binding),
+          data(move(other.data)),
+          dirty(other.dirty) {
+        other.buffer = 0;
+    }
+
+    UniformBlock & UniformBlock::operator=(UniformBlock && other) {
+        if (buffer)
+            glDeleteBuffers(1, &buffer);
+        buffer = other.buffer;
+        binding = other.binding;
+        data = move(other.data);
+        dirty = other.dirty;
+        other.buffer = 0;
+        return *this;
+    }
+
+    UniformBlock::~UniformBlock() {
+        if (buffer)
+            glDeleteBuffers(1, &buffer);
+    }
+
+    void UniformBlock::write(size_t offset, const void * value, size_t size) {
+        if (offset + size > data.size())
+            return;
+        if (std::memcmp(data.data() + offset, value, size) == 0)
+            return;
+        std::memcpy(data.data() + offset, value, size);
+        dirty = true;
+    }
+
+    GLuint UniformBlock::getBinding() const {
+        return binding;
+    }
+
+    size_t UniformBlock::size() const {
+        return data.size();
+    }
+
+    bool UniformBlock::isDirty() const {
+        return dirty;
+    }
+
+    void UniformBlock::set(size_t offset, bool value) {
+        GLint v = value ? 1 : 0;
+        write(offset, &v, sizeof(v));
+    }
+
+    void UniformBlock::set(size_t offset, int value) {
+        write(offset, &value, sizeof(value));
+    }
+
+    void UniformBlock::set(size_t offset, unsigned int value) {
+        write(offset, &value, sizeof(value));
+    }
+
+    void UniformBlock::set(size_t offset, float value) {
+        write(offset, &value, sizeof(value));
+    }
+
+    void UniformBlock::set(size_t offset, const vec2 & value) {
+        write(offset, glm::value_ptr(value), sizeof(float) * 2);
+    }
+
+    void UniformBlock::set(size_t offset, const vec3 & value) {
+        write(offset, glm::value_ptr(value), sizeof(float) * 3);
+    }
+
+    void UniformBlock::set(size_t offset, const vec4 & value) {
+        write(offset, glm::value_ptr(value), sizeof(float) * 4);
+    }
+
+    // std140 matrix columns are padded to the size of a vec4
+
+    void UniformBlock::set(size_t offset, const mat2 & value) {
+        for (int i = 0; i < 2; i++)
+            write(offset + i * sizeof(vec4), glm::value_ptr(value[i]),
+                  sizeof(float) * 2);
+    }
+
+    void UniformBlock::set(size_t offset, const mat3 & value) {
+        for (int i = 0; i < 3; i++)
+            write(offset + i * sizeof(vec4), glm::value_ptr(value[i]),
+                  sizeof(float) * 3);
+    }
+
+    void UniformBlock::set(size_t offset, const mat4 & value) {
+        write(offset, glm::value_ptr(value), sizeof(mat4));
+    }
+
+    bool UniformBlock::upload() {
+        if (!dirty)
+            return false;
+
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, data.size(), data.data());
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        dirty = false;
+        return true;
+    }
+
+    void UniformBlock::bind() const {
+        glBindBufferBase(GL_UNIFORM_BUFFER, binding, buffer);
+    }
+}
@@ -1,77 +1,169 @@
 #include "singe/Graphics/UniformExtra.hpp"
 
 namespace singe {
-    UniformExtra::UniformExtra(glpp::Uniform uniform) : uniform(uniform) {}
+    UniformExtra::UniformExtra(glpp::Uniform uniform)
+        : uniform(uniform), offset(0), version(1) {}
+
+    UniformExtra::UniformExtra(UniformBlock::ConstPtr & block, size_t offset)
+        : uniform(-1), block(block), offset(offset), version(1) {}
 
     UniformExtra::~UniformExtra() {}
 
+    const UniformBlock::Ptr & UniformExtra::getBlock() const {
+        return block;
+    }
+
+    uint64_t UniformExtra::getVersion() const {
+        return version;
+    }
+
     BoolUniformExtra::BoolUniformExtra(glpp::Uniform uniform)
-        : UniformExtra(uniform), value(false) {}
+        : UniformExtra(uniform), value(false), last(false) {}
+
+    BoolUniformExtra::BoolUniformExtra(UniformBlock::ConstPtr & block,
+                                       size_t offset)
+        : UniformExtra(block, offset), value(false), last(false) {}
+
+    void BoolUniformExtra::update() {
+        track(value, last);
+    }
 
     void BoolUniformExtra::send() const {
-        uniform.setBool(value);
+        write(value, &glpp::Uniform::setBool);
     }
 
     IntUniformExtra::IntUniformExtra(glpp::Uniform uniform)
-        : UniformExtra(uniform), value(0) {}
+        : UniformExtra(uniform), value(0), last(0) {}
+
+    IntUniformExtra::IntUniformExtra(UniformBlock::ConstPtr & block,
+                                     size_t offset)
+        : UniformExtra(block, offset), value(0), last(0) {}
+
+    void IntUniformExtra::update() {
+        track(value, last);
+    }
 
     void IntUniformExtra::send() const {
-        uniform.setInt(value);
+        write(value, &glpp::Uniform::setInt);
     }
 
     UIntUniformExtra::UIntUniformExtra(glpp::Uniform uniform)
-        : UniformExtra(uniform), value(0) {}
+        : UniformExtra(uniform), value(0), last(0) {}
+
+    UIntUniformExtra::UIntUniformExtra(UniformBlock::ConstPtr & block,
+                                       size_t offset)
+        : UniformExtra(block, offset), value(0), last(0) {}
+
+    void UIntUniformExtra::update() {
+        track(value, last);
+    }
 
     void UIntUniformExtra::send() const {
-        uniform.setUInt(value);
+        write(value, &glpp::Uniform::setUInt);
     }
 
     FloatUniformExtra::FloatUniformExtra(glpp::Uniform uniform)
-        : UniformExtra(uniform), value(0) {}
+        : UniformExtra(uniform), value(0), last(0) {}
+
+    FloatUniformExtra::FloatUniformExtra(UniformBlock::ConstPtr & block,
+                                         size_t offset)
+        : UniformExtra(block, offset), value(0), last(0) {}
+
+    void FloatUniformExtra::update() {
+        track(value, last);
+    }
 
     void FloatUniformExtra::send() const {
-        uniform.setFloat(value);
+        write(value, &glpp::Uniform::setFloat);
     }
 
     Vec2UniformExtra::Vec2UniformExtra(glpp::Uniform uniform)
-        : UniformExtra(uniform), value(0) {}
+        : UniformExtra(uniform), value(0), last(0) {}
+
+    Vec2UniformExtra::Vec2UniformExtra(UniformBlock::ConstPtr & block,
+                                       size_t offset)
+        : UniformExtra(block, offset), value(0), last(0) {}
+
+    void Vec2UniformExtra::update() {
+        track(value, last);
+    }
 
     void Vec2UniformExtra::send() const {
-        uniform.setVec2(value);
+        write(value, &glpp::Uniform::setVec2);
     }
 
     Vec3UniformExtra::Vec3UniformExtra(glpp::Uniform uniform)
-        : UniformExtra(uniform), value(0) {}
+        : UniformExtra(uniform), value(0), last(0) {}
+
+    Vec3UniformExtra::Vec3UniformExtra(UniformBlock::ConstPtr & block,
+                                       size_t offset)
+        : UniformExtra(block, offset), value(0), last(0) {}
+
+    void Vec3UniformExtra::update() {
+        track(value, last);
+    }
 
     void Vec3UniformExtra::send() const {
-        uniform.setVec3(value);
+        write(value, &glpp::Uniform::setVec3);
     }
 
     Vec4UniformExtra::Vec4UniformExtra(glpp::Uniform uniform)
-        : UniformExtra(uniform), value(0) {}
+        : UniformExtra(uniform), value(0), last(0) {}
+
+    Vec4UniformExtra::Vec4UniformExtra(UniformBlock::ConstPtr & block,
+                                       size_t offset)
+        : UniformExtra(block, offset), value(0), last(0) {}
+
+    void Vec4UniformExtra::update() {
+        track(value, last);
+    }
 
     void Vec4UniformExtra::send() const {
-        uniform.setVec4(value);
+        write(value, &glpp::Uniform::setVec4);
     }
 
     Mat2UniformExtra::Mat2UniformExtra(glpp::Uniform uniform)
-        : UniformExtra(uniform), value(0) {}
+        : UniformExtra(uniform), value(0), last(0) {}
+
+    Mat2UniformExtra::Mat2UniformExtra(UniformBlock::ConstPtr & block,
+                                       size_t offset)
+        : UniformExtra(block, offset), value(0), last(0) {}
+
+    void Mat2UniformExtra::update() {
+        track(value, last);
+    }
 
     void Mat2UniformExtra::send() const {
-        uniform.setMat2(value);
+        write(value, &glpp::Uniform::setMat2);
     }
 
     Mat3UniformExtra::Mat3UniformExtra(glpp::Uniform uniform)
-        : UniformExtra(uniform), value(0) {}
+        : UniformExtra(uniform), value(0), last(0) {}
+
+    Mat3UniformExtra::Mat3UniformExtra(UniformBlock::ConstPtr & block,
+                                       size_t offset)
+        : UniformExtra(block, offset), value(0), last(0) {}
+
+    void Mat3UniformExtra::update() {
+        track(value, last);
+    }
 
     void Mat3UniformExtra::send() const {
-        uniform.setMat3(value);
+        write(value, &glpp::Uniform::setMat3);
     }
 
     Mat4UniformExtra::Mat4UniformExtra(glpp::Uniform uniform)
-        : UniformExtra(uniform), value(0) {}
+        : UniformExtra(uniform), value(0), last(0) {}
+
+    Mat4UniformExtra::Mat4UniformExtra(UniformBlock::ConstPtr & block,
+                                       size_t offset)
+        : UniformExtra(block, offset), value(0), last(0) {}
+
+    void Mat4UniformExtra::update() {
+        track(value, last);
+    }
 
     void Mat4UniformExtra::send() const {
-        uniform.setMat4(value);
+        write(value, &glpp::Uniform::setMat4);
     }
 }
@@ -0,0 +1,160 @@
+#include "singe/Graphics/UniformRing.hpp"
+
+#include <singe/Support/Util.hpp>
+#include <singe/Support/log.hpp>
+
+namespace singe {
+    UniformRing::UniformRing(size_t capacity)
+        : buffer(0),
+          capacity(0),
+          head(0),
+          alignment(256),
+          persistent(GLEW_ARB_buffer_storage),
+          mapped(nullptr),
+          mappedBegin(0),
+          mappedEnd(0) {
+        GLint value = 0;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &value);
+        if (value > 0)
+            alignment = value;
+
+        create(capacity);
+    }
+
+    UniformRing::~UniformRing() {
+        destroy();
+    }
+
+    void UniformRing::create(size_t capacity) {
+        this->capacity = alignUp(capacity, alignment);
+        head = 0;
+
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+        if (persistent) {
+            GLbitfield flags =
+                GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(GL_UNIFORM_BUFFER, this->capacity, nullptr, flags);
+            mapped = (uint8_t *)glMapBufferRange(GL_UNIFORM_BUFFER, 0,
+                                                 this->capacity, flags);
+        }
+        else {
+            glBufferData(GL_UNIFORM_BUFFER, this->capacity, nullptr,
+                         GL_STREAM_DRAW);
+        }
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+        Logging::Graphics->debug("Created {} uniform ring of {} bytes",
+                                 persistent ? "persistent" : "streamed",
+                                 this->capacity);
+    }
+
+    void UniformRing::destroy() {
+        for (auto & fence : fences) glDeleteSync(fence.sync);
+        fences.clear();
+
+        if (!buffer)
+            return;
+
+        if (persistent && mapped) {
+            glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+            glUnmapBuffer(GL_UNIFORM_BUFFER);
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        }
+        mapped = nullptr;
+        glDeleteBuffers(1, &buffer);
+        buffer = 0;
+    }
+
+    void UniformRing::waitFor(size_t begin, size_t end) {
+        // Fences are in submit order so waiting for the last overlapping
+        // fence also waits for every fence before it
+        size_t last = fences.size();
+        for (size_t i = 0; i < fences.size(); i++) {
+            if (fences[i].begin < end && begin < fences[i].end)
+                last = i;
+        }
+        if (last == fences.size())
+            return;
+
+        glClientWaitSync(fences[last].sync, GL_SYNC_FLUSH_COMMANDS_BIT,
+                         GL_TIMEOUT_IGNORED);
+        for (size_t i = 0; i <= last; i++) {
+            glDeleteSync(fences.front().sync);
+            fences.pop_front();
+        }
+    }
+
+    size_t UniformRing::getAlignment() const {
+        return alignment;
+    }
+
+    bool UniformRing::isPersistent() const {
+        return persistent;
+    }
+
+    uint8_t * UniformRing::map(size_t size, size_t & offset) {
+        if (size > capacity) {
+            size_t grow = capacity;
+            while (grow < size) grow *= 2;
+            if (persistent && !fences.empty()) {
+                glClientWaitSync(fences.back().sync, GL_SYNC_FLUSH_COMMANDS_BIT,
+                                 GL_TIMEOUT_IGNORED);
+            }
+            destroy();
+            create(grow);
+        }
+
+        offset = alignUp(head, alignment);
+        bool wrap = offset + size > capacity;
+        if (wrap)
+            offset = 0;
+
+        mappedBegin = offset;
+        mappedEnd = offset + size;
+        head = mappedEnd;
+
+        if (persistent) {
+            waitFor(mappedBegin, mappedEnd);
+            return mapped + offset;
+        }
+
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+        if (wrap) {
+            // Orphan the storage so draws still reading it are not stalled
+            glBufferData(GL_UNIFORM_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+        }
+        mapped = (uint8_t *)glMapBufferRange(
+            GL_UNIFORM_BUFFER, offset, size,
+            GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT
+                | GL_MAP_INVALIDATE_RANGE_BIT);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        return mapped;
+    }
+
+    void UniformRing::unmap() {
+        if (persistent)
+            return;
+
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+        glUnmapBuffer(GL_UNIFORM_BUFFER);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        mapped = nullptr;
+    }
+
+    void UniformRing::bindRange(GLuint binding,
+                                size_t offset,
+                                size_t size) const {
+        glBindBufferRange(GL_UNIFORM_BUFFER, binding, buffer, offset, size);
+    }
+
+    void UniformRing::fence() {
+        // Orphaning takes care of synchronization without a persistent map
+        if (!persistent || mappedBegin == mappedEnd)
+            return;
+
+        GLsync sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        fences.push_back({sync, mappedBegin, mappedEnd});
+        mappedBegin = mappedEnd = 0;
+    }
+}
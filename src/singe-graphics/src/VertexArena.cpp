@@ -0,0 +1,193 @@
+#include "singe/Graphics/VertexArena.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <numeric>
+
+#include "singe/Graphics/GLStateCache.hpp"
+#include "singe/Graphics/UniformBlock.hpp"
+
+namespace singe {
+    VertexArena::VertexArena(VertexFormat::Type type,
+                             size_t vertexCapacity,
+                             size_t indexCapacity)
+        : type(type),
+          vertexBuffer(0),
+          indexBuffer(0),
+          drawIndexBuffer(0),
+          vertexArray(0),
+          vertices(vertexCapacity),
+          indices(indexCapacity),
+          multiDraw(supportsMultiDraw()),
+          generation(0) {
+        glGenBuffers(1, &vertexBuffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, vertexBuffer);
+        glBufferData(GL_COPY_WRITE_BUFFER,
+                     vertexCapacity * VertexFormat::getStride(type), nullptr,
+                     GL_STATIC_DRAW);
+
+        glGenBuffers(1, &indexBuffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, indexBuffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, indexCapacity * sizeof(uint32_t),
+                     nullptr, GL_STATIC_DRAW);
+
+        if (multiDraw) {
+            // Instance i reads i, the base instance of each command selects
+            // it's entry in the draw list
+            vector<uint32_t> drawIndices(UniformBlock::DrawListCount);
+            std::iota(drawIndices.begin(), drawIndices.end(), 0);
+            glGenBuffers(1, &drawIndexBuffer);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, drawIndexBuffer);
+            glBufferData(GL_COPY_WRITE_BUFFER,
+                         drawIndices.size() * sizeof(uint32_t),
+                         drawIndices.data(), GL_STATIC_DRAW);
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        glGenVertexArrays(1, &vertexArray);
+        attachBuffers();
+    }
+
+    VertexArena::~VertexArena() {
+        if (vertexArray) {
+            glDeleteVertexArrays(1, &vertexArray);
+            GLStateCache::current().invalidateVertexArray();
+        }
+        glDeleteBuffers(1, &vertexBuffer);
+        glDeleteBuffers(1, &indexBuffer);
+        if (drawIndexBuffer)
+            glDeleteBuffers(1, &drawIndexBuffer);
+    }
+
+    void VertexArena::attachBuffers() {
+        GLStateCache::current().bindVertexArray(vertexArray);
+
+        glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+        VertexFormat::attach(type);
+
+        if (drawIndexBuffer) {
+            glBindBuffer(GL_ARRAY_BUFFER, drawIndexBuffer);
+            glEnableVertexAttribArray(DrawIndexAttribute);
+            glVertexAttribIPointer(DrawIndexAttribute, 1, GL_UNSIGNED_INT,
+                                   sizeof(uint32_t), nullptr);
+            glVertexAttribDivisor(DrawIndexAttribute, 1);
+        }
+
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    size_t VertexArena::allocate(FreeList & list,
+                                 GLuint & buffer,
+                                 size_t elementSize,
+                                 size_t size) {
+        size_t offset = 0;
+        if (size == 0 || list.allocate(size, offset))
+            return offset;
+
+        size_t old = list.getCapacity();
+        size_t capacity = std::max(old * 2, old + size);
+
+        // Copy into a larger buffer, ranges keep their offsets
+        GLuint grown;
+        glGenBuffers(1, &grown);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, grown);
+        glBufferData(GL_COPY_WRITE_BUFFER, capacity * elementSize, nullptr,
+                     GL_STATIC_DRAW);
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0,
+                            old * elementSize);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        glDeleteBuffers(1, &buffer);
+        buffer = grown;
+
+        list.grow(capacity);
+        list.allocate(size, offset);
+        return offset;
+    }
+
+    bool VertexArena::supportsMultiDraw() {
+        return GLEW_ARB_multi_draw_indirect && GLEW_ARB_base_instance;
+    }
+
+    bool VertexArena::hasDrawIndex() const {
+        return multiDraw;
+    }
+
+    VertexFormat::Type VertexArena::getType() const {
+        return type;
+    }
+
+    VertexArena::Range VertexArena::allocate(const void * vertices,
+                                             size_t vertexCount,
+                                             const uint32_t * indices,
+                                             size_t indexCount) {
+        vector<uint32_t> sequential;
+        if (!indices || indexCount == 0) {
+            sequential.resize(vertexCount);
+            std::iota(sequential.begin(), sequential.end(), 0);
+            indices = sequential.data();
+            indexCount = vertexCount;
+        }
+
+        GLuint oldVertexBuffer = vertexBuffer;
+        GLuint oldIndexBuffer = indexBuffer;
+
+        Range range;
+        range.vertexCount = vertexCount;
+        range.indexCount = indexCount;
+        size_t stride = VertexFormat::getStride(type);
+        range.firstVertex = allocate(this->vertices, vertexBuffer, stride,
+                                     vertexCount);
+        range.firstIndex = allocate(this->indices, indexBuffer,
+                                    sizeof(uint32_t), indexCount);
+
+        if (vertexBuffer != oldVertexBuffer || indexBuffer != oldIndexBuffer) {
+            attachBuffers();
+            generation++;
+        }
+
+        // Written through the copy target so the element buffer binding of
+        // the current vertex array is left alone
+        glBindBuffer(GL_COPY_WRITE_BUFFER, vertexBuffer);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, range.firstVertex * stride,
+                        vertexCount * stride, vertices);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, indexBuffer);
+        glBufferSubData(GL_COPY_WRITE_BUFFER,
+                        range.firstIndex * sizeof(uint32_t),
+                        indexCount * sizeof(uint32_t), indices);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        return range;
+    }
+
+    void VertexArena::release(const Range & range) {
+        vertices.release(range.firstVertex, range.vertexCount);
+        indices.release(range.firstIndex, range.indexCount);
+    }
+
+    GLuint VertexArena::getVertexArray() const {
+        return vertexArray;
+    }
+
+    GLuint VertexArena::getVertexBuffer() const {
+        return vertexBuffer;
+    }
+
+    GLuint VertexArena::getIndexBuffer() const {
+        return indexBuffer;
+    }
+
+    uint64_t VertexArena::getGeneration() const {
+        return generation;
+    }
+
+    size_t VertexArena::getVertexCapacity() const {
+        return vertices.getCapacity();
+    }
+
+    size_t VertexArena::getIndexCapacity() const {
+        return indices.getCapacity();
+    }
+}
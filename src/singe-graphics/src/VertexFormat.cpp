@@ -0,0 +1,210 @@
+#include "singe/Graphics/VertexFormat.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "singe/Graphics/Mesh.hpp"
+
+namespace singe {
+    namespace {
+        struct PackedVertex {
+            float pos[3];
+            uint32_t norm;
+            uint16_t uv[2];
+        };
+
+        struct QuantizedVertex {
+            uint16_t pos[4];
+            uint32_t norm;
+            uint16_t uv[2];
+        };
+
+        static_assert(sizeof(PackedVertex) == 20);
+        static_assert(sizeof(QuantizedVertex) == 16);
+
+        uint16_t toUnorm16(float value) {
+            value = std::clamp(value, 0.0f, 1.0f);
+            return uint16_t(std::lround(value * 65535.0f));
+        }
+    }
+
+    VertexFormat::VertexFormat(Type type)
+        : type(type), offset(0.0f), scale(1.0f) {}
+
+    VertexFormat::VertexFormat(Type type, const AABB & bounds)
+        : VertexFormat(type) {
+        if (type != Quantized || bounds.isEmpty() || bounds.isInfinite())
+            return;
+
+        vec3 size = bounds.max - bounds.min;
+        float extent = std::max(size.x, std::max(size.y, size.z));
+        offset = bounds.min;
+        scale = extent > 0.0f ? extent : 1.0f;
+    }
+
+    VertexFormat::Type VertexFormat::getType() const {
+        return type;
+    }
+
+    size_t VertexFormat::getStride() const {
+        return getStride(type);
+    }
+
+    size_t VertexFormat::getStride(Type type) {
+        switch (type) {
+            case Packed:
+                return sizeof(PackedVertex);
+            case Quantized:
+                return sizeof(QuantizedVertex);
+            default:
+                return sizeof(Vertex);
+        }
+    }
+
+    bool VertexFormat::isQuantized() const {
+        return type == Quantized;
+    }
+
+    bool VertexFormat::contains(const vec3 & pos) const {
+        if (type != Quantized)
+            return true;
+        for (int i = 0; i < 3; i++) {
+            if (pos[i] < offset[i] || pos[i] > offset[i] + scale)
+                return false;
+        }
+        return true;
+    }
+
+    mat4 VertexFormat::getDecode() const {
+        mat4 decode(1.0f);
+        if (type != Quantized)
+            return decode;
+        decode[0][0] = decode[1][1] = decode[2][2] = scale;
+        decode[3] = glm::vec4(offset, 1.0f);
+        return decode;
+    }
+
+    uint16_t VertexFormat::toHalf(float value) {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+
+        uint32_t sign = (bits >> 16) & 0x8000;
+        uint32_t biased = (bits >> 23) & 0xff;
+        uint32_t mantissa = bits & 0x7fffff;
+        if (biased == 0xff)
+            return sign | 0x7c00 | (mantissa ? 0x200 : 0);
+
+        int exponent = int(biased) - 127 + 15;
+        if (exponent >= 31)
+            return sign | 0x7c00;
+        if (exponent <= 0) {
+            // Denormal half
+            if (exponent < -10)
+                return sign;
+            mantissa |= 0x800000;
+            int shift = 14 - exponent;
+            uint32_t half = mantissa >> shift;
+            if ((mantissa >> (shift - 1)) & 1)
+                half++;
+            return sign | half;
+        }
+
+        // A carry out of the mantissa correctly bumps the exponent
+        uint32_t half = sign | (uint32_t(exponent) << 10)
+                      | (mantissa >> 13);
+        if (mantissa & 0x1000)
+            half++;
+        return half;
+    }
+
+    uint32_t VertexFormat::packNormal(const vec3 & norm) {
+        uint32_t packed = 0;
+        for (int i = 0; i < 3; i++) {
+            float value = std::clamp(norm[i], -1.0f, 1.0f);
+            int32_t snorm = int32_t(std::lround(value * 511.0f));
+            packed |= (uint32_t(snorm) & 0x3ff) << (i * 10);
+        }
+        return packed;
+    }
+
+    void VertexFormat::encode(const Vertex * vertices,
+                              size_t count,
+                              void * out) const {
+        if (type == Float) {
+            std::memcpy(out, vertices, count * sizeof(Vertex));
+            return;
+        }
+
+        if (type == Packed) {
+            auto * packed = static_cast<PackedVertex *>(out);
+            for (size_t i = 0; i < count; i++) {
+                auto & vertex = vertices[i];
+                packed[i].pos[0] = vertex.pos.x;
+                packed[i].pos[1] = vertex.pos.y;
+                packed[i].pos[2] = vertex.pos.z;
+                packed[i].norm = packNormal(vertex.norm);
+                packed[i].uv[0] = toHalf(vertex.uv.x);
+                packed[i].uv[1] = toHalf(vertex.uv.y);
+            }
+            return;
+        }
+
+        auto * quantized = static_cast<QuantizedVertex *>(out);
+        for (size_t i = 0; i < count; i++) {
+            auto & vertex = vertices[i];
+            vec3 pos = (vertex.pos - offset) / scale;
+            quantized[i].pos[0] = toUnorm16(pos.x);
+            quantized[i].pos[1] = toUnorm16(pos.y);
+            quantized[i].pos[2] = toUnorm16(pos.z);
+            quantized[i].pos[3] = 0;
+            quantized[i].norm = packNormal(vertex.norm);
+            quantized[i].uv[0] = toHalf(vertex.uv.x);
+            quantized[i].uv[1] = toHalf(vertex.uv.y);
+        }
+    }
+
+    void VertexFormat::attach(Type type, size_t base) {
+        GLsizei stride = GLsizei(getStride(type));
+
+        glEnableVertexAttribArray(Mesh::PositionAttribute);
+        glEnableVertexAttribArray(Mesh::NormalAttribute);
+        glEnableVertexAttribArray(Mesh::TexCoordAttribute);
+
+        if (type == Float) {
+            glVertexAttribPointer(Mesh::PositionAttribute, 3, GL_FLOAT,
+                                  GL_FALSE, stride,
+                                  (void *)(base + offsetof(Vertex, pos)));
+            glVertexAttribPointer(Mesh::NormalAttribute, 3, GL_FLOAT,
+                                  GL_FALSE, stride,
+                                  (void *)(base + offsetof(Vertex, norm)));
+            glVertexAttribPointer(Mesh::TexCoordAttribute, 2, GL_FLOAT,
+                                  GL_FALSE, stride,
+                                  (void *)(base + offsetof(Vertex, uv)));
+            return;
+        }
+
+        if (type == Packed) {
+            glVertexAttribPointer(
+                Mesh::PositionAttribute, 3, GL_FLOAT, GL_FALSE, stride,
+                (void *)(base + offsetof(PackedVertex, pos)));
+            glVertexAttribPointer(
+                Mesh::NormalAttribute, 4, GL_INT_2_10_10_10_REV, GL_TRUE,
+                stride, (void *)(base + offsetof(PackedVertex, norm)));
+            glVertexAttribPointer(
+                Mesh::TexCoordAttribute, 2, GL_HALF_FLOAT, GL_FALSE, stride,
+                (void *)(base + offsetof(PackedVertex, uv)));
+            return;
+        }
+
+        glVertexAttribPointer(
+            Mesh::PositionAttribute, 3, GL_UNSIGNED_SHORT, GL_TRUE, stride,
+            (void *)(base + offsetof(QuantizedVertex, pos)));
+        glVertexAttribPointer(
+            Mesh::NormalAttribute, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride,
+            (void *)(base + offsetof(QuantizedVertex, norm)));
+        glVertexAttribPointer(
+            Mesh::TexCoordAttribute, 2, GL_HALF_FLOAT, GL_FALSE, stride,
+            (void *)(base + offsetof(QuantizedVertex, uv)));
+    }
+}
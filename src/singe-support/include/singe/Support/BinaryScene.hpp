@@ -0,0 +1,230 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string_view>
+
+#include "CacheFile.hpp"
+#include "MappedFile.hpp"
+#include "SceneParser.hpp"
+
+namespace singe::scene {
+    namespace fs = std::filesystem;
+
+    /**
+     * Compact binary form of a Scene file.
+     *
+     * The file holds a header, a string table and one flat array of records
+     * for each of scenes, cameras, shaders, shader sources, uniforms, shader
+     * defines and models. Scene records are in depth first order and refer
+     * to their parent by index, every other record refers to strings and
+     * records by index. Transforms are stored as raw floats.
+     *
+     * Loading maps the file into memory and uses the tables in place, so
+     * load time depends only on the file size. BinaryScene::toScene() builds
+     * the Scene tree in a single pass over the tables.
+     *
+     * The header holds the size, modification time and hash of the XML file
+     * it was converted from, see BinaryScene::isCurrent().
+     */
+    class BinaryScene {
+    public:
+        using Ptr = shared_ptr<BinaryScene>;
+        using ConstPtr = const shared_ptr<BinaryScene>;
+
+        /// Version of the binary scene format
+        static constexpr uint32_t Version = 3;
+
+        /// Offset and size of a string in the string table
+        struct String {
+            uint32_t offset;
+            uint32_t size;
+        };
+
+        /// First index and number of records in a table
+        struct Range {
+            uint32_t first;
+            uint32_t count;
+        };
+
+        struct SceneRecord {
+            /// Index of the parent scene or -1 for the root
+            int32_t parent;
+            String name;
+            /// Position, rotation and scale
+            float transform[9];
+            int32_t hasGrid;
+            int32_t gridSize;
+            float gridColor[4];
+            Range cameras;
+            /// Shaders declared by this scene
+            Range shaders;
+            Range models;
+        };
+
+        struct CameraRecord {
+            String name;
+            /// Position and rotation
+            float pose[6];
+            uint32_t mode;
+            float fov;
+            float near;
+            float far;
+        };
+
+        struct ShaderRecord {
+            String name;
+            String type;
+            Range sources;
+            Range uniforms;
+            /// Range in the defines table
+            Range defines;
+        };
+
+        struct SourceRecord {
+            String type;
+            String path;
+        };
+
+        struct UniformRecord {
+            String name;
+            uint32_t type;
+            String value;
+        };
+
+        struct ModelRecord {
+            String name;
+            String mesh;
+            /// Index into the shader table
+            uint32_t shader;
+            /// Position, rotation and scale
+            float transform[9];
+        };
+
+        /**
+         * Read only view of a table in the mapped file.
+         */
+        template<typename T>
+        struct Table {
+            const T * data = nullptr;
+            size_t size = 0;
+
+            const T & operator[](size_t i) const {
+                return data[i];
+            }
+
+            const T * begin() const {
+                return data;
+            }
+
+            const T * end() const {
+                return data + size;
+            }
+
+            bool contains(const Range & range) const {
+                return range.first <= size && range.count <= size - range.first;
+            }
+        };
+
+        Table<SceneRecord> scenes;
+        Table<CameraRecord> cameras;
+        Table<ShaderRecord> shaders;
+        Table<SourceRecord> sources;
+        Table<UniformRecord> uniforms;
+        /// Names of the shader defines
+        Table<String> defines;
+        Table<ModelRecord> models;
+
+    private:
+        MappedFile file;
+        const char * strings;
+        size_t stringsSize;
+        SourceStamp source;
+        /// Path the scene was loaded from
+        fs::path path;
+
+    public:
+        BinaryScene();
+
+        /// @brief  Move constructor
+        BinaryScene(BinaryScene && other);
+
+        /// @brief  Move assignment
+        BinaryScene & operator=(BinaryScene && other);
+
+        BinaryScene(const BinaryScene &) = delete;
+        BinaryScene & operator=(const BinaryScene &) = delete;
+
+        ~BinaryScene();
+
+        /**
+         * Map a binary scene file.
+         *
+         * @param path the path to the binary scene
+         *
+         * @return false if the file is missing, not a binary scene or the
+         *         tables are out of range
+         */
+        bool load(const fs::path & path);
+
+        /**
+         * Was this scene converted from source as it is now. The size and
+         * modification time of source are compared, and the content if only
+         * the time changed, see checkSources(). Changes to files the scene
+         * refers to are not detected.
+         *
+         * @param source the path to the XML scene
+         *
+         * @return true if source has not changed since conversion
+         */
+        bool isCurrent(const fs::path & source) const;
+
+        /**
+         * Get a string from the string table.
+         *
+         * @param string the String reference
+         *
+         * @return view into the mapped file, empty if string is out of range
+         */
+        std::string_view getString(const String & string) const;
+
+        /**
+         * Build the Scene tree from the tables.
+         *
+         * @return the root Scene
+         *
+         * @throws SceneParseError if a record refers to a record that does not
+         *         exist
+         */
+        shared_ptr<Scene> toScene() const;
+
+        /**
+         * Write scene to a binary scene file. Parent directories are created
+         * if they do not exist.
+         *
+         * @param scene the root Scene
+         * @param path the path to write the binary scene to
+         * @param source the XML file scene was parsed from, used by
+         *               BinaryScene::isCurrent(), may be empty
+         *
+         * @return false if the file could not be written
+         */
+        static bool write(const Scene & scene,
+                          const fs::path & path,
+                          const fs::path & source = {});
+
+        /**
+         * Parse an XML scene and write it as a binary scene.
+         *
+         * @param source the path to the XML scene
+         * @param path the path to write the binary scene to
+         *
+         * @return false if the file could not be written
+         *
+         * @throws SceneParseError if the XML scene is invalid
+         */
+        static bool convert(const fs::path & source, const fs::path & path);
+    };
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+namespace singe {
+    using std::vector;
+
+    namespace fs = std::filesystem;
+
+    /**
+     * Identifies the content of the files a cache file was made from. It is
+     * stored in the header of the cache file and checked with
+     * checkSources() before the cache file is used.
+     */
+    struct SourceStamp {
+        /// Sum of the file sizes
+        uint64_t size;
+        /// Sum of the modification times
+        int64_t time;
+        /// Hash of the file contents, see hashBytes()
+        uint64_t hash;
+    };
+
+    /**
+     * Hash bytes with FNV-1a. This is only meant to detect changes, not to
+     * resist collisions on purpose.
+     *
+     * @param data the bytes to hash
+     * @param size the number of bytes
+     * @param hash the hash of the bytes before data, to hash in parts
+     *
+     * @return the hash
+     */
+    uint64_t hashBytes(const void * data,
+                       size_t size,
+                       uint64_t hash = 14695981039346656037ull);
+
+    /**
+     * Stamp the files a cache file is made from.
+     *
+     * @param files the source files, in a fixed order
+     * @param stamp set to the stamp of files
+     *
+     * @return false if a file can not be read
+     */
+    bool stampSources(const vector<fs::path> & files, SourceStamp & stamp);
+
+    /**
+     * Is a cache file current for the files it was made from.
+     *
+     * The sizes must match. If only the modification time changed, the files
+     * are hashed and compared instead and the time in the cache file is
+     * updated, so the files are not hashed again next time.
+     *
+     * @param cached the cache file, empty to not update the time
+     * @param offset the byte offset of the SourceStamp in cached
+     * @param stamp the SourceStamp read from cached
+     * @param files the source files, in the same order as when stamped
+     *
+     * @return true if the files have the same content
+     */
+    bool checkSources(const fs::path & cached,
+                      size_t offset,
+                      const SourceStamp & stamp,
+                      const vector<fs::path> & files);
+
+    /**
+     * Get a path next to path to write a file to before it is renamed to
+     * path. The name includes the process, the thread and a counter, so
+     * workers that write the same cache file at the same time never share a
+     * temporary file.
+     *
+     * @param path the final path of the file
+     *
+     * @return a path in the same directory that is not used by any other
+     *         call
+     */
+    fs::path uniqueTempPath(const fs::path & path);
+
+    /**
+     * Write a cache file. The data is written to uniqueTempPath() and then
+     * renamed to path, so a partial file is never loaded. Parent directories
+     * are created if they do not exist.
+     *
+     * @param path the path of the cache file
+     * @param data the file content
+     * @param size the number of bytes
+     *
+     * @return false if the file could not be written
+     */
+    bool writeCacheFile(const fs::path & path, const void * data, size_t size);
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace singe {
+    using std::vector;
+
+    /**
+     * First fit free list over a buffer measured in elements.
+     *
+     * Free blocks are kept sorted by offset and neighbouring blocks are
+     * merged when space is released, so releasing everything that was
+     * allocated leaves one block covering the whole capacity.
+     */
+    class FreeList {
+        struct Block {
+            size_t offset;
+            size_t size;
+        };
+
+        vector<Block> blocks;
+        size_t capacity;
+
+    public:
+        /**
+         * Create a FreeList with all of it's capacity free.
+         *
+         * @param capacity the number of elements
+         */
+        FreeList(size_t capacity);
+
+        /**
+         * Get the number of elements the list covers.
+         *
+         * @return the capacity
+         */
+        size_t getCapacity() const;
+
+        /**
+         * Take space from the first free block that is large enough.
+         *
+         * @param size the number of elements
+         * @param offset set to the first element of the space
+         *
+         * @return false if no free block is large enough
+         */
+        bool allocate(size_t size, size_t & offset);
+
+        /**
+         * Free space returned by FreeList::allocate().
+         *
+         * @param offset the first element of the space
+         * @param size the number of elements
+         */
+        void release(size_t offset, size_t size);
+
+        /**
+         * Extend the list, the new elements are free.
+         *
+         * @param capacity the new capacity, at least the current capacity
+         */
+        void grow(size_t capacity);
+    };
+}
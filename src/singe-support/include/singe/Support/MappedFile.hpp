@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+namespace singe {
+    using std::shared_ptr;
+
+    namespace fs = std::filesystem;
+
+    /**
+     * Read only memory mapped file.
+     *
+     * On platforms without mmap the file is read into memory instead, the
+     * interface is the same.
+     */
+    class MappedFile {
+    public:
+        using Ptr = shared_ptr<MappedFile>;
+        using ConstPtr = const shared_ptr<MappedFile>;
+
+    private:
+        const uint8_t * m_data;
+        size_t m_size;
+        std::vector<uint8_t> m_buffer;
+
+        void close();
+
+    public:
+        /**
+         * Create a MappedFile that is not open.
+         */
+        MappedFile();
+
+        /**
+         * Map the file at path. Use MappedFile::isOpen() to check if the file
+         * was mapped.
+         *
+         * @param path the file to map
+         */
+        MappedFile(const fs::path & path);
+
+        /// @brief  Move constructor
+        MappedFile(MappedFile && other);
+
+        /// @brief  Move assignment
+        MappedFile & operator=(MappedFile && other);
+
+        MappedFile(const MappedFile &) = delete;
+        MappedFile & operator=(const MappedFile &) = delete;
+
+        /**
+         * Unmap the file.
+         */
+        ~MappedFile();
+
+        /**
+         * Was the file opened and mapped. An empty file is not open.
+         *
+         * @return is the file mapped
+         */
+        bool isOpen() const;
+
+        /**
+         * Get a pointer to the start of the file.
+         *
+         * @return the file contents or nullptr if not open
+         */
+        const uint8_t * data() const;
+
+        /**
+         * Get the size of the file.
+         *
+         * @return the size in bytes or 0 if not open
+         */
+        size_t size() const;
+    };
+}
@@ -6,6 +6,7 @@
 #include <memory>
 #include <stdexcept>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace singe::scene {
@@ -106,8 +107,11 @@ namespace singe::scene {
         string type;
         vector<Source> source;
         vector<Uniform> uniforms;
+        /// Preprocessor keys that select a variant of the sources
+        vector<string> defines;
 
-        Shader(const string & name, const string & type) : name(name) {}
+        Shader(const string & name, const string & type)
+            : name(name), type(type) {}
     };
 
     struct Model {
@@ -120,11 +124,13 @@ namespace singe::scene {
         string name;
         Transform transform;
         Mesh mesh;
-        Shader shader;
+        /// Shared with the scene that declared it and every model that refers
+        /// to it
+        shared_ptr<Shader> shader;
 
         Model(const string & name,
               const Mesh & mesh,
-              const Shader & shader,
+              const shared_ptr<Shader> & shader,
               const Transform & transform = Transform())
             : name(name), mesh(mesh), shader(shader), transform(transform) {}
     };
@@ -143,17 +149,84 @@ namespace singe::scene {
         Transform transform;
         shared_ptr<Grid> grid;
         vector<Camera> cameras;
-        vector<Shader> shaders;
+        vector<shared_ptr<Shader>> shaders;
+        /// First shader in shaders with each name, filled by addShader()
+        std::unordered_map<string, shared_ptr<Shader>> shaderLookup;
         vector<Model> models;
         vector<shared_ptr<Scene>> children;
 
-        /// Find a shader by ref name
-        Shader & findShader(const string & name);
+        /**
+         * Declare a shader in this scene.
+         *
+         * @param shader the Shader to add to shaders
+         */
+        void addShader(const shared_ptr<Shader> & shader);
+
+        /**
+         * Find a shader by ref name in this scene or the closest parent that
+         * declares it.
+         *
+         * @param name the shader name
+         *
+         * @return the Shader or nullptr if no scene declares name
+         */
+        shared_ptr<Shader> findShader(const string & name) const;
 
         Scene(const shared_ptr<Scene> & parent, const string & name)
             : parent(parent), name(name) {}
     };
 
+    /**
+     * Receives the parts of a scene while it is being parsed.
+     *
+     * A Scene is passed to onScene() as soon as it's start tag is read and is
+     * filled in as the file is read, it is only complete when passed to
+     * onSceneEnd(). A model held back for a shader declared later can be
+     * passed to onModel() after the end tag of it's scene, onSceneEnd() is
+     * then called once it has been added, after onSceneEnd() of the
+     * children.
+     */
+    class SceneHandler {
+    public:
+        virtual ~SceneHandler() {}
+
+        /**
+         * Called when the start tag of a scene has been read.
+         *
+         * @param scene the new Scene, already added to it's parent
+         */
+        virtual void onScene(const shared_ptr<Scene> &) {}
+
+        /**
+         * Called when a model has been read.
+         *
+         * @param scene the Scene the model belongs to
+         * @param model the parsed Model
+         *
+         * @return false to leave the model out of scene
+         */
+        virtual bool onModel(Scene &, const Model &) {
+            return true;
+        }
+
+        /**
+         * Called when the end tag of a scene has been read.
+         *
+         * @param scene the complete Scene
+         */
+        virtual void onSceneEnd(const shared_ptr<Scene> &) {}
+    };
+
+    /**
+     * Parses scene files one element at a time.
+     *
+     * The file is read in chunks and only the element being parsed is held
+     * in memory, so the memory used while parsing does not depend on the
+     * size of the file. A ref is resolved as if all shaders of a scene came
+     * before it's models and children, the closest scene declaring the name
+     * wins. A model whose shader is not declared earlier in it's own scene
+     * is held back until it can be resolved.
+     */
     class SceneParser {
     public:
         SceneParser();
@@ -161,5 +234,31 @@ namespace singe::scene {
         shared_ptr<Scene> parse(const string & filename);
 
         shared_ptr<Scene> parse(istream & stream);
+
+        /**
+         * Parse a scene file, passing each part to handler as it is read.
+         *
+         * @param filename the path to the scene file
+         * @param handler the SceneHandler to notify
+         *
+         * @return the root Scene
+         *
+         * @throws SceneParseError if the file can not be opened or is invalid
+         */
+        shared_ptr<Scene> parse(const string & filename,
+                                SceneHandler & handler);
+
+        /**
+         * Parse a scene from stream, passing each part to handler as it is
+         * read.
+         *
+         * @param stream the stream to read from
+         * @param handler the SceneHandler to notify
+         *
+         * @return the root Scene
+         *
+         * @throws SceneParseError if the scene is invalid
+         */
+        shared_ptr<Scene> parse(istream & stream, SceneHandler & handler);
     };
 }
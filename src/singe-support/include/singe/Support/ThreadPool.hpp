@@ -0,0 +1,91 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace singe {
+    using std::shared_ptr;
+
+    /**
+     * Fixed size pool of worker threads that run submitted jobs in order.
+     *
+     * Jobs must not call OpenGL, there is no context on the worker threads.
+     */
+    class ThreadPool {
+    public:
+        using Ptr = shared_ptr<ThreadPool>;
+        using ConstPtr = const shared_ptr<ThreadPool>;
+
+    private:
+        std::vector<std::thread> workers;
+        std::queue<std::function<void()>> jobs;
+        std::mutex mutex;
+        std::condition_variable condition;
+        bool stopping;
+
+        void work();
+
+    public:
+        /**
+         * Create a ThreadPool and start it's worker threads.
+         *
+         * @param threads the number of workers, 0 to use the number of
+         *                hardware threads
+         */
+        ThreadPool(size_t threads = 0);
+
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool & operator=(const ThreadPool &) = delete;
+
+        /**
+         * Finish all queued jobs and join the worker threads.
+         */
+        ~ThreadPool();
+
+        /**
+         * Get the number of worker threads.
+         *
+         * @return the number of workers
+         */
+        size_t size() const;
+
+        /**
+         * Is the calling thread one of the workers of this pool. A job that
+         * waits for other jobs of the same pool can deadlock, so it should
+         * run them itself instead.
+         *
+         * @return true if called from a job of this pool
+         */
+        bool isWorker() const;
+
+        /**
+         * Queue a job to run on a worker thread.
+         *
+         * Any exception thrown by job is re-thrown by the future's get().
+         *
+         * @param job the callable to run
+         *
+         * @return future for the result of job
+         */
+        template<typename Job>
+        auto submit(Job && job) -> std::future<std::invoke_result_t<Job>> {
+            using Result = std::invoke_result_t<Job>;
+            auto task = std::make_shared<std::packaged_task<Result()>>(
+                std::forward<Job>(job));
+            auto future = task->get_future();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                jobs.emplace([task]() { (*task)(); });
+            }
+            condition.notify_one();
+            return future;
+        }
+    };
+}
@@ -1,8 +1,20 @@
 #pragma once
 
+#include <cstddef>
 #include <string>
+#include <string_view>
 #include <vector>
 
+/**
+ * Round value up to a multiple of alignment.
+ *
+ * @param value the value to round
+ * @param alignment the alignment, not 0
+ *
+ * @return the aligned value
+ */
+size_t alignUp(size_t value, size_t alignment);
+
 /**
  * Split a string based on a delimeter.
  *
@@ -25,3 +37,55 @@ public:
 
     std::string next();
 };
+
+/**
+ * Parse a number from the start of text with std::from_chars. Leading
+ * whitespace and a leading + are skipped, trailing characters are ignored.
+ *
+ * @param text the text to parse
+ * @param value set to the parsed number
+ *
+ * @return false if text does not start with a number
+ */
+bool parseNumber(std::string_view text, float & value);
+
+/// @copydoc parseNumber(std::string_view, float &)
+bool parseNumber(std::string_view text, int & value);
+
+/**
+ * Split text into tokens separated by whitespace without copying or
+ * allocating. Each token is a view into text, so text must outlive the
+ * TokenView.
+ */
+class TokenView {
+    std::string_view text;
+
+public:
+    TokenView(std::string_view text);
+
+    /**
+     * Is there another token.
+     *
+     * @return false if only whitespace is left
+     */
+    bool hasNext() const;
+
+    /**
+     * Get the next token.
+     *
+     * @return the token or an empty view if there are none left
+     */
+    std::string_view next();
+
+    /**
+     * Parse the next token as a number.
+     *
+     * @param value set to the parsed number
+     *
+     * @return false if there are no tokens left or it is not a number
+     */
+    bool nextNumber(float & value);
+
+    /// @copydoc nextNumber(float &)
+    bool nextNumber(int & value);
+};
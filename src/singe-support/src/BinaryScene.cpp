@@ -0,0 +1,415 @@
+#include "singe/Support/BinaryScene.hpp"
+
+#include <cstring>
+#include <map>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "singe/Support/CacheFile.hpp"
+#include "singe/Support/Util.hpp"
+#include "singe/Support/log.hpp"
+
+namespace singe::scene {
+    using std::make_shared;
+    using std::move;
+    using std::string_view;
+
+    namespace {
+        constexpr char Magic[4] = {'S', 'G', 'S', 'C'};
+        constexpr size_t TableAlignment = 8;
+
+        struct TableRef {
+            uint64_t offset;
+            uint64_t count;
+        };
+
+        struct FileHeader {
+            char magic[4];
+            uint32_t version;
+            SourceStamp source;
+            TableRef strings;
+            TableRef scenes;
+            TableRef cameras;
+            TableRef shaders;
+            TableRef sources;
+            TableRef uniforms;
+            TableRef defines;
+            TableRef models;
+        };
+
+        using String = BinaryScene::String;
+        using Range = BinaryScene::Range;
+
+        void writeTransform(float * out, const Transform & transform) {
+            const vec3 * parts[] = {&transform.pos, &transform.rot,
+                                    &transform.scale};
+            for (size_t i = 0; i < 3; i++) {
+                for (size_t j = 0; j < 3; j++) out[i * 3 + j] = (*parts[i])[j];
+            }
+        }
+
+        Transform readTransform(const float * in) {
+            return Transform(vec3(in[0], in[1], in[2]),
+                             vec3(in[3], in[4], in[5]),
+                             vec3(in[6], in[7], in[8]));
+        }
+
+        /// Flattens a Scene tree into the record tables
+        class Builder {
+        public:
+            vector<char> strings;
+            vector<BinaryScene::SceneRecord> scenes;
+            vector<BinaryScene::CameraRecord> cameras;
+            vector<BinaryScene::ShaderRecord> shaders;
+            vector<BinaryScene::SourceRecord> sources;
+            vector<BinaryScene::UniformRecord> uniforms;
+            vector<String> defines;
+            vector<BinaryScene::ModelRecord> models;
+
+        private:
+            std::map<string, String> stringLookup;
+            /// First shader record made from each shader
+            std::unordered_map<const Shader *, uint32_t> shaderLookup;
+
+            String addString(const string & value) {
+                auto [it, inserted] = stringLookup.try_emplace(value);
+                if (inserted) {
+                    it->second = {uint32_t(strings.size()),
+                                  uint32_t(value.size())};
+                    strings.insert(strings.end(), value.begin(), value.end());
+                }
+                return it->second;
+            }
+
+            uint32_t addShader(const Shader & shader) {
+                BinaryScene::ShaderRecord record;
+                record.name = addString(shader.name);
+                record.type = addString(shader.type);
+
+                record.sources = {uint32_t(sources.size()),
+                                  uint32_t(shader.source.size())};
+                for (auto & source : shader.source)
+                    sources.push_back(
+                        {addString(source.type), addString(source.path)});
+
+                record.uniforms = {uint32_t(uniforms.size()),
+                                   uint32_t(shader.uniforms.size())};
+                for (auto & uniform : shader.uniforms)
+                    uniforms.push_back({addString(uniform.name),
+                                        uint32_t(uniform.type),
+                                        addString(uniform.value)});
+
+                record.defines = {uint32_t(defines.size()),
+                                  uint32_t(shader.defines.size())};
+                for (auto & define : shader.defines)
+                    defines.push_back(addString(define));
+
+                shaders.push_back(record);
+                shaderLookup.try_emplace(&shader, shaders.size() - 1);
+                return shaders.size() - 1;
+            }
+
+            /// Find the record of a shader that has already been added
+            uint32_t findShader(const Shader & shader) {
+                auto it = shaderLookup.find(&shader);
+                if (it != shaderLookup.end())
+                    return it->second;
+                // The model declared it's own shader
+                return addShader(shader);
+            }
+
+        public:
+            void addScene(const Scene & scene, int32_t parent) {
+                int32_t index = scenes.size();
+                BinaryScene::SceneRecord record {};
+                record.parent = parent;
+                record.name = addString(scene.name);
+                writeTransform(record.transform, scene.transform);
+                if (scene.grid) {
+                    record.hasGrid = 1;
+                    record.gridSize = scene.grid->size;
+                    for (int i = 0; i < 4; i++)
+                        record.gridColor[i] = scene.grid->color[i];
+                }
+
+                record.cameras = {uint32_t(cameras.size()),
+                                  uint32_t(scene.cameras.size())};
+                for (auto & camera : scene.cameras) {
+                    BinaryScene::CameraRecord cameraRecord;
+                    cameraRecord.name = addString(camera.name);
+                    for (int i = 0; i < 3; i++) {
+                        cameraRecord.pose[i] = camera.pose.pos[i];
+                        cameraRecord.pose[i + 3] = camera.pose.rot[i];
+                    }
+                    cameraRecord.mode = camera.projection.mode;
+                    cameraRecord.fov = camera.projection.fov;
+                    cameraRecord.near = camera.projection.near;
+                    cameraRecord.far = camera.projection.far;
+                    cameras.push_back(cameraRecord);
+                }
+
+                // Declared shaders are added first so the range is contiguous
+                record.shaders = {uint32_t(shaders.size()),
+                                  uint32_t(scene.shaders.size())};
+                for (auto & shader : scene.shaders) addShader(*shader);
+
+                scenes.push_back(record);
+
+                uint32_t firstModel = models.size();
+                for (auto & model : scene.models) {
+                    BinaryScene::ModelRecord modelRecord;
+                    modelRecord.name = addString(model.name);
+                    modelRecord.mesh = addString(model.mesh.path);
+                    modelRecord.shader = findShader(*model.shader);
+                    writeTransform(modelRecord.transform, model.transform);
+                    models.push_back(modelRecord);
+                }
+                scenes[index].models = {firstModel,
+                                        uint32_t(scene.models.size())};
+
+                for (auto & child : scene.children) addScene(*child, index);
+            }
+        };
+
+        template<typename T>
+        TableRef appendTable(vector<uint8_t> & out, const vector<T> & table) {
+            static_assert(std::is_trivially_copyable_v<T>);
+            out.resize(alignUp(out.size(), TableAlignment), 0);
+            TableRef ref {out.size(), table.size()};
+            auto * bytes = reinterpret_cast<const uint8_t *>(table.data());
+            out.insert(out.end(), bytes, bytes + table.size() * sizeof(T));
+            return ref;
+        }
+
+        template<typename T>
+        bool mapTable(const MappedFile & file,
+                      const TableRef & ref,
+                      BinaryScene::Table<T> & table) {
+            if (ref.offset % alignof(T) != 0 || ref.offset > file.size()
+                || ref.count > (file.size() - ref.offset) / sizeof(T))
+                return false;
+            table.data = reinterpret_cast<const T *>(file.data() + ref.offset);
+            table.size = ref.count;
+            return true;
+        }
+    }
+
+    BinaryScene::BinaryScene()
+        : strings(nullptr), stringsSize(0), source {} {}
+
+    BinaryScene::BinaryScene(BinaryScene && other)
+        : scenes(other.scenes),
+          cameras(other.cameras),
+          shaders(other.shaders),
+          sources(other.sources),
+          uniforms(other.uniforms),
+          defines(other.defines),
+          models(other.models),
+          file(move(other.file)),
+          strings(other.strings),
+          stringsSize(other.stringsSize),
+          source(other.source),
+          path(move(other.path)) {}
+
+    BinaryScene & BinaryScene::operator=(BinaryScene && other) {
+        scenes = other.scenes;
+        cameras = other.cameras;
+        shaders = other.shaders;
+        sources = other.sources;
+        uniforms = other.uniforms;
+        defines = other.defines;
+        models = other.models;
+        file = move(other.file);
+        strings = other.strings;
+        stringsSize = other.stringsSize;
+        source = other.source;
+        path = move(other.path);
+        return *this;
+    }
+
+    BinaryScene::~BinaryScene() {}
+
+    bool BinaryScene::load(const fs::path & path) {
+        MappedFile mapped(path);
+        if (!mapped.isOpen() || mapped.size() < sizeof(FileHeader))
+            return false;
+
+        FileHeader header;
+        std::memcpy(&header, mapped.data(), sizeof(header));
+        if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0)
+            return false;
+        if (header.version != Version) {
+            Logging::Core->debug("Binary scene {} has version {}", path.c_str(),
+                                 header.version);
+            return false;
+        }
+
+        BinaryScene scene;
+        Table<char> stringTable;
+        if (!mapTable(mapped, header.strings, stringTable)
+            || !mapTable(mapped, header.scenes, scene.scenes)
+            || !mapTable(mapped, header.cameras, scene.cameras)
+            || !mapTable(mapped, header.shaders, scene.shaders)
+            || !mapTable(mapped, header.sources, scene.sources)
+            || !mapTable(mapped, header.uniforms, scene.uniforms)
+            || !mapTable(mapped, header.defines, scene.defines)
+            || !mapTable(mapped, header.models, scene.models)) {
+            Logging::Core->debug("Binary scene {} is invalid", path.c_str());
+            return false;
+        }
+
+        scene.strings = stringTable.data;
+        scene.stringsSize = stringTable.size;
+        scene.source = header.source;
+        scene.path = path;
+        scene.file = move(mapped);
+        *this = move(scene);
+        return true;
+    }
+
+    bool BinaryScene::isCurrent(const fs::path & source) const {
+        return checkSources(path, offsetof(FileHeader, source), this->source,
+                            {source});
+    }
+
+    string_view BinaryScene::getString(const String & string) const {
+        if (string.offset > stringsSize
+            || string.size > stringsSize - string.offset)
+            return {};
+        return string_view(strings + string.offset, string.size);
+    }
+
+    shared_ptr<Scene> BinaryScene::toScene() const {
+        auto str = [this](const String & value) {
+            return string(getString(value));
+        };
+
+        // Each record is made once and shared by every model that uses it
+        vector<shared_ptr<Shader>> loaded(shaders.size);
+        auto makeShader = [&](uint32_t index) {
+            if (index >= shaders.size)
+                throw SceneParseError("Binary scene shader out of range");
+            if (loaded[index])
+                return loaded[index];
+            auto & record = shaders[index];
+            if (!sources.contains(record.sources)
+                || !uniforms.contains(record.uniforms)
+                || !defines.contains(record.defines))
+                throw SceneParseError("Binary scene shader range out of range");
+
+            auto shader =
+                make_shared<Shader>(str(record.name), str(record.type));
+            for (uint32_t i = 0; i < record.sources.count; i++) {
+                auto & source = sources[record.sources.first + i];
+                shader->source.emplace_back(str(source.type),
+                                            str(source.path));
+            }
+            for (uint32_t i = 0; i < record.uniforms.count; i++) {
+                auto & uniform = uniforms[record.uniforms.first + i];
+                shader->uniforms.emplace_back(
+                    str(uniform.name), Shader::Uniform::Type(uniform.type),
+                    str(uniform.value));
+            }
+            for (uint32_t i = 0; i < record.defines.count; i++)
+                shader->defines.push_back(
+                    str(defines[record.defines.first + i]));
+            return loaded[index] = shader;
+        };
+
+        if (scenes.size == 0)
+            throw SceneParseError("Binary scene has no scenes");
+
+        vector<shared_ptr<Scene>> nodes;
+        nodes.reserve(scenes.size);
+
+        for (size_t i = 0; i < scenes.size; i++) {
+            auto & record = scenes[i];
+
+            // Depth first order, parents always come before their children
+            shared_ptr<Scene> parent;
+            if (i > 0) {
+                if (record.parent < 0 || record.parent >= int32_t(i))
+                    throw SceneParseError("Binary scene parent out of range");
+                parent = nodes[record.parent];
+            }
+
+            if (!cameras.contains(record.cameras)
+                || !shaders.contains(record.shaders)
+                || !models.contains(record.models))
+                throw SceneParseError("Binary scene range out of range");
+
+            auto & scene = nodes.emplace_back(
+                make_shared<Scene>(parent, str(record.name)));
+            scene->transform = readTransform(record.transform);
+            if (record.hasGrid) {
+                auto & color = record.gridColor;
+                scene->grid = make_shared<Grid>(
+                    record.gridSize,
+                    vec4(color[0], color[1], color[2], color[3]));
+            }
+
+            for (uint32_t j = 0; j < record.cameras.count; j++) {
+                auto & camera = cameras[record.cameras.first + j];
+                auto & pose = camera.pose;
+                scene->cameras.emplace_back(
+                    str(camera.name),
+                    Camera::Projection(camera.fov, camera.near, camera.far,
+                                       Camera::Projection::Mode(camera.mode)),
+                    Pose(vec3(pose[0], pose[1], pose[2]),
+                         vec3(pose[3], pose[4], pose[5])));
+            }
+
+            for (uint32_t j = 0; j < record.shaders.count; j++)
+                scene->addShader(makeShader(record.shaders.first + j));
+
+            for (uint32_t j = 0; j < record.models.count; j++) {
+                auto & model = models[record.models.first + j];
+                scene->models.emplace_back(str(model.name),
+                                           Model::Mesh(str(model.mesh)),
+                                           makeShader(model.shader),
+                                           readTransform(model.transform));
+            }
+
+            if (parent)
+                parent->children.push_back(scene);
+        }
+
+        return nodes.front();
+    }
+
+    bool BinaryScene::write(const Scene & scene,
+                            const fs::path & path,
+                            const fs::path & source) {
+        FileHeader header {};
+        std::memcpy(header.magic, Magic, sizeof(Magic));
+        header.version = Version;
+        if (!source.empty() && !stampSources({source}, header.source))
+            return false;
+
+        Builder builder;
+        builder.addScene(scene, -1);
+
+        vector<uint8_t> out(sizeof(FileHeader), 0);
+        header.strings = appendTable(out, builder.strings);
+        header.scenes = appendTable(out, builder.scenes);
+        header.cameras = appendTable(out, builder.cameras);
+        header.shaders = appendTable(out, builder.shaders);
+        header.sources = appendTable(out, builder.sources);
+        header.uniforms = appendTable(out, builder.uniforms);
+        header.defines = appendTable(out, builder.defines);
+        header.models = appendTable(out, builder.models);
+        std::memcpy(out.data(), &header, sizeof(header));
+
+        if (!writeCacheFile(path, out.data(), out.size()))
+            return false;
+
+        Logging::Core->debug("Wrote binary scene {}", path.c_str());
+        return true;
+    }
+
+    bool BinaryScene::convert(const fs::path & source, const fs::path & path) {
+        auto scene = SceneParser().parse(source.string());
+        return write(*scene, path, source);
+    }
+}
@@ -0,0 +1,128 @@
+#include "singe/Support/CacheFile.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <system_error>
+#include <thread>
+
+#include "singe/Support/MappedFile.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#define SINGE_CACHE_FILE_PID() ::getpid()
+#elif defined(_WIN32)
+#include <process.h>
+#define SINGE_CACHE_FILE_PID() ::_getpid()
+#else
+#define SINGE_CACHE_FILE_PID() 0
+#endif
+
+namespace singe {
+    /// Sizes and modification times, without reading the files
+    static bool statSources(const vector<fs::path> & files,
+                            SourceStamp & stamp) {
+        stamp = SourceStamp {0, 0, 0};
+        for (auto & file : files) {
+            std::error_code error;
+            stamp.size += fs::file_size(file, error);
+            if (error)
+                return false;
+            auto time = fs::last_write_time(file, error);
+            if (error)
+                return false;
+            stamp.time += time.time_since_epoch().count();
+        }
+        return true;
+    }
+
+    static uint64_t hashSources(const vector<fs::path> & files) {
+        uint64_t hash = hashBytes(nullptr, 0);
+        for (auto & path : files) {
+            MappedFile file(path);
+            hash = hashBytes(file.data(), file.size(), hash);
+        }
+        return hash;
+    }
+
+    uint64_t hashBytes(const void * data, size_t size, uint64_t hash) {
+        auto * bytes = static_cast<const uint8_t *>(data);
+        for (size_t i = 0; i < size; i++) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    bool stampSources(const vector<fs::path> & files, SourceStamp & stamp) {
+        if (!statSources(files, stamp))
+            return false;
+        stamp.hash = hashSources(files);
+        return true;
+    }
+
+    bool checkSources(const fs::path & cached,
+                      size_t offset,
+                      const SourceStamp & stamp,
+                      const vector<fs::path> & files) {
+        SourceStamp current;
+        if (!statSources(files, current) || current.size != stamp.size)
+            return false;
+        if (current.time == stamp.time)
+            return true;
+        if (hashSources(files) != stamp.hash)
+            return false;
+
+        // Same content, refresh the time so the hash is skipped next time
+        if (!cached.empty()) {
+            std::fstream patch(cached,
+                               std::ios::binary | std::ios::in | std::ios::out);
+            patch.seekp(offset + offsetof(SourceStamp, time));
+            patch.write(reinterpret_cast<const char *>(&current.time),
+                        sizeof(current.time));
+        }
+        return true;
+    }
+
+    fs::path uniqueTempPath(const fs::path & path) {
+        static std::atomic<unsigned long long> counter(0);
+
+        size_t thread =
+            std::hash<std::thread::id>()(std::this_thread::get_id());
+        char suffix[64];
+        std::snprintf(suffix, sizeof(suffix), ".%lx-%zx-%llu.tmp",
+                      static_cast<unsigned long>(SINGE_CACHE_FILE_PID()),
+                      thread, counter++);
+
+        fs::path temp = path;
+        temp += suffix;
+        return temp;
+    }
+
+    bool writeCacheFile(const fs::path & path, const void * data, size_t size) {
+        std::error_code error;
+        if (path.has_parent_path())
+            fs::create_directories(path.parent_path(), error);
+
+        fs::path temp = uniqueTempPath(path);
+        {
+            std::ofstream os(temp, std::ios::binary | std::ios::trunc);
+            if (!os.is_open())
+                return false;
+            os.write(static_cast<const char *>(data), size);
+            if (!os.good()) {
+                os.close();
+                fs::remove(temp, error);
+                return false;
+            }
+        }
+
+        fs::rename(temp, path, error);
+        if (error) {
+            fs::remove(temp, error);
+            return false;
+        }
+        return true;
+    }
+}
@@ -0,0 +1,61 @@
+#include "singe/Support/FreeList.hpp"
+
+#include <algorithm>
+
+namespace singe {
+    FreeList::FreeList(size_t capacity) : capacity(capacity) {
+        if (capacity > 0)
+            blocks.push_back({0, capacity});
+    }
+
+    size_t FreeList::getCapacity() const {
+        return capacity;
+    }
+
+    bool FreeList::allocate(size_t size, size_t & offset) {
+        for (auto it = blocks.begin(); it != blocks.end(); ++it) {
+            if (it->size < size)
+                continue;
+            offset = it->offset;
+            it->offset += size;
+            it->size -= size;
+            if (it->size == 0)
+                blocks.erase(it);
+            return true;
+        }
+        return false;
+    }
+
+    void FreeList::release(size_t offset, size_t size) {
+        if (size == 0)
+            return;
+
+        // Blocks are kept sorted so neighbours can be merged
+        auto next = std::lower_bound(
+            blocks.begin(), blocks.end(), offset,
+            [](const Block & block, size_t offset) {
+                return block.offset < offset;
+            });
+        auto it = blocks.insert(next, {offset, size});
+
+        auto following = it + 1;
+        if (following != blocks.end()
+            && it->offset + it->size == following->offset) {
+            it->size += following->size;
+            blocks.erase(following);
+        }
+        if (it != blocks.begin()) {
+            auto previous = it - 1;
+            if (previous->offset + previous->size == it->offset) {
+                previous->size += it->size;
+                blocks.erase(it);
+            }
+        }
+    }
+
+    void FreeList::grow(size_t capacity) {
+        size_t old = this->capacity;
+        this->capacity = capacity;
+        release(old, capacity - old);
+    }
+}
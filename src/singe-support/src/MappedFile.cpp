@@ -0,0 +1,91 @@
+#include "singe/Support/MappedFile.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define SINGE_MAPPED_FILE_MMAP
+#else
+#include <fstream>
+#include <iterator>
+#endif
+
+namespace singe {
+    using std::move;
+
+    MappedFile::MappedFile() : m_data(nullptr), m_size(0) {}
+
+    MappedFile::MappedFile(const fs::path & path) : MappedFile() {
+#ifdef SINGE_MAPPED_FILE_MMAP
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return;
+
+        struct stat info;
+        if (::fstat(fd, &info) == 0 && info.st_size > 0) {
+            void * data =
+                ::mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data != MAP_FAILED) {
+                m_data = static_cast<const uint8_t *>(data);
+                m_size = info.st_size;
+            }
+        }
+        ::close(fd);
+#else
+        std::ifstream is(path, std::ios::binary);
+        if (!is.is_open())
+            return;
+        m_buffer.assign(std::istreambuf_iterator<char>(is),
+                        std::istreambuf_iterator<char>());
+        if (!m_buffer.empty()) {
+            m_data = m_buffer.data();
+            m_size = m_buffer.size();
+        }
+#endif
+    }
+
+    MappedFile::MappedFile(MappedFile && other)
+        : m_data(other.m_data),
+          m_size(other.m_size),
+          m_buffer(move(other.m_buffer)) {
+        other.m_data = nullptr;
+        other.m_size = 0;
+    }
+
+    MappedFile & MappedFile::operator=(MappedFile && other) {
+        close();
+        m_data = other.m_data;
+        m_size = other.m_size;
+        m_buffer = move(other.m_buffer);
+        other.m_data = nullptr;
+        other.m_size = 0;
+        return *this;
+    }
+
+    MappedFile::~MappedFile() {
+        close();
+    }
+
+    void MappedFile::close() {
+#ifdef SINGE_MAPPED_FILE_MMAP
+        if (m_data)
+            ::munmap(const_cast<uint8_t *>(m_data), m_size);
+#endif
+        m_buffer.clear();
+        m_data = nullptr;
+        m_size = 0;
+    }
+
+    bool MappedFile::isOpen() const {
+        return m_data != nullptr;
+    }
+
+    const uint8_t * MappedFile::data() const {
+        return m_data;
+    }
+
+    size_t MappedFile::size() const {
+        return m_size;
+    }
+}
@@ -1,8 +1,10 @@
 #include "singe/Support/SceneParser.hpp"
 
+#include <algorithm>
 #include <fstream>
 #include <rapidxml.hpp>
 #include <stdexcept>
+#include <string_view>
 
 #include "singe/Support/Util.hpp"
 #include "singe/Support/log.hpp"
@@ -11,11 +13,9 @@ using namespace rapidxml;
 
 namespace singe::scene {
     using std::make_shared;
-    using std::stof;
-    using std::stoi;
     using std::move;
+    using std::string_view;
     using std::ifstream;
-    using std::istreambuf_iterator;
 
     static string traceNode(const xml_node<char> * node) {
         if (!node)
@@ -43,35 +43,50 @@ namespace singe::scene {
             ERROR(node, "received nullptr"); \
     }
 
-    static vec3 parseVec3(const xml_node<char> * node) {
-        PTR_CHECK(node);
+    static string_view nodeValue(const xml_node<char> * node) {
+        return string_view(node->value(), node->value_size());
+    }
 
-        auto parts = splitString(string(node->value(), node->value_size()));
-        if (parts.size() < 3)
-            throw SceneParseError(traceNode(node) + " : must have 3 components");
+    template<typename T>
+    static T parseNumber(const xml_node<char> * node) {
+        PTR_CHECK(node);
 
-        return vec3(stof(parts[0]), stof(parts[1]), stof(parts[2]));
+        T value;
+        if (!::parseNumber(nodeValue(node), value))
+            ERROR(node, "invalid number " + string(nodeValue(node)));
+        return value;
     }
 
-    static vec4 parseVec4(const xml_node<char> * node) {
+    /// Parse N numbers from the node value straight out of the xml buffer
+    template<size_t N>
+    static void parseComponents(const xml_node<char> * node, float (&out)[N]) {
         PTR_CHECK(node);
 
-        auto parts = splitString(string(node->value(), node->value_size()));
-        if (parts.size() < 4)
-            throw SceneParseError(traceNode(node) + " : must have 4 components");
-
-        return vec4(stof(parts[0]), stof(parts[1]), stof(parts[2]), stof(parts[3]));
+        TokenView tokens(nodeValue(node));
+        for (auto & component : out) {
+            if (!tokens.nextNumber(component))
+                throw SceneParseError(traceNode(node) + " : must have "
+                                      + std::to_string(N) + " components");
+        }
     }
 
-    static Pose parsePose(const xml_node<char> * node) {
-        PTR_CHECK(node);
+    static vec3 parseVec3(const xml_node<char> * node) {
+        float parts[3];
+        parseComponents(node, parts);
+        return vec3(parts[0], parts[1], parts[2]);
+    }
 
-        auto parts = splitString(string(node->value(), node->value_size()));
-        if (parts.size() < 6)
-            throw SceneParseError(traceNode(node) + " : must have 6 components");
+    static vec4 parseVec4(const xml_node<char> * node) {
+        float parts[4];
+        parseComponents(node, parts);
+        return vec4(parts[0], parts[1], parts[2], parts[3]);
+    }
 
-        return Pose(vec3(stof(parts[0]), stof(parts[1]), stof(parts[2])),
-                    vec3(stof(parts[3]), stof(parts[4]), stof(parts[5])));
+    static Pose parsePose(const xml_node<char> * node) {
+        float parts[6];
+        parseComponents(node, parts);
+        return Pose(vec3(parts[0], parts[1], parts[2]),
+                    vec3(parts[3], parts[4], parts[5]));
     }
 
     static Transform parseTransform(const xml_node<char> * node) {
@@ -118,22 +133,16 @@ namespace singe::scene {
             projection.mode = parseMode(mode_node);
 
         auto * fov_node = node->first_node("fov");
-        if (fov_node) {
-            string fov_str(fov_node->value(), fov_node->value_size());
-            projection.fov = stof(fov_str);
-        }
+        if (fov_node)
+            projection.fov = parseNumber<float>(fov_node);
 
         auto * near_node = node->first_node("near");
-        if (near_node) {
-            string near_str(near_node->value(), near_node->value_size());
-            projection.near = stof(near_str);
-        }
+        if (near_node)
+            projection.near = parseNumber<float>(near_node);
 
         auto * far_node = node->first_node("far");
-        if (far_node) {
-            string far_str(far_node->value(), far_node->value_size());
-            projection.far = stof(far_str);
-        }
+        if (far_node)
+            projection.far = parseNumber<float>(far_node);
 
         return projection;
     }
@@ -233,7 +242,8 @@ namespace singe::scene {
         return Shader::Source(type, path);
     }
 
-    static Shader parseShader(const xml_node<char> * node, Scene & parent) {
+    static shared_ptr<Shader> parseShader(const xml_node<char> * node,
+                                          const Scene & parent) {
         PTR_CHECK(node);
 
         // Check for ref
@@ -241,7 +251,10 @@ namespace singe::scene {
         auto * ref_attr = node->first_attribute("ref");
         if (ref_attr) {
             string ref(ref_attr->value(), ref_attr->value_size());
-            return parent.findShader(ref);
+            auto shader = parent.findShader(ref);
+            if (!shader)
+                throw SceneParseError("Unable to find shader " + ref);
+            return shader;
         }
 
         // Create Shader
@@ -258,20 +271,30 @@ namespace singe::scene {
 
         string type(type_attr->value(), type_attr->value_size());
 
-        Shader shader(name, type);
+        auto shader = make_shared<Shader>(name, type);
 
         auto * source_node = node->first_node("source");
         while (source_node) {
-            shader.source.emplace_back(parseSource(source_node));
+            shader->source.emplace_back(parseSource(source_node));
             source_node = source_node->next_sibling("source");
         }
 
         auto * uniform_node = node->first_node("uniform");
         while (uniform_node) {
-            shader.uniforms.emplace_back(parseUniform(uniform_node));
+            shader->uniforms.emplace_back(parseUniform(uniform_node));
             uniform_node = uniform_node->next_sibling("uniform");
         }
 
+        auto * define_node = node->first_node("define");
+        while (define_node) {
+            auto * define_name = define_node->first_attribute("name");
+            if (!define_name)
+                ERROR(define_node, "missing name attribute");
+            shader->defines.emplace_back(define_name->value(),
+                                         define_name->value_size());
+            define_node = define_node->next_sibling("define");
+        }
+
         return shader;
     }
 
@@ -306,7 +329,7 @@ namespace singe::scene {
         auto * shader_node = node->first_node("shader");
         if (!shader_node)
             ERROR(node, "missing shader node");
-        Shader shader = parseShader(shader_node, parent);
+        auto shader = parseShader(shader_node, parent);
 
         Model model(name, mesh, shader);
 
@@ -323,10 +346,8 @@ namespace singe::scene {
         Grid grid;
 
         auto * size_node = node->first_node("size");
-        if (size_node) {
-            string size_str(size_node->value(), size_node->value_size());
-            grid.size = stoi(size_str);
-        }
+        if (size_node)
+            grid.size = parseNumber<int>(size_node);
 
         auto * color_node = node->first_node("color");
         if (color_node)
@@ -335,64 +356,455 @@ namespace singe::scene {
         return grid;
     }
 
-    static shared_ptr<Scene> parseScene(const xml_node<char> * node,
-                                        shared_ptr<Scene> parent) {
-        PTR_CHECK(node);
+    /**
+     * Can the shader of a model node be resolved from scene yet. The ref
+     * must be declared in scene or a parent up to last, scenes further up may
+     * still declare it later and would be found first.
+     */
+    static bool canResolve(const xml_node<char> * node,
+                           const Scene & scene,
+                           const Scene & last) {
+        auto * shader_node = node->first_node("shader");
+        if (!shader_node)
+            return true;
+        auto * ref_attr = shader_node->first_attribute("ref");
+        if (!ref_attr)
+            return true;
+        string ref(ref_attr->value(), ref_attr->value_size());
+        for (auto * entry = &scene; entry; entry = entry->parent.get()) {
+            if (entry->shaderLookup.count(ref))
+                return true;
+            if (entry == &last)
+                break;
+        }
+        return false;
+    }
 
-        auto * name_attr = node->first_attribute("name");
-        if (!name_attr)
-            ERROR(node, "missing name attribute");
+    namespace {
+        /**
+         * Reads the tags of an xml stream in chunks.
+         *
+         * Text, comments and declarations between tags are skipped. The
+         * buffer only holds the data that has not been read yet, unless an
+         * element is being captured with SceneReader::element().
+         */
+        class SceneReader {
+        public:
+            enum TagType {
+                OPEN,
+                CLOSE,
+                EMPTY,
+            };
+
+            struct Tag {
+                TagType type;
+                string name;
+                string text;
+                /// Offset of the end of the tag in the buffer
+                size_t end;
+            };
+
+        private:
+            static constexpr size_t ChunkSize = 1 << 16;
+
+            istream & stream;
+            string buffer;
+            size_t pos;
+            /// Start of the element being captured, or npos
+            size_t mark;
+
+            bool fill() {
+                size_t size = buffer.size();
+                buffer.resize(size + ChunkSize);
+                stream.read(buffer.data() + size, ChunkSize);
+                buffer.resize(size + stream.gcount());
+                return stream.gcount() > 0;
+            }
 
-        string name(name_attr->value(), name_attr->value_size());
+            /// Drop data that has been read once there is a chunk of it
+            void compact() {
+                size_t keep = mark != string::npos ? mark : pos;
+                if (keep < ChunkSize)
+                    return;
+                buffer.erase(0, keep);
+                pos -= keep;
+                if (mark != string::npos)
+                    mark -= keep;
+            }
+
+            bool available(size_t size) {
+                while (buffer.size() < size) {
+                    if (!fill())
+                        return false;
+                }
+                return true;
+            }
 
-        shared_ptr<Scene> scene = make_shared<Scene>(parent, name);
+            bool startsWith(size_t at, string_view prefix) {
+                return available(at + prefix.size())
+                       && string_view(buffer).substr(at, prefix.size())
+                              == prefix;
+            }
 
-        auto * transform_node = node->first_node("transform");
-        if (transform_node)
-            scene->transform = parseTransform(transform_node);
+            size_t find(string_view token, size_t from) {
+                for (;;) {
+                    size_t at = buffer.find(token, from);
+                    if (at != string::npos)
+                        return at;
+                    if (buffer.size() >= token.size())
+                        from = std::max(from, buffer.size() - token.size());
+                    if (!fill())
+                        return string::npos;
+                }
+            }
 
-        auto * grid_node = node->first_node("grid");
-        if (grid_node)
-            scene->grid = make_shared<Grid>(parseGrid(grid_node));
+            /// Skip past the end of a comment or declaration
+            void skip(size_t from, string_view token) {
+                size_t at = find(token, from);
+                if (at == string::npos)
+                    throw SceneParseError("Unexpected end of file, expected "
+                                          + string(token));
+                pos = at + token.size();
+            }
 
-        auto * camera_node = node->first_node("camera");
-        while (camera_node) {
-            scene->cameras.emplace_back(parseCamera(camera_node));
-            camera_node = camera_node->next_sibling("camera");
-        }
+        public:
+            SceneReader(istream & stream)
+                : stream(stream), pos(0), mark(string::npos) {}
+
+            /**
+             * Read the next tag.
+             *
+             * @param tag the Tag to fill
+             *
+             * @return false at the end of the stream
+             */
+            bool next(Tag & tag) {
+                compact();
+                size_t open;
+                for (;;) {
+                    open = find("<", pos);
+                    if (open == string::npos) {
+                        pos = buffer.size();
+                        return false;
+                    }
+
+                    if (startsWith(open, "<!--"))
+                        skip(open + 4, "-->");
+                    else if (startsWith(open, "<![CDATA["))
+                        skip(open + 9, "]]>");
+                    else if (startsWith(open, "<?"))
+                        skip(open + 2, "?>");
+                    else if (startsWith(open, "<!"))
+                        skip(open + 2, ">");
+                    else
+                        break;
+                }
+
+                size_t close = open + 1;
+                char quote = 0;
+                for (;; close++) {
+                    if (!available(close + 1))
+                        throw SceneParseError("Unexpected end of file in tag");
+                    char c = buffer[close];
+                    if (quote) {
+                        if (c == quote)
+                            quote = 0;
+                    }
+                    else if (c == '"' || c == '\'')
+                        quote = c;
+                    else if (c == '>')
+                        break;
+                }
+
+                size_t nameStart = open + 1;
+                if (buffer[nameStart] == '/') {
+                    tag.type = CLOSE;
+                    nameStart++;
+                }
+                else if (buffer[close - 1] == '/')
+                    tag.type = EMPTY;
+                else
+                    tag.type = OPEN;
+
+                size_t nameEnd = buffer.find_first_of(" \t\r\n/>", nameStart);
+                tag.name = buffer.substr(nameStart, nameEnd - nameStart);
+                tag.text = buffer.substr(open, close + 1 - open);
+                tag.end = close + 1;
+                pos = tag.end;
+                return true;
+            }
 
-        // IMPORTANT: Shaders must be loaded before models
-        auto * shader_node = node->first_node("shader");
-        while (shader_node) {
-            scene->shaders.emplace_back(parseShader(shader_node, *scene));
-            shader_node = shader_node->next_sibling("shader");
-        }
+            /**
+             * Read the rest of the element that starts with start.
+             *
+             * @param start the start tag that was just read
+             *
+             * @return the text of the whole element
+             */
+            string element(const Tag & start) {
+                if (start.type != OPEN)
+                    return start.text;
+
+                mark = pos - start.text.size();
+                int depth = 1;
+                Tag tag;
+                while (depth > 0) {
+                    if (!next(tag))
+                        throw SceneParseError("Unexpected end of file in "
+                                              + start.name);
+                    if (tag.type == OPEN)
+                        depth++;
+                    else if (tag.type == CLOSE)
+                        depth--;
+                }
+
+                string text = buffer.substr(mark, tag.end - mark);
+                mark = string::npos;
+                return text;
+            }
+        };
+
+        /**
+         * Builds the Scene tree from the elements read by a SceneReader.
+         *
+         * Each element inside a scene, other than child scenes, is parsed
+         * on it's own with rapidxml once it has been read.
+         *
+         * A model whose shader is not declared earlier in it's own scene is
+         * held back until the end tag of the scene that declares it, so refs
+         * resolve as if the shaders of each scene were read first. It is
+         * then inserted at it's place in the file. A
+         * scene is only passed to SceneHandler::onSceneEnd() when no model
+         * in it or it's children is held back, so it is complete.
+         */
+        class SceneBuilder {
+            /// Where the models of a scene go while some are held back
+            struct Placement {
+                shared_ptr<Scene> scene;
+                shared_ptr<Placement> parent;
+                /// Index in the file of each model in scene->models
+                vector<size_t> order;
+                /// Number of model elements read so far
+                size_t count = 0;
+                /// Models held back in this scene and it's children
+                size_t pending = 0;
+                /// The end tag has been read
+                bool closed = false;
+            };
+
+            struct Deferred {
+                shared_ptr<Placement> placement;
+                /// Index in the file among the models of the scene
+                size_t index;
+                string text;
+            };
+
+            struct OpenScene {
+                shared_ptr<Placement> placement;
+                bool hasTransform = false;
+                /// Models waiting for a shader that has not been read
+                vector<Deferred> deferred;
+            };
+
+            SceneHandler & handler;
+            vector<OpenScene> open;
+
+            string path() const {
+                string path;
+                for (auto & entry : open) {
+                    if (!path.empty())
+                        path += "/";
+                    path += entry.placement->scene->name;
+                }
+                return path;
+            }
 
-        auto * model_node = node->first_node("model");
-        while (model_node) {
-            scene->models.emplace_back(parseModel(model_node, *scene));
-            model_node = model_node->next_sibling("model");
-        }
+            void addModel(Placement & placement,
+                          size_t index,
+                          const xml_node<char> * node) {
+                auto & scene = *placement.scene;
+                Model model = parseModel(node, scene);
+                if (!handler.onModel(scene, model))
+                    return;
+
+                auto it = std::lower_bound(placement.order.begin(),
+                                           placement.order.end(), index);
+                size_t at = it - placement.order.begin();
+                placement.order.insert(it, index);
+                scene.models.emplace(scene.models.begin() + at,
+                                     move(model));
+            }
 
-        auto * scene_node = node->first_node("scene");
-        while (scene_node) {
-            scene->children.emplace_back(parseScene(scene_node, scene));
-            scene_node = scene_node->next_sibling("scene");
-        }
+            /// A held back model of placement was added or dropped
+            void release(Placement & placement) {
+                for (auto * entry = &placement; entry;
+                     entry = entry->parent.get()) {
+                    if (--entry->pending == 0 && entry->closed)
+                        endPlacement(*entry);
+                }
+            }
 
-        return scene;
-    }
+            void endPlacement(Placement & placement) {
+                placement.order = {};
+                handler.onSceneEnd(placement.scene);
+            }
 
-    Shader & Scene::findShader(const string & name) {
-        for (auto & shader : shaders) {
-            if (shader.name == name) {
-                return shader;
+            void parseElement(OpenScene & current, string text) {
+                // rapidxml writes into the buffer, text is kept for deferring
+                string parsed = text;
+                xml_document doc;
+                doc.parse<0>(parsed.data());
+                auto * node = doc.first_node();
+                if (!node)
+                    return;
+
+                auto & placement = current.placement;
+                auto & scene = *placement->scene;
+                string_view name(node->name(), node->name_size());
+                if (name == "transform") {
+                    if (!current.hasTransform)
+                        scene.transform = parseTransform(node);
+                    current.hasTransform = true;
+                }
+                else if (name == "grid") {
+                    if (!scene.grid)
+                        scene.grid = make_shared<Grid>(parseGrid(node));
+                }
+                else if (name == "camera") {
+                    scene.cameras.emplace_back(parseCamera(node));
+                }
+                else if (name == "shader") {
+                    scene.addShader(parseShader(node, scene));
+                }
+                else if (name == "model") {
+                    size_t index = placement->count++;
+                    // Shaders of parents are only complete at their end tag
+                    if (canResolve(node, scene, scene)) {
+                        addModel(*placement, index, node);
+                        return;
+                    }
+
+                    current.deferred.push_back({placement, index, move(text)});
+                    for (auto & entry : open) entry.placement->pending++;
+                }
             }
+
+            void endScene() {
+                OpenScene current = move(open.back());
+                open.pop_back();
+
+                for (auto & deferred : current.deferred) {
+                    string parsed = deferred.text;
+                    xml_document doc;
+                    doc.parse<0>(parsed.data());
+                    auto * node = doc.first_node();
+                    auto & placement = *deferred.placement;
+                    if (!open.empty()
+                        && !canResolve(node, *placement.scene,
+                                       *current.placement->scene)) {
+                        // The shader may be declared later in a parent
+                        open.back().deferred.emplace_back(move(deferred));
+                        continue;
+                    }
+                    addModel(placement, deferred.index, node);
+                    release(placement);
+                }
+
+                auto & placement = *current.placement;
+                placement.closed = true;
+                if (placement.pending == 0)
+                    endPlacement(placement);
+            }
+
+        public:
+            SceneBuilder(SceneHandler & handler) : handler(handler) {}
+
+            shared_ptr<Scene> build(SceneReader & reader) {
+                shared_ptr<Scene> root;
+                SceneReader::Tag tag;
+                while (reader.next(tag)) {
+                    if (open.empty()) {
+                        if (root)
+                            break;
+                        if (tag.name != "scene") {
+                            reader.element(tag);
+                            continue;
+                        }
+                    }
+
+                    if (tag.type == SceneReader::CLOSE) {
+                        if (tag.name != "scene")
+                            throw SceneParseError(path() + " : unexpected </"
+                                                  + tag.name + ">");
+                        endScene();
+                        continue;
+                    }
+
+                    if (tag.name != "scene") {
+                        string text = reader.element(tag);
+                        try {
+                            parseElement(open.back(), move(text));
+                        }
+                        catch (const SceneParseError & error) {
+                            throw SceneParseError(path() + " : "
+                                                  + error.what());
+                        }
+                        continue;
+                    }
+
+                    // Parse the start tag as an empty element for it's name
+                    string text = tag.text;
+                    if (tag.type == SceneReader::OPEN)
+                        text.insert(text.size() - 1, "/");
+                    xml_document doc;
+                    doc.parse<0>(text.data());
+                    auto * node = doc.first_node();
+
+                    auto * name_attr = node->first_attribute("name");
+                    if (!name_attr)
+                        throw SceneParseError(path() + " : missing name");
+                    string name(name_attr->value(), name_attr->value_size());
+
+                    auto placement = make_shared<Placement>();
+                    shared_ptr<Scene> parent;
+                    if (!open.empty()) {
+                        placement->parent = open.back().placement;
+                        parent = placement->parent->scene;
+                    }
+                    auto scene = make_shared<Scene>(parent, name);
+                    if (parent)
+                        parent->children.emplace_back(scene);
+                    else
+                        root = scene;
+
+                    placement->scene = scene;
+                    open.push_back({placement});
+                    handler.onScene(scene);
+                    if (tag.type == SceneReader::EMPTY)
+                        endScene();
+                }
+
+                if (!root)
+                    throw SceneParseError("No root scene node");
+                if (!open.empty())
+                    throw SceneParseError(path() + " : unexpected end of file");
+                return root;
+            }
+        };
+    }
+
+    void Scene::addShader(const shared_ptr<Shader> & shader) {
+        shaders.emplace_back(shader);
+        shaderLookup.try_emplace(shader->name, shader);
+    }
+
+    shared_ptr<Shader> Scene::findShader(const string & name) const {
+        for (auto * scene = this; scene; scene = scene->parent.get()) {
+            auto it = scene->shaderLookup.find(name);
+            if (it != scene->shaderLookup.end())
+                return it->second;
         }
-        if (parent) {
-            return parent->findShader(name);
-        }
-        throw SceneParseError("Unable to find shader " + name);
+        return nullptr;
     }
 
     SceneParser::SceneParser() {}
@@ -406,16 +818,22 @@ namespace singe::scene {
     }
 
     shared_ptr<Scene> SceneParser::parse(istream & stream) {
-        string body((istreambuf_iterator<char>(stream)),
-                    istreambuf_iterator<char>());
+        SceneHandler handler;
+        return parse(stream, handler);
+    }
 
-        xml_document doc;
-        doc.parse<0>(body.data());
+    shared_ptr<Scene> SceneParser::parse(const string & filename,
+                                         SceneHandler & handler) {
+        ifstream is(filename);
+        if (!is.is_open())
+            throw SceneParseError("Failed to open file " + filename);
 
-        auto * root = doc.first_node("scene");
-        if (!root)
-            throw SceneParseError("No root scene node");
+        return parse(is, handler);
+    }
 
-        return scene::parseScene(root, nullptr);
+    shared_ptr<Scene> SceneParser::parse(istream & stream,
+                                         SceneHandler & handler) {
+        SceneReader reader(stream);
+        return SceneBuilder(handler).build(reader);
     }
 }
@@ -0,0 +1,53 @@
+#include "singe/Support/ThreadPool.hpp"
+
+namespace singe {
+    /// Pool of the worker running on this thread
+    static thread_local const ThreadPool * currentPool = nullptr;
+
+    ThreadPool::ThreadPool(size_t threads) : stopping(false) {
+        if (threads == 0)
+            threads = std::thread::hardware_concurrency();
+        if (threads == 0)
+            threads = 1;
+
+        workers.reserve(threads);
+        for (size_t i = 0; i < threads; i++) {
+            workers.emplace_back(&ThreadPool::work, this);
+        }
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        condition.notify_all();
+        for (auto & worker : workers) worker.join();
+    }
+
+    size_t ThreadPool::size() const {
+        return workers.size();
+    }
+
+    bool ThreadPool::isWorker() const {
+        return currentPool == this;
+    }
+
+    void ThreadPool::work() {
+        currentPool = this;
+        for (;;) {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                condition.wait(lock, [this]() {
+                    return stopping || !jobs.empty();
+                });
+                if (jobs.empty())
+                    return;
+                job = std::move(jobs.front());
+                jobs.pop();
+            }
+            job();
+        }
+    }
+}
@@ -1,7 +1,16 @@
 #include "singe/Support/Util.hpp"
 
+#include <cerrno>
+#include <charconv>
+#include <cstdlib>
 #include <sstream>
 
+static constexpr std::string_view Whitespace = " \t\n\r\f\v";
+
+size_t alignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
 std::vector<std::string> splitString(const std::string & str, char delim) {
     std::vector<std::string> parts;
     std::stringstream ss(str);
@@ -33,3 +42,79 @@ std::string Tokenizer::next() {
 
     return part;
 }
+
+/// Skip leading whitespace and a leading +, false if nothing is left
+static bool skipPrefix(std::string_view & text) {
+    size_t start = text.find_first_not_of(Whitespace);
+    if (start == std::string_view::npos)
+        return false;
+    text.remove_prefix(start);
+    // from_chars does not accept a leading +
+    if (text.front() == '+')
+        text.remove_prefix(1);
+    return !text.empty();
+}
+
+template<typename T>
+static bool parseChars(std::string_view text, T & value) {
+    if (!skipPrefix(text))
+        return false;
+
+    auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    return result.ec == std::errc();
+}
+
+bool parseNumber(std::string_view text, float & value) {
+#if defined(__cpp_lib_to_chars)
+    return parseChars(text, value);
+#else
+    // Floating point from_chars is missing before GCC 11 and in Apple
+    // libc++. strtof would skip whitespace after the + and needs a
+    // terminated string.
+    if (!skipPrefix(text) || Whitespace.find(text.front()) != text.npos)
+        return false;
+
+    std::string terminated(text);
+    char * end = nullptr;
+    errno = 0;
+    float parsed = std::strtof(terminated.c_str(), &end);
+    if (end == terminated.c_str() || errno == ERANGE)
+        return false;
+    value = parsed;
+    return true;
+#endif
+}
+
+bool parseNumber(std::string_view text, int & value) {
+    return parseChars(text, value);
+}
+
+TokenView::TokenView(std::string_view text) : text(text) {}
+
+bool TokenView::hasNext() const {
+    return text.find_first_not_of(Whitespace) != std::string_view::npos;
+}
+
+std::string_view TokenView::next() {
+    size_t start = text.find_first_not_of(Whitespace);
+    if (start == std::string_view::npos) {
+        text = {};
+        return {};
+    }
+
+    size_t end = text.find_first_of(Whitespace, start);
+    if (end == std::string_view::npos)
+        end = text.size();
+
+    std::string_view token = text.substr(start, end - start);
+    text.remove_prefix(end);
+    return token;
+}
+
+bool TokenView::nextNumber(float & value) {
+    return parseNumber(next(), value);
+}
+
+bool TokenView::nextNumber(int & value) {
+    return parseNumber(next(), value);
+}
@@ -0,0 +1,132 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <singe/Core/CookedTexture.hpp>
+#include <vector>
+
+using singe::CookedTexture;
+using std::vector;
+
+namespace {
+    vector<uint8_t> solid(unsigned width,
+                          unsigned height,
+                          uint8_t r,
+                          uint8_t g,
+                          uint8_t b,
+                          uint8_t a) {
+        vector<uint8_t> pixels;
+        for (unsigned i = 0; i < width * height; i++)
+            pixels.insert(pixels.end(), {r, g, b, a});
+        return pixels;
+    }
+
+    uint16_t read16(const uint8_t * data) {
+        return data[0] | (data[1] << 8);
+    }
+}
+
+TEST(CookedTextureTest, BC1Size) {
+    auto format = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    EXPECT_EQ(CookedTexture::compressLevel(solid(4, 4, 0, 0, 0, 255), 4, 4,
+                                           format)
+                  .size(),
+              8);
+    EXPECT_EQ(CookedTexture::compressLevel(solid(8, 8, 0, 0, 0, 255), 8, 8,
+                                           format)
+                  .size(),
+              32);
+    // Partial blocks on the edges still take a whole block
+    EXPECT_EQ(CookedTexture::compressLevel(solid(5, 3, 0, 0, 0, 255), 5, 3,
+                                           format)
+                  .size(),
+              16);
+    EXPECT_EQ(CookedTexture::compressLevel(solid(1, 1, 0, 0, 0, 255), 1, 1,
+                                           format)
+                  .size(),
+              8);
+}
+
+TEST(CookedTextureTest, BC1SolidColor) {
+    auto out = CookedTexture::compressLevel(solid(4, 4, 255, 0, 0, 255), 4, 4,
+                                            GL_COMPRESSED_RGB_S3TC_DXT1_EXT);
+    ASSERT_EQ(out.size(), 8);
+    EXPECT_EQ(read16(&out[0]), 0xf800);
+    EXPECT_EQ(read16(&out[2]), 0xf800);
+    for (int i = 4; i < 8; i++)
+        EXPECT_EQ(out[i], 0);
+}
+
+TEST(CookedTextureTest, BC1TwoColors) {
+    // Bottom two rows white, top two rows black
+    auto pixels = solid(4, 4, 0, 0, 0, 255);
+    for (int i = 0; i < 8 * 4; i++)
+        pixels[i] = 255;
+
+    auto out = CookedTexture::compressLevel(pixels, 4, 4,
+                                            GL_COMPRESSED_RGB_S3TC_DXT1_EXT);
+    ASSERT_EQ(out.size(), 8);
+    uint16_t color0 = read16(&out[0]);
+    uint16_t color1 = read16(&out[2]);
+    // 4 color mode needs color0 > color1, color0 is the bright end
+    EXPECT_GT(color0, color1);
+
+    // White pixels pick color0 (index 0), black pixels pick color1 (index 1)
+    EXPECT_EQ(out[4], 0x00);
+    EXPECT_EQ(out[5], 0x00);
+    EXPECT_EQ(out[6], 0x55);
+    EXPECT_EQ(out[7], 0x55);
+}
+
+TEST(CookedTextureTest, BC1EdgeRepeatsLastPixel) {
+    // A 1x1 image is a solid block
+    auto out = CookedTexture::compressLevel(solid(1, 1, 0, 0, 255, 255), 1, 1,
+                                            GL_COMPRESSED_RGB_S3TC_DXT1_EXT);
+    ASSERT_EQ(out.size(), 8);
+    EXPECT_EQ(read16(&out[0]), 0x001f);
+    EXPECT_EQ(read16(&out[2]), 0x001f);
+}
+
+TEST(CookedTextureTest, BC3Size) {
+    auto format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    EXPECT_EQ(CookedTexture::compressLevel(solid(4, 4, 0, 0, 0, 0), 4, 4,
+                                           format)
+                  .size(),
+              16);
+    EXPECT_EQ(CookedTexture::compressLevel(solid(6, 6, 0, 0, 0, 0), 6, 6,
+                                           format)
+                  .size(),
+              64);
+}
+
+TEST(CookedTextureTest, BC3SolidAlpha) {
+    auto out = CookedTexture::compressLevel(solid(4, 4, 255, 0, 0, 128), 4, 4,
+                                            GL_COMPRESSED_RGBA_S3TC_DXT5_EXT);
+    ASSERT_EQ(out.size(), 16);
+    EXPECT_EQ(out[0], 128);
+    EXPECT_EQ(out[1], 128);
+    for (int i = 2; i < 8; i++)
+        EXPECT_EQ(out[i], 0);
+    // The color block follows the alpha block
+    EXPECT_EQ(read16(&out[8]), 0xf800);
+    EXPECT_EQ(read16(&out[10]), 0xf800);
+}
+
+TEST(CookedTextureTest, BC3TwoAlphas) {
+    // Even pixels are opaque, odd pixels are transparent
+    auto pixels = solid(4, 4, 0, 0, 0, 255);
+    for (int i = 1; i < 16; i += 2)
+        pixels[i * 4 + 3] = 0;
+
+    auto out = CookedTexture::compressLevel(pixels, 4, 4,
+                                            GL_COMPRESSED_RGBA_S3TC_DXT5_EXT);
+    ASSERT_EQ(out.size(), 16);
+    // 8 value mode needs alpha0 > alpha1
+    EXPECT_EQ(out[0], 255);
+    EXPECT_EQ(out[1], 0);
+
+    uint64_t indices = 0;
+    for (int i = 0; i < 6; i++)
+        indices |= uint64_t(out[2 + i]) << (i * 8);
+    for (int i = 0; i < 16; i++)
+        EXPECT_EQ((indices >> (i * 3)) & 7, i % 2 ? 1u : 0u) << "pixel " << i;
+}
@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+
+#include <singe/Support/FreeList.hpp>
+
+using singe::FreeList;
+
+TEST(FreeListTest, AllocateFirstFit) {
+    FreeList list(10);
+    size_t offset = 99;
+    ASSERT_TRUE(list.allocate(4, offset));
+    EXPECT_EQ(offset, 0);
+    ASSERT_TRUE(list.allocate(6, offset));
+    EXPECT_EQ(offset, 4);
+    EXPECT_FALSE(list.allocate(1, offset));
+}
+
+TEST(FreeListTest, EmptyList) {
+    FreeList list(0);
+    size_t offset;
+    EXPECT_EQ(list.getCapacity(), 0);
+    EXPECT_FALSE(list.allocate(1, offset));
+}
+
+TEST(FreeListTest, ReleaseReusesFirstHole) {
+    FreeList list(12);
+    size_t a, b, c;
+    ASSERT_TRUE(list.allocate(4, a));
+    ASSERT_TRUE(list.allocate(4, b));
+    ASSERT_TRUE(list.allocate(4, c));
+
+    list.release(a, 4);
+    size_t offset;
+    ASSERT_TRUE(list.allocate(2, offset));
+    EXPECT_EQ(offset, a);
+    EXPECT_FALSE(list.allocate(3, offset));
+}
+
+TEST(FreeListTest, ReleaseMergesNeighbours) {
+    FreeList list(12);
+    size_t a, b, c;
+    ASSERT_TRUE(list.allocate(4, a));
+    ASSERT_TRUE(list.allocate(4, b));
+    ASSERT_TRUE(list.allocate(4, c));
+
+    // Release out of order, the middle block joins both sides
+    list.release(a, 4);
+    list.release(c, 4);
+    list.release(b, 4);
+
+    size_t offset = 99;
+    ASSERT_TRUE(list.allocate(12, offset));
+    EXPECT_EQ(offset, 0);
+}
+
+TEST(FreeListTest, ReleaseZeroIsIgnored) {
+    FreeList list(4);
+    size_t offset;
+    ASSERT_TRUE(list.allocate(4, offset));
+    list.release(2, 0);
+    EXPECT_FALSE(list.allocate(1, offset));
+}
+
+TEST(FreeListTest, GrowMergesWithFreeTail) {
+    FreeList list(8);
+    size_t offset;
+    ASSERT_TRUE(list.allocate(6, offset));
+    EXPECT_FALSE(list.allocate(4, offset));
+
+    list.grow(16);
+    EXPECT_EQ(list.getCapacity(), 16);
+    ASSERT_TRUE(list.allocate(10, offset));
+    EXPECT_EQ(offset, 6);
+}
+
+TEST(FreeListTest, GrowWhenFull) {
+    FreeList list(4);
+    size_t offset;
+    ASSERT_TRUE(list.allocate(4, offset));
+
+    list.grow(8);
+    ASSERT_TRUE(list.allocate(4, offset));
+    EXPECT_EQ(offset, 4);
+}
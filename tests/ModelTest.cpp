@@ -0,0 +1,44 @@
+#include <gtest/gtest.h>
+
+#include <singe/Graphics/Model.hpp>
+#include <utility>
+#include <vector>
+
+using singe::Model;
+using Ranges = std::vector<std::pair<size_t, size_t>>;
+
+TEST(ModelTest, MergeRangesEmpty) {
+    Ranges ranges;
+    Model::mergeRanges(ranges, 10);
+    EXPECT_TRUE(ranges.empty());
+}
+
+TEST(ModelTest, MergeRangesSorts) {
+    Ranges ranges {{6, 8}, {0, 2}, {3, 4}};
+    Model::mergeRanges(ranges, 10);
+    EXPECT_EQ(ranges, (Ranges {{0, 2}, {3, 4}, {6, 8}}));
+}
+
+TEST(ModelTest, MergeRangesOverlapping) {
+    Ranges ranges {{2, 6}, {0, 3}, {4, 5}};
+    Model::mergeRanges(ranges, 10);
+    EXPECT_EQ(ranges, (Ranges {{0, 6}}));
+}
+
+TEST(ModelTest, MergeRangesTouching) {
+    Ranges ranges {{0, 2}, {2, 4}, {5, 6}};
+    Model::mergeRanges(ranges, 10);
+    EXPECT_EQ(ranges, (Ranges {{0, 4}, {5, 6}}));
+}
+
+TEST(ModelTest, MergeRangesClamps) {
+    Ranges ranges {{2, 20}, {12, 14}, {8, 9}};
+    Model::mergeRanges(ranges, 10);
+    EXPECT_EQ(ranges, (Ranges {{2, 10}}));
+}
+
+TEST(ModelTest, MergeRangesDropsOutOfRange) {
+    Ranges ranges {{0, 1}, {10, 12}, {15, 16}};
+    Model::mergeRanges(ranges, 10);
+    EXPECT_EQ(ranges, (Ranges {{0, 1}}));
+}
@@ -0,0 +1,71 @@
+#include <gtest/gtest.h>
+
+#include <singe/Support/SceneParser.hpp>
+#include <sstream>
+#include <string>
+
+using singe::scene::SceneParser;
+
+namespace {
+    std::string shader(const std::string & name) {
+        return "<shader name=\"" + name + "\" type=\"mvp\">"
+               "<source type=\"vertex\" path=\"a.vert\" />"
+               "<source type=\"fragment\" path=\"a.frag\" /></shader>";
+    }
+
+    std::string model(const std::string & name, const std::string & ref) {
+        return "<model name=\"" + name + "\"><mesh path=\"" + name
+               + ".obj\" /><shader ref=\"" + ref + "\" /></model>";
+    }
+}
+
+TEST(SceneParserTest, RefDeclaredEarlierInScene) {
+    std::istringstream is("<scene name=\"root\">" + shader("x")
+                          + model("m", "x") + "</scene>");
+    auto root = SceneParser().parse(is);
+    ASSERT_EQ(root->models.size(), 1);
+    EXPECT_EQ(root->models[0].shader, root->shaderLookup.at("x"));
+}
+
+TEST(SceneParserTest, OwnSceneShaderDeclaredLaterWins) {
+    // The parent already declares x, but the child's own x comes first
+    std::istringstream is("<scene name=\"root\">" + shader("x")
+                          + "<scene name=\"child\">" + model("m", "x")
+                          + shader("x") + "</scene></scene>");
+    auto root = SceneParser().parse(is);
+    ASSERT_EQ(root->children.size(), 1);
+    auto & child = root->children[0];
+    ASSERT_EQ(child->models.size(), 1);
+    EXPECT_EQ(child->models[0].shader, child->shaderLookup.at("x"));
+    EXPECT_NE(child->models[0].shader, root->shaderLookup.at("x"));
+}
+
+TEST(SceneParserTest, ClosestParentDeclaredLaterWins) {
+    std::istringstream is("<scene name=\"root\">" + shader("x")
+                          + "<scene name=\"parent\"><scene name=\"child\">"
+                          + model("m", "x") + "</scene>" + shader("x")
+                          + "</scene></scene>");
+    auto root = SceneParser().parse(is);
+    auto & parent = root->children.at(0);
+    auto & child = parent->children.at(0);
+    ASSERT_EQ(child->models.size(), 1);
+    EXPECT_EQ(child->models[0].shader, parent->shaderLookup.at("x"));
+}
+
+TEST(SceneParserTest, HeldBackModelsKeepFileOrder) {
+    std::istringstream is("<scene name=\"root\">" + shader("x")
+                          + model("a", "y") + model("b", "x")
+                          + model("c", "y") + shader("y") + "</scene>");
+    auto root = SceneParser().parse(is);
+    ASSERT_EQ(root->models.size(), 3);
+    EXPECT_EQ(root->models[0].name, "a");
+    EXPECT_EQ(root->models[1].name, "b");
+    EXPECT_EQ(root->models[2].name, "c");
+    EXPECT_EQ(root->models[0].shader, root->shaderLookup.at("y"));
+}
+
+TEST(SceneParserTest, MissingShaderThrows) {
+    std::istringstream is("<scene name=\"root\">" + model("m", "x")
+                          + "</scene>");
+    EXPECT_THROW(SceneParser().parse(is), singe::scene::SceneParseError);
+}
@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+
+#include <singe/Core/ResourceManager.hpp>
+#include <singe/Core/ShaderVariants.hpp>
+#include <string>
+
+using singe::ResourceLoadException;
+using singe::ShaderVariants;
+
+namespace {
+    const std::string Vertex = "#version 330 core\nvoid main() {}\n";
+    const std::string Fragment =
+        "#version 330 core\n#ifdef SINGE_A\n#endif\nvoid main() {}\n";
+}
+
+TEST(ShaderVariantsTest, MaskBitsFollowFirstUse) {
+    ShaderVariants variants(Vertex, Fragment, "test");
+    EXPECT_EQ(variants.getMask({}), 0u);
+    EXPECT_EQ(variants.getMask({"B"}), 0b01u);
+    EXPECT_EQ(variants.getMask({"A", "B"}), 0b11u);
+    EXPECT_EQ(variants.getMask({"A"}), 0b10u);
+    EXPECT_EQ(variants.getKeys(), (std::vector<std::string> {"B", "A"}));
+}
+
+TEST(ShaderVariantsTest, MaskIgnoresOrderAndRepeats) {
+    ShaderVariants variants(Vertex, Fragment, "test");
+    auto mask = variants.getMask({"A", "B", "C"});
+    EXPECT_EQ(variants.getMask({"C", "A", "B"}), mask);
+    EXPECT_EQ(variants.getMask({"A", "A"}), variants.getMask({"A"}));
+}
+
+TEST(ShaderVariantsTest, MaskThrowsPastMaxKeys) {
+    ShaderVariants variants(Vertex, Fragment, "test");
+    for (size_t i = 0; i < ShaderVariants::MaxKeys; i++)
+        variants.getMask({"KEY_" + std::to_string(i)});
+    EXPECT_EQ(variants.getMask({"KEY_31"}), 1u << 31);
+    EXPECT_THROW(variants.getMask({"ONE_MORE"}), ResourceLoadException);
+}
+
+TEST(ShaderVariantsTest, SourcesForMaskZero) {
+    ShaderVariants variants(Vertex, Fragment, "test");
+    auto sources = variants.getSources(0);
+    EXPECT_EQ(sources.vertex, Vertex);
+    EXPECT_EQ(sources.fragment, Fragment);
+    EXPECT_EQ(sources.name, "test");
+}
+
+TEST(ShaderVariantsTest, SourcesDefinesSortedAfterVersion) {
+    ShaderVariants variants(Vertex, Fragment, "test");
+    auto mask = variants.getMask({"B", "A"});
+    auto sources = variants.getSources(mask);
+    EXPECT_EQ(sources.vertex,
+              "#version 330 core\n#define A\n#define B\nvoid main() {}\n");
+    EXPECT_EQ(sources.name, "test A B");
+
+    // Keys first used in another order give the same sources
+    ShaderVariants other(Vertex, Fragment, "test");
+    auto otherMask = other.getMask({"A"}) | other.getMask({"B"});
+    EXPECT_EQ(other.getSources(otherMask).vertex, sources.vertex);
+    EXPECT_EQ(other.getSources(otherMask).name, sources.name);
+}
+
+TEST(ShaderVariantsTest, SourcesWithoutVersion) {
+    ShaderVariants variants("void main() {}\n", Fragment, "test");
+    auto sources = variants.getSources(variants.getMask({"A"}));
+    EXPECT_EQ(sources.vertex, "#define A\nvoid main() {}\n");
+}
+
+TEST(ShaderVariantsTest, Uses) {
+    ShaderVariants variants(Vertex, Fragment, "test");
+    EXPECT_TRUE(variants.uses("SINGE_A"));
+    EXPECT_FALSE(variants.uses("SINGE_B"));
+}
+
+TEST(ShaderVariantsTest, UsesWholeIdentifiers) {
+    ShaderVariants variants(Vertex, Fragment, "test");
+    EXPECT_FALSE(variants.uses("SINGE"));
+    EXPECT_FALSE(variants.uses("INGE_A"));
+    EXPECT_FALSE(variants.uses(""));
+
+    ShaderVariants longer(Vertex, "#ifdef SINGE_AB\n#endif\n", "test");
+    EXPECT_FALSE(longer.uses("SINGE_A"));
+    EXPECT_TRUE(longer.uses("SINGE_AB"));
+
+    ShaderVariants both(Vertex, "#ifdef SINGE_AB\n#elif SINGE_A\n#endif\n",
+                        "test");
+    EXPECT_TRUE(both.uses("SINGE_A"));
+}
@@ -0,0 +1,52 @@
+#include <gtest/gtest.h>
+
+#include <singe/Support/Util.hpp>
+
+TEST(UtilTest, ParseFloat) {
+    float value = 0.0f;
+    ASSERT_TRUE(parseNumber("1.5", value));
+    EXPECT_FLOAT_EQ(value, 1.5f);
+    ASSERT_TRUE(parseNumber("-0.25", value));
+    EXPECT_FLOAT_EQ(value, -0.25f);
+    ASSERT_TRUE(parseNumber("2e3", value));
+    EXPECT_FLOAT_EQ(value, 2000.0f);
+}
+
+TEST(UtilTest, ParseFloatSkipsWhitespaceAndPlus) {
+    float value = 0.0f;
+    ASSERT_TRUE(parseNumber("  \t+3.25", value));
+    EXPECT_FLOAT_EQ(value, 3.25f);
+}
+
+TEST(UtilTest, ParseFloatIgnoresTrailing) {
+    float value = 0.0f;
+    ASSERT_TRUE(parseNumber("4.5 6", value));
+    EXPECT_FLOAT_EQ(value, 4.5f);
+    ASSERT_TRUE(parseNumber("7px", value));
+    EXPECT_FLOAT_EQ(value, 7.0f);
+}
+
+TEST(UtilTest, ParseFloatInvalid) {
+    float value = 9.0f;
+    EXPECT_FALSE(parseNumber("", value));
+    EXPECT_FALSE(parseNumber("   ", value));
+    EXPECT_FALSE(parseNumber("abc", value));
+    EXPECT_FALSE(parseNumber("+", value));
+    EXPECT_FALSE(parseNumber("+ 1", value));
+}
+
+TEST(UtilTest, ParseInt) {
+    int value = 0;
+    ASSERT_TRUE(parseNumber("42", value));
+    EXPECT_EQ(value, 42);
+    ASSERT_TRUE(parseNumber(" -7", value));
+    EXPECT_EQ(value, -7);
+    ASSERT_TRUE(parseNumber("+12/3", value));
+    EXPECT_EQ(value, 12);
+}
+
+TEST(UtilTest, ParseIntInvalid) {
+    int value = 0;
+    EXPECT_FALSE(parseNumber("x1", value));
+    EXPECT_FALSE(parseNumber("", value));
+}
@@ -0,0 +1,65 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <limits>
+#include <singe/Graphics/VertexFormat.hpp>
+
+using singe::VertexFormat;
+using glm::vec3;
+
+TEST(VertexFormatTest, ToHalfExact) {
+    EXPECT_EQ(VertexFormat::toHalf(0.0f), 0x0000);
+    EXPECT_EQ(VertexFormat::toHalf(-0.0f), 0x8000);
+    EXPECT_EQ(VertexFormat::toHalf(1.0f), 0x3c00);
+    EXPECT_EQ(VertexFormat::toHalf(0.5f), 0x3800);
+    EXPECT_EQ(VertexFormat::toHalf(-2.0f), 0xc000);
+    EXPECT_EQ(VertexFormat::toHalf(65504.0f), 0x7bff);
+}
+
+TEST(VertexFormatTest, ToHalfRounds) {
+    // 1 + 2^-10 is the next half after 1
+    EXPECT_EQ(VertexFormat::toHalf(1.0f + std::ldexp(1.0f, -10)), 0x3c01);
+    // Below half a step rounds down, above rounds up
+    EXPECT_EQ(VertexFormat::toHalf(1.0f + std::ldexp(1.0f, -12)), 0x3c00);
+    EXPECT_EQ(VertexFormat::toHalf(1.0f + std::ldexp(3.0f, -12)), 0x3c01);
+    // Carry out of the mantissa bumps the exponent
+    EXPECT_EQ(VertexFormat::toHalf(2.0f - std::ldexp(1.0f, -12)), 0x4000);
+}
+
+TEST(VertexFormatTest, ToHalfDenormal) {
+    EXPECT_EQ(VertexFormat::toHalf(std::ldexp(1.0f, -24)), 0x0001);
+    EXPECT_EQ(VertexFormat::toHalf(std::ldexp(1.0f, -15)), 0x0200);
+    EXPECT_EQ(VertexFormat::toHalf(std::ldexp(1.0f, -26)), 0x0000);
+    EXPECT_EQ(VertexFormat::toHalf(-std::ldexp(1.0f, -26)), 0x8000);
+}
+
+TEST(VertexFormatTest, ToHalfOutOfRange) {
+    float inf = std::numeric_limits<float>::infinity();
+    EXPECT_EQ(VertexFormat::toHalf(70000.0f), 0x7c00);
+    EXPECT_EQ(VertexFormat::toHalf(-70000.0f), 0xfc00);
+    EXPECT_EQ(VertexFormat::toHalf(inf), 0x7c00);
+    EXPECT_EQ(VertexFormat::toHalf(-inf), 0xfc00);
+
+    uint16_t nan =
+        VertexFormat::toHalf(std::numeric_limits<float>::quiet_NaN());
+    EXPECT_EQ(nan & 0x7c00, 0x7c00);
+    EXPECT_NE(nan & 0x3ff, 0);
+}
+
+TEST(VertexFormatTest, PackNormalAxes) {
+    EXPECT_EQ(VertexFormat::packNormal(vec3(0.0f)), 0u);
+    EXPECT_EQ(VertexFormat::packNormal(vec3(1, 0, 0)), 511u);
+    EXPECT_EQ(VertexFormat::packNormal(vec3(0, 1, 0)), 511u << 10);
+    EXPECT_EQ(VertexFormat::packNormal(vec3(0, 0, 1)), 511u << 20);
+    // -511 in 10 bit two's complement
+    EXPECT_EQ(VertexFormat::packNormal(vec3(-1, 0, 0)), 0x201u);
+    EXPECT_EQ(VertexFormat::packNormal(vec3(0, 0, -1)), 0x201u << 20);
+}
+
+TEST(VertexFormatTest, PackNormalClampsAndLeavesW) {
+    uint32_t packed = VertexFormat::packNormal(vec3(2, -3, 0.5f));
+    EXPECT_EQ(packed & 0x3ff, 511u);
+    EXPECT_EQ((packed >> 10) & 0x3ff, 0x201u);
+    EXPECT_EQ((packed >> 20) & 0x3ff, 256u);
+    EXPECT_EQ(packed >> 30, 0u);
+}
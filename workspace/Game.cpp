@@ -56,7 +56,8 @@ void Game::onDraw() const {
 
     RenderState state(camera);
     state.setGridEnable(drawGrid);
-    scene.draw(state);
+    queue.submit(scene, state);
+    queue.flush();
 
     glDisable(GL_CULL_FACE);
     glDisable(GL_DEPTH_TEST);
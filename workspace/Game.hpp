@@ -5,6 +5,7 @@
 #include <singe/Core/ResourceManager.hpp>
 #include <singe/Core/Window.hpp>
 #include <singe/Graphics/Model.hpp>
+#include <singe/Graphics/RenderQueue.hpp>
 #include <singe/Graphics/Scene.hpp>
 #include <singe/Graphics/Shader.hpp>
 #include <singe/Support/log.hpp>
@@ -19,6 +20,7 @@ class Game : public GameBase {
     std::shared_ptr<singe::MVPShader> shader;
     std::shared_ptr<singe::Shader> circle_shader;
     Scene scene;
+    mutable RenderQueue queue;
 
     bool drawGrid;
 